@@ -459,6 +459,10 @@ namespace core {
     virtual Fixnum_sp vectorPushExtend(T_sp newElement, size_t extension) override {noFillPointerError(cl::_sym_vectorPushExtend,this->asSmartPtr());  };
     virtual T_sp replaceArray(T_sp other) override {notAdjustableError(core::_sym_replaceArray,this->asSmartPtr());  };
     virtual std::string get_std_string() const override {notStringError(this->asSmartPtr());};
+    /*! Copy len elements of src starting at src_start into this vector starting at start.
+        The ranges may overlap.  Returns false if src is a different kind of vector,
+        then the caller has to copy element by element. */
+    virtual bool unsafe_copy_range(size_t start, AbstractSimpleVector_sp src, size_t src_start, size_t len) { return false; };
     virtual void ranged_sxhash(HashGenerator& hg, size_t start, size_t end) const
     {
       TYPE_ERROR(this->asSmartPtr(),Cons_O::createList(cl::_sym_string,cl::_sym_bit_vector));
@@ -518,10 +522,17 @@ namespace core {
     virtual size_t elementSizeInBytes() const override {return sizeof(value_type); };
     virtual void* rowMajorAddressOfElement_(size_t i) const override {return (void*)&(this->_Data[i]);};
     virtual void unsafe_fillArrayWithElt(T_sp initialElement, size_t start, size_t end) override {
-      for (size_t i(start); i<end; ++i ) {
-        (*this)[i] = leaf_type::from_object(initialElement);
-      }
+      // Convert once, std::fill becomes memset or a vectorized loop
+      value_type value = leaf_type::from_object(initialElement);
+      std::fill(this->begin()+start, this->begin()+end, value);
     };
+    virtual bool unsafe_copy_range(size_t start, AbstractSimpleVector_sp src, size_t src_start, size_t len) override {
+      leaf_smart_ptr_type lsrc = src.asOrNull<leaf_type>();
+      if (!lsrc) return false;
+      BOUNDS_ASSERT(start+len<=this->length()&&src_start+len<=lsrc->length());
+      memmove((void*)(this->begin()+start), (const void*)(lsrc->begin()+src_start), len*sizeof(value_type));
+      return true;
+    }
     virtual Array_sp reverse() const final { return templated_ranged_reverse<leaf_type>(*reinterpret_cast<const leaf_type*>(this),0,this->length()); };
     virtual Array_sp nreverse() final { return templated_ranged_nreverse(*this,0,this->length()); };
     CL_METHOD_OVERLOAD virtual void rowMajorAset(size_t idx, T_sp value) final {(*this)[idx] = leaf_type::from_object(value);}
@@ -533,8 +544,12 @@ namespace core {
       return leaf_type::make(end-start,value_type(),true,end-start,(value_type*)this->rowMajorAddressOfElement_(start));
     }
     virtual Array_sp unsafe_setf_subseq(size_t start, size_t end, Array_sp newSubseq) final {
-      // TODO: Write specialized versions of this to speed it up
       BOUNDS_ASSERT(start<=end&&end<=this->length());
+      AbstractSimpleVector_sp src;
+      size_t src_start, src_end;
+      newSubseq->asAbstractSimpleVectorRange(src,src_start,src_end);
+      if ((src_end-src_start)>=(end-start) && this->unsafe_copy_range(start,src,src_start,end-start))
+        return newSubseq;
       for ( size_t i(start),ni(0); i<end; ++i,++ni ) {
         (*this)[i] = leaf_type::from_object(newSubseq->rowMajorAref(ni));
       }
@@ -602,8 +617,17 @@ namespace core {
     }
     static T_sp to_object(value_type v) { return Integer_O::create(v); }
     virtual void unsafe_fillArrayWithElt(T_sp initialElement, size_t start, size_t end) override {
-      // FIXME: Could be done more efficiently by writing whole words, but be careful about the ends.
-      for (size_t i = start; i < end; ++i) (*this)[i] = from_object(initialElement);
+      BOUNDS_ASSERT(start<=end&&end<=this->length());
+      gctools::bit_array_fill_bits(this->bytes(), start*BitUnitBitWidth, (end-start)*BitUnitBitWidth,
+                                   initialFillValue(from_object(initialElement)));
+    }
+    virtual bool unsafe_copy_range(size_t start, AbstractSimpleVector_sp src, size_t src_start, size_t len) override {
+      leaf_smart_ptr_type lsrc = src.asOrNull<leaf_type>();
+      if (!lsrc) return false;
+      BOUNDS_ASSERT(start+len<=this->length()&&src_start+len<=lsrc->length());
+      gctools::bit_array_copy_bits(this->bytes(), start*BitUnitBitWidth,
+                                   lsrc->bytes(), src_start*BitUnitBitWidth, len*BitUnitBitWidth);
+      return true;
     }
     virtual size_t elementSizeInBytes() const override {bitVectorDoesntSupportError();}
     virtual void* rowMajorAddressOfElement_(size_t i) const override {bitVectorDoesntSupportError();}
@@ -624,6 +648,11 @@ namespace core {
     }
     Array_sp unsafe_setf_subseq(size_t start, size_t end, Array_sp other) override {
       BOUNDS_ASSERT(0<=start&&start<end&&end<=this->length());
+      AbstractSimpleVector_sp src;
+      size_t src_start, src_end;
+      other->asAbstractSimpleVectorRange(src,src_start,src_end);
+      if ((src_end-src_start)>=(end-start) && this->unsafe_copy_range(start,src,src_start,end-start))
+        return other;
       for (size_t i = start, ni = 0; i < end; ++i, ++ni)
         (*this)[i] = from_object(other->rowMajorAref(ni));
       return other;
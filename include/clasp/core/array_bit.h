@@ -13,6 +13,11 @@ namespace core {
   bool ranged_bit_vector_EQ_(const SimpleBitVector_O& x, const SimpleBitVector_O& y,
                              size_t startx, size_t endx, size_t starty, size_t endy );
 
+  /*! Number of 1 bits in [start,end) of the words of a bit vector */
+  size_t bit_vector_count_ones(const bit_array_word* words, size_t start, size_t end);
+  /*! Index of the first (or last if from_end) bit in [start,end) that equals bit, or -1 */
+  Fixnum bit_vector_position(const bit_array_word* words, bool bit, size_t start, size_t end, bool from_end);
+
 }
 
 namespace core { class SimpleBitVector_O; };
@@ -61,12 +66,21 @@ namespace core {
     virtual void sxhash_(HashGenerator& hg) const final {this->ranged_sxhash(hg,0,this->length());}
     virtual void ranged_sxhash(HashGenerator& hg, size_t start, size_t end) const final {
       if (hg.isFilling()) {
-        Fixnum hash = 5381;
-        for ( size_t i(start); i<end; ++i ) {
-          simple_element_type c = (*this)[i];
-          hash = ((hash << 5) + hash) + c;
+        // Pack the bits of the range into words so that the hash does not
+        // depend on where the range starts in the underlying words
+        uint64_t hash = HASH_SEED ^ HASH_SECRET0;
+        uint64_t w[2] = {0,0};
+        size_t n = 0;
+        for ( size_t i(start); i<end; ++i, ++n ) {
+          if (n==128) {
+            hash = hash_words(hash,w[0],w[1]);
+            w[0] = w[1] = 0;
+            n = 0;
+          }
+          w[n>>6] |= (uint64_t)((*this)[i]&1) << (n&63);
         }
-        hg.addValue(hash);
+        if (n) hash = hash_words(hash,w[0],w[1]);
+        hg.addValue((Fixnum)hash_finish(hash,end-start));
       }
     }
   };
@@ -167,6 +167,39 @@ public: // Functions here
     (NLIMBS)--;\
   }
 
+// Bignums of one or two limbs fit in 128 bits, so arithmetic on them can be
+// done inline with the compiler's 128 bit integers instead of going through
+// the mpn functions and their scratch space.
+#if defined(__SIZEOF_INT128__) && (GMP_LIMB_BITS == 64) && (GMP_NAIL_BITS == 0)
+#define BIGNUM_FAST_PATH 1
+#define BIGNUM_SMALL_LIMBS 2
+typedef unsigned __int128 small_bignum_t;
+
+inline bool small_bignum_p(mp_size_t len) {
+  return (-BIGNUM_SMALL_LIMBS <= len) && (len <= BIGNUM_SMALL_LIMBS);
+}
+
+// Magnitude of a bignum with at most BIGNUM_SMALL_LIMBS limbs.
+inline small_bignum_t small_bignum_magnitude(const mp_limb_t* limbs, mp_size_t size) {
+  switch (size) {
+  case 0: return 0;
+  case 1: return limbs[0];
+  default: return ((small_bignum_t)limbs[1] << 64) | limbs[0];
+  }
+}
+
+// Split a magnitude into (at least two) limbs and return the signed length.
+inline mp_size_t small_bignum_limbs(mp_limb_t* limbs, small_bignum_t magnitude, bool negative) {
+  limbs[0] = (mp_limb_t)magnitude;
+  limbs[1] = (mp_limb_t)(magnitude >> 64);
+  mp_size_t size = (limbs[1] != 0) ? 2 : ((limbs[0] != 0) ? 1 : 0);
+  return negative ? -size : size;
+}
+
+// Like bignum_result, for a magnitude and sign.
+Integer_sp small_bignum_result(small_bignum_t magnitude, bool negative);
+#endif
+
 Bignum_sp core__next_from_fixnum(Fixnum);
 Integer_sp bignum_result(mp_size_t, const mp_limb_t*);
 Integer_sp core__next_fmul(Bignum_sp, Fixnum);
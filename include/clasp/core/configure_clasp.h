@@ -67,6 +67,7 @@ typedef uint64_t   bit_array_word; // "word" for bit array purposes (see gcbitar
 // NOTE: C++11 says long long is at least 64 bits, so this probably works.
 #define bit_array_word_popcount __builtin_popcountll
 #define bit_array_word_clz __builtin_clzll
+#define bit_array_word_ctz __builtin_ctzll
 
 typedef int64_t    Fixnum; // Signed Fixnum immediate value
 #define CLASP_FIXNUM_IS_INT64 1  // == true
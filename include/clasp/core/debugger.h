@@ -27,6 +27,8 @@ THE SOFTWARE.
 #ifndef debugger_H
 #define debugger_H
 
+#include <atomic>
+#include <algorithm>
 #include <clasp/core/object.h>
 #include <clasp/core/lisp.h>
 #include <clasp/core/stacks.h>
@@ -194,7 +196,7 @@ void register_llvm_stackmaps(uintptr_t startAddress, uintptr_t endAddress, size_
  
  void startup_register_loaded_objects();
 
-bool lookup_address(uintptr_t address, const char*& symbol, uintptr_t& start, uintptr_t& end, char& type );
+bool lookup_address(uintptr_t address, std::string& symbol, uintptr_t& start, uintptr_t& end, char& type );
 
  typedef enum {undefined,symbolicated,lispFrame,cFrame} BacktraceFrameEnum ;
 struct BacktraceEntry {
@@ -358,6 +360,149 @@ struct StackMapRange {
 
 
 
+/*! The patchPointID of the stackmap that cmpir.lsp puts in every lisp function,
+    its location is the frame offset of the register save area */
+#define LISP_FRAME_PATCH_POINT_ID 1234567
+
+/*! A function in a library or jitted object, it covers [_Start,_End) */
+struct SymbolIndexEntry {
+  uintptr_t  _Start;
+  uintptr_t  _End;
+  uintptr_t  _FunctionDescription;  // 0 if the function has no FunctionDescription
+  uint32_t   _NameOffset;
+  char       _Type;
+  bool operator<(const SymbolIndexEntry& other) const { return this->_Start < other._Start; };
+};
+
+/*! The functions of one library or jitted object, immutable once it is in the index */
+struct SymbolIndexRegion {
+  std::string                    _Name;     // library filename - empty for jitted objects
+  bool                           _Jitted;
+  uintptr_t                      _Origin;
+  uintptr_t                      _Low;
+  uintptr_t                      _High;
+  std::vector<SymbolIndexEntry>  _Entries;  // sorted by _Start and not overlapping
+  std::string                    _Names;
+  SymbolIndexRegion(const std::string& name, bool jitted, uintptr_t origin) : _Name(name), _Jitted(jitted), _Origin(origin), _Low(~0), _High(0) {};
+  void addEntry(const std::string& name, uintptr_t start, uintptr_t end, char type, uintptr_t functionDescription);
+  /*! Sort the entries and calculate _Low and _High */
+  void finish();
+  const SymbolIndexEntry* find(uintptr_t address) const;
+  const char* entryName(const SymbolIndexEntry& entry) const { return this->_Names.data()+entry._NameOffset; };
+};
+
+/*! The frame of a lisp function that has a stackmap */
+struct FrameIndexEntry {
+  uintptr_t  _Start;
+  int        _FrameSize;
+  int        _FrameOffset;
+  bool operator<(const FrameIndexEntry& other) const { return this->_Start < other._Start; };
+};
+
+/*! The lisp frames described by one range of stackmaps */
+struct FrameIndexRegion {
+  std::string                   _Name;
+  uintptr_t                     _Low;
+  uintptr_t                     _High;
+  std::vector<FrameIndexEntry>  _Entries;  // sorted by _Start
+  FrameIndexRegion(const std::string& name) : _Name(name), _Low(~0), _High(0) {};
+  void finish();
+  /*! Only an exact match of a function start address is found */
+  const FrameIndexEntry* find(uintptr_t address) const;
+};
+
+/*! An index of address ranges that can be searched in O(log n) without locking.
+    The regions are held in an immutable Snapshot sorted by _Low.  A writer copies the
+    snapshot, changes the copy and publishes it under _Mutex.  Readers count themselves
+    in _Readers while they use a snapshot and the replaced snapshots and regions are
+    only freed by a writer that sees no readers.
+    Regions may overlap (jitted code is allocated wherever the memory manager puts it)
+    so _MaxHigh[i] is the largest _High of regions [0,i] and a search walks back from the
+    last region that starts at or below the address until no earlier region can contain it. */
+template <typename Region>
+class AddressIndex {
+  struct Snapshot {
+    std::vector<Region*>    _Regions;
+    std::vector<uintptr_t>  _MaxHigh;
+  };
+  std::atomic<Snapshot*>       _Current;
+  mutable std::atomic<size_t>  _Readers;
+  mp::Mutex                    _Mutex;
+  std::vector<Snapshot*>       _RetiredSnapshots;
+  std::vector<Region*>         _RetiredRegions;
+
+  void publish(Snapshot* next) {
+    for ( size_t i=0; i<next->_Regions.size(); ++i ) {
+      uintptr_t high = next->_Regions[i]->_High;
+      next->_MaxHigh.push_back((i>0 && next->_MaxHigh[i-1]>high) ? next->_MaxHigh[i-1] : high);
+    }
+    this->_RetiredSnapshots.push_back(this->_Current.exchange(next));
+    if (this->_Readers.load()==0) {
+      for ( auto snapshot : this->_RetiredSnapshots ) delete snapshot;
+      for ( auto region : this->_RetiredRegions ) delete region;
+      this->_RetiredSnapshots.clear();
+      this->_RetiredRegions.clear();
+    }
+  }
+public:
+  AddressIndex(uint64_t nameword) : _Current(new Snapshot()), _Readers(0), _Mutex(nameword) {};
+
+  /*! The index takes ownership of the region */
+  void add(Region* region) {
+    WITH_READ_WRITE_LOCK(this->_Mutex);
+    Snapshot* current = this->_Current.load();
+    Snapshot* next = new Snapshot();
+    next->_Regions.reserve(current->_Regions.size()+1);
+    auto pos = std::upper_bound(current->_Regions.begin(),current->_Regions.end(),region,
+                                [] (const Region* x, const Region* y) { return x->_Low < y->_Low; });
+    next->_Regions.insert(next->_Regions.end(),current->_Regions.begin(),pos);
+    next->_Regions.push_back(region);
+    next->_Regions.insert(next->_Regions.end(),pos,current->_Regions.end());
+    this->publish(next);
+  }
+
+  /*! Remove every region with the name, return how many were removed */
+  size_t remove(const std::string& name) {
+    WITH_READ_WRITE_LOCK(this->_Mutex);
+    Snapshot* current = this->_Current.load();
+    Snapshot* next = new Snapshot();
+    size_t removed = 0;
+    for ( auto region : current->_Regions ) {
+      if (region->_Name == name) {
+        this->_RetiredRegions.push_back(region);
+        ++removed;
+      } else {
+        next->_Regions.push_back(region);
+      }
+    }
+    this->publish(next);
+    return removed;
+  }
+
+  /*! Call (fn region entry) for the entry that contains the address and return true,
+      the region and entry are only valid during the call */
+  template <typename Fn>
+  bool find(uintptr_t address, Fn fn) const {
+    this->_Readers.fetch_add(1);
+    Snapshot* snapshot = this->_Current.load();
+    const std::vector<Region*>& regions = snapshot->_Regions;
+    size_t index = std::upper_bound(regions.begin(),regions.end(),address,
+                                    [] (uintptr_t addr, const Region* region) { return addr < region->_Low; })-regions.begin();
+    bool found = false;
+    while (index>0 && address < snapshot->_MaxHigh[index-1]) {
+      --index;
+      auto entry = regions[index]->find(address);
+      if (entry) {
+        fn(*regions[index],*entry);
+        found = true;
+        break;
+      }
+    }
+    this->_Readers.fetch_sub(1);
+    return found;
+  }
+};
+
 struct DebugInfo {
 #ifdef CLASP_THREADS
   mutable mp::SharedMutex _OpenDynamicLibraryMutex;
@@ -367,12 +512,32 @@ struct DebugInfo {
   std::map<uintptr_t,StackMapRange> _StackMaps;
   mp::SharedMutex                   _JittedObjectsLock;
   std::vector<JittedObject>         _JittedObjects;
+  AddressIndex<SymbolIndexRegion>   _SymbolIndex;
+  AddressIndex<FrameIndexRegion>    _FrameIndex;
   DebugInfo() : _OpenDynamicLibraryMutex(OPENDYLB_NAMEWORD),
                 _StackMapsLock(STCKMAPS_NAMEWORD),
-                _JittedObjectsLock(JITDOBJS_NAMEWORD)
+                _JittedObjectsLock(JITDOBJS_NAMEWORD),
+                _SymbolIndex(SYMINDEX_NAMEWORD),
+                _FrameIndex(FRMINDEX_NAMEWORD)
   {};
 };
 
+/*! A symbol of a jitted object - see register_jitted_symbols */
+struct JittedSymbol {
+  std::string  _Name;
+  uintptr_t    _Address;
+  size_t       _Size;
+  bool         _Function;
+  JittedSymbol(const std::string& name, uintptr_t address, size_t size, bool function) : _Name(name), _Address(address), _Size(size), _Function(function) {};
+};
+
+/*! Add the functions of a jitted object to the symbol index */
+void register_jitted_symbols(const std::vector<JittedSymbol>& symbols);
+/*! Add the functions of a library symbol table and its stackmaps to the indices */
+void index_library_symbol_table(const std::string& libraryName, uintptr_t libraryOrigin, const SymbolTable& symbolTable);
+/*! Look up the function that contains the address in the symbol and frame indices */
+bool symbolize_address(BacktraceEntry& entry, std::string* libraryName = NULL, uintptr_t* libraryOrigin = NULL, char* type = NULL);
+
 void core__start_debugger_with_backtrace(T_sp backtrace);
 T_mv core__call_with_backtrace(Function_sp closure, bool args_as_pointers);
 
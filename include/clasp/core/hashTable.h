@@ -151,6 +151,7 @@ struct KeyValuePair {
 //    List_sp findAssoc_no_lock(gc::Fixnum index, T_sp searchKey) const;
 
     T_sp hash_table_average_search_length();
+    SimpleVector_sp hash_table_probe_histogram();
 
   /*! Return true if the key is within the hash table */
     bool contains(T_sp key);
@@ -158,6 +159,13 @@ struct KeyValuePair {
   /*! Return the key/value pair in a CONS if found or NIL if not */
     KeyValuePair* find(T_sp key);
 
+  /*! Hash of a string key as an EQUAL hash table computes it, before it is bounded */
+    static gc::Fixnum stringKeyHash(SimpleString_sp key);
+  /*! Like find for an EQUAL hash table keyed by strings, given the stringKeyHash of the key.
+      Packages probe several symbol tables with the same name so they hash it once,
+      and names are compared with memcmp rather than through keyTest. */
+    KeyValuePair* findStringKey(SimpleString_sp key, gc::Fixnum hash);
+
     T_mv gethash(T_sp key, T_sp defaultValue = _Nil<T_O>()) override;
     gc::Fixnum hashIndex(T_sp key) const;
 
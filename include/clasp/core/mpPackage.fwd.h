@@ -34,6 +34,7 @@ THE SOFTWARE.
 #include <array>
 #include <unordered_map>
 #include <vector>
+#include <clasp/gctools/telemetry.h>
 
 PACKAGE_USE("COMMON-LISP");
 NAMESPACE_PACKAGE_ASSOCIATION(mp, MpPkg, "MP")
@@ -341,7 +342,12 @@ void debug_mutex_unlock(Mutex* m);
 #define SUSPBARR_NAMEWORD 0x0052424250535553
 #define DISSASSM_NAMEWORD 0x0053534153534944
 #define JITGDBIF_NAMEWORD 0x004942444754494a
+#define JITCACHE_NAMEWORD 0x004843414354494a
+#define SYMINDEX_NAMEWORD 0x0045444e494d5953
+#define FRMINDEX_NAMEWORD 0x0045444e494d5246
 #define MPSMESSG_NAMEWORD 0x005353454d53504d     // MPSMESSG
+#define ALLOCSMP_NAMEWORD 0x004d53434f4c4c41     // ALLOCSM
+#define TELEMETR_NAMEWORD 0x0054454d454c4554     // TELEMET
 
 struct Mutex {
   uint64_t _NameWord;
@@ -368,7 +374,17 @@ struct Mutex {
 #ifdef DEBUG_DTRACE_LOCK_PROBE
       DtraceLockProbe _guard((char*)&this->_NameWord);
 #endif
-      bool result = (pthread_mutex_lock(&this->_Mutex)==0);
+      bool result;
+      if (__builtin_expect(telemetry::event_enabled(telemetry::event_lock_wait),0)) {
+        // Only contended acquisitions are recorded
+        result = (pthread_mutex_trylock(&this->_Mutex)==0);
+        if (!result) {
+          telemetry::ScopedEvent wait(telemetry::event_lock_wait,this->_NameWord);
+          result = (pthread_mutex_lock(&this->_Mutex)==0);
+        }
+      } else {
+        result = (pthread_mutex_lock(&this->_Mutex)==0);
+      }
       ++this->_Counter;
       return result;
     }
@@ -105,16 +105,7 @@ typedef enum {Nascent = 0, // Has not yet started, may proceed to Active
     CL_LISPIFY_NAME("make_process");
     CL_LAMBDA(name function &optional arguments special_bindings (stack-size 0));
     CL_DOCSTRING("Make and return a new process object. The new process is inactive; it can be started with PROCESS-START.\n\nNAME is the name of the process for display purposes. FUNCTION is the function that the process should execute. ARGUMENTS is a list of arguments that will be passed to the function when the process is enabled; the default is NIL. SPECIAL-BINDINGS is an alist of (symbol . form): the forms will be evaluated in a null lexical environment, and their values bound to the symbols (as if by PROGV) when the process is started.");
-    CL_DEF_CLASS_METHOD static Process_sp make_process(core::T_sp name, core::T_sp function, core::T_sp arguments, core::T_sp special_bindings, size_t stack_size) {
-      core::List_sp passed_bindings = core::cl__reverse(special_bindings);
-      core::List_sp all_bindings = core::lisp_copy_default_special_bindings();
-      for ( auto cur : passed_bindings) {
-        all_bindings = core::Cons_O::create(oCar(cur),all_bindings);
-      }
-      if (stack_size==0) stack_size = DEFAULT_THREAD_STACK_SIZE;
-      GC_ALLOCATE_VARIADIC(Process_O,p,name,function,arguments,all_bindings,stack_size);
-      return p;
-    };
+    CL_DEF_CLASS_METHOD static Process_sp make_process(core::T_sp name, core::T_sp function, core::T_sp arguments, core::T_sp special_bindings, size_t stack_size);
   public:
     uintptr_t   _UniqueID;
     core::T_sp  _Name;
@@ -75,6 +75,12 @@ public: // Functions here
     this->_Values[i] = val.raw_();
   }
 
+  /*! Copy values [start,end) to dest, an argument frame say, in one move
+      rather than one smart_ptr at a time. */
+  void copyValues(T_O** dest, size_t start, size_t end) const {
+    if (end > start) memcpy(dest, &this->_Values[start], (end - start) * sizeof(T_O*));
+  }
+
   /*! Return a Cons of elements 1 up to but not including iend */
   //  List_sp asCons(int iend) const;
 };
@@ -28,6 +28,11 @@ THE SOFTWARE.
 
 #ifndef newhash_H
 #define newhash_H
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
 /********************
  * HASHING ROUTINES *
  ********************/
@@ -246,10 +251,85 @@ hash_string(int initval, const unsigned char *k, int length) {
 }
 #endif
 
+/*
+ * Multiply-fold mixing (the core of wyhash).  The 64x64->128 bit product
+ * of two words folded back to 64 bits mixes every input bit into the
+ * result with a single multiply, which is much cheaper than hash_mix.
+ */
+#define HASH_SEED 5381
+#define HASH_SECRET0 0xa0761d6478bd642fULL
+#define HASH_SECRET1 0xe7037ed1a0b428dbULL
+#define HASH_SECRET2 0x8ebc6af09c88c6e3ULL
+#define HASH_SECRET3 0x589965cc75374cc3ULL
+
+inline uint64_t hash_mum(uint64_t a, uint64_t b) {
+  __uint128_t r = (__uint128_t)a * b;
+  return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
 inline uintptr_t hash_word(uintptr_t c, uintptr_t w) {
-  uintptr_t a = w + GOLDEN_RATIO, b = GOLDEN_RATIO;
-  hash_mix(a, b, c);
-  return c;
+  return hash_mum(c ^ HASH_SECRET0, w ^ HASH_SECRET1);
+}
+
+/*! Mix two more words of a bulk hash into h */
+inline uint64_t hash_words(uint64_t h, uint64_t w0, uint64_t w1) {
+  return hash_mum(w0 ^ HASH_SECRET1, w1 ^ h);
+}
+
+inline uint64_t hash_finish(uint64_t h, uint64_t length) {
+  return hash_mum(h ^ HASH_SECRET2, length ^ HASH_SECRET3);
+}
+
+/*! Load eight bytes as a little endian word */
+inline uint64_t hash_load_word(const unsigned char *p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+  return w;
+}
+
+/*! Hash a sequence of character codes sixteen at a time.
+    The low byte of each code is packed into two little endian words, so for
+    8 bit codes this is exactly hash_octets.  Groups that contain codes above 255
+    mix in their high bits as well - such strings can never be EQUAL to a base string. */
+template <typename Code>
+inline uint64_t hash_codes(const Code *p, size_t length, uint64_t seed) {
+  uint64_t h = seed ^ HASH_SECRET0;
+  for (size_t start = 0; start < length; start += 16) {
+    size_t n = std::min(length - start, (size_t)16);
+    uint64_t w[2] = {0, 0};
+    uint64_t wide = 0;
+    for (size_t k = 0; k < n; ++k) {
+      uint64_t code = (uint64_t)p[start + k];
+      w[k >> 3] |= (code & 0xff) << ((k & 7) * 8);
+      wide |= code >> 8;
+    }
+    h = hash_words(h, w[0], w[1]);
+    if (wide) {
+      uint64_t v[4] = {0, 0, 0, 0};
+      for (size_t k = 0; k < n; ++k)
+        v[k >> 2] |= ((uint64_t)p[start + k] >> 8) << ((k & 3) * 16);
+      h = hash_words(h, v[0], v[1]);
+      h = hash_words(h, v[2], v[3]);
+    }
+  }
+  return hash_finish(h, length);
+}
+
+/*! Hash bytes a word at a time - the same value as hash_codes over the bytes */
+inline uint64_t hash_octets(const unsigned char *p, size_t length, uint64_t seed) {
+  uint64_t h = seed ^ HASH_SECRET0;
+  size_t left = length;
+  for (; left >= 16; left -= 16, p += 16)
+    h = hash_words(h, hash_load_word(p), hash_load_word(p + 8));
+  if (left) {
+    unsigned char tail[16] = {0};
+    memcpy(tail, p, left);
+    h = hash_words(h, hash_load_word(tail), hash_load_word(tail + 8));
+  }
+  return hash_finish(h, length);
 }
 #if 0
 inline uintptr_t hash_base_string(const char *s, int len, uintptr_t h) {
@@ -139,6 +139,13 @@ namespace core {
 class HashGeneratorBase {
 };
 
+/*! Reduce a hash to [0,bound).  Hash tables are sized to powers of two so
+    this is a mask - any other bound falls back to a division. */
+inline gc::Fixnum hash_reduce(gc::Fixnum hash, gc::Fixnum bound) {
+  if (LIKELY((bound & (bound-1)) == 0)) return ((uintptr_t)hash) & (bound-1);
+  return ((uintptr_t)hash) % bound;
+}
+
 typedef enum { hashEmpty, hashFilling, hashFull } FillingType;
 class Hash1Generator : public HashGeneratorBase {
  public:
@@ -170,7 +177,7 @@ class Hash1Generator : public HashGeneratorBase {
   void hashObject(T_sp obj);
   
   gc::Fixnum rawhash() const {
-    gc::Fixnum hash(5381);
+    gc::Fixnum hash(HASH_SEED);
     hash = (gc::Fixnum)hash_word(hash,(uintptr_t)this->_Part);
     return hash;
   }
@@ -186,7 +193,7 @@ class Hash1Generator : public HashGeneratorBase {
       printf("%s:%d  final hash = %lu\n", __FILE__, __LINE__, hash);
     }
 #endif
-    return ((uintptr_t)hash) % bound;
+    return hash_reduce(hash,bound);
   }
 #if 0 // def USE_MPS
   void addAddressesToLocationDependency(mps_ld_t ld) {
@@ -259,7 +266,7 @@ public:
   bool addValue(const mpz_class &bignum);
 
   gc::Fixnum rawhash() const {
-    gc::Fixnum hash = 5381;
+    gc::Fixnum hash = HASH_SEED;
     for (int i = 0; i < this->_NextPartIndex; i++) {
       hash = (gc::Fixnum)hash_word((uintptr_t)hash, (uintptr_t) this->_Parts[i]);
 #ifdef DEBUG_HASH_GENERATOR
@@ -282,7 +289,7 @@ public:
   gc::Fixnum hashBound(gc::Fixnum bound = 0) const {
     gc::Fixnum hash = this->rawhash();
     if (bound)
-      return ((uintptr_t)hash) % bound;
+      return hash_reduce(hash,bound);
 #ifdef DEBUG_HASH_GENERATOR
     if (this->_debug) {
       printf("%s:%d  final hash = %lu\n", __FILE__, __LINE__, hash);
@@ -54,6 +54,9 @@ class Package_O : public General_O {
   HashTableEqual_sp _InternalSymbols;
   HashTableEqual_sp _ExternalSymbols;
   HashTableEq_sp _Shadowing;
+  /*! Symbols found through _UsingPackages, by name - cleared whenever the
+      use list or the external symbols of a used package change */
+  HashTableEqual_sp _InheritedSymbols;
   SimpleString_sp _Name;
   gctools::Vec0<Package_sp> _UsingPackages;
   gctools::Vec0<Package_sp> _PackagesUsedBy;
@@ -87,6 +90,10 @@ class Package_O : public General_O {
  public:
   string packageName() const;
 
+  void clearInheritedSymbols() const;
+  /*! Our external symbols changed - clear the caches of the packages that use us */
+  void clearUsersInheritedSymbols() const;
+
   T_mv packageHashTables() const;
 
   void setNicknames(List_sp nicknames) {
@@ -161,6 +161,8 @@ public:
 namespace core {
 bool clasp_stringMatch(T_sp s, size_t j, size_t ls,
                        T_sp p, size_t i, size_t lp);
+bool clasp_stringMatchBytes(const char* s, size_t j, size_t ls,
+                            const char* p, size_t i, size_t lp);
 bool clasp_logical_hostname_p(T_sp host);
 bool clasp_wild_string_p(T_sp item);
 T_sp clasp_namestring(T_sp x, int flags);
@@ -34,34 +34,95 @@ THE SOFTWARE.
 #include <clasp/core/numbers.h>
 
 namespace core {
-  
+
+/*! xoshiro256** (Blackman and Vigna). 256 bits of state, period 2^256-1,
+    and jump functions that advance it by 2^128 or 2^192 steps, so one seed
+    can be split into non-overlapping streams. Meets the standard's
+    UniformRandomBitGenerator requirements. */
+class Xoshiro256 {
+public:
+  typedef uint64_t result_type;
+  uint64_t _State[4];
+public:
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+  explicit Xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+  // Expand a 64 bit seed into the state with splitmix64, as the authors recommend.
+  void seed(uint64_t seed) {
+    for (int i = 0; i < 4; ++i) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      this->_State[i] = z ^ (z >> 31);
+    }
+  }
+  static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+  inline result_type operator()() {
+    uint64_t* s = this->_State;
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+  //! Advance by 2^128 steps.
+  void jump();
+  //! Advance by 2^192 steps.
+  void long_jump();
+  //! A uniformly distributed integer in [0,n), n > 0, without modulo bias (Lemire's method).
+  inline uint64_t bounded(uint64_t n) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 m = (unsigned __int128)(*this)() * n;
+    uint64_t low = (uint64_t)m;
+    if (low < n) {
+      uint64_t threshold = -n % n;
+      while (low < threshold) {
+        m = (unsigned __int128)(*this)() * n;
+        low = (uint64_t)m;
+      }
+    }
+    return (uint64_t)(m >> 64);
+#else
+    uint64_t threshold = -n % n;
+    uint64_t r;
+    do { r = (*this)(); } while (r < threshold);
+    return r % n;
+#endif
+  }
+  //! A uniformly distributed double in [0,1) with 53 random bits.
+  inline double unit_double() { return ((*this)() >> 11) * 0x1.0p-53; }
+  //! A uniformly distributed float in [0,1) with 24 random bits.
+  inline float unit_float() { return ((*this)() >> 40) * 0x1.0p-24f; }
+private:
+  void jump_with(const uint64_t* polynomial);
+};
+
+std::ostream& operator<<(std::ostream& os, const Xoshiro256& gen);
+std::istream& operator>>(std::istream& is, Xoshiro256& gen);
+
 SMART(RandomState);
 
 class RandomState_O : public General_O {
   LISP_CLASS(core, ClPkg, RandomState_O, "random-state",General_O);
   //    DECLARE_ARCHIVE();
 public: // Simple default ctor/dtor
-  typedef std::mt19937 Generator;
+  typedef Xoshiro256 Generator;
   Generator _Producer;
 
 public: // ctor/dtor for classes with shared virtual base
   explicit RandomState_O(bool random = false) {
     if (random) {
-      clock_t currentTime;
-#ifdef darwin
-      currentTime = mach_absolute_time();
-#else
-      currentTime = clock();
-#endif
-      uint tt = currentTime;
-      tt = currentTime % 32768;
-      Generator temp_gen(static_cast<uint>(tt));
-      this->_Producer = temp_gen; // this->_Producer.seed(tt);
+      std::random_device device;
+      this->_Producer.seed(((uint64_t)device() << 32) ^ device() ^ (uint64_t)clock());
     } else {
-      Generator temp_gen(0);
-      this->_Producer = temp_gen; //this->_Producer.seed(0);
+      this->_Producer.seed(0);
     }
   };
+  explicit RandomState_O(uint64_t seed) : _Producer(seed) {};
   explicit RandomState_O(const RandomState_O &state) {
     this->_Producer = state._Producer;
   };
@@ -75,6 +136,7 @@ public: // ctor/dtor for classes with shared virtual base
   CL_DEFMETHOD RandomState_sp random_state_set(const std::string& s) {
     stringstream ss(s);
     ss >> this->_Producer;
+    if (ss.fail()) SIMPLE_ERROR(BF("Could not parse a random-state from %s") % s);
     return this->asSmartPtr();
   }
 
@@ -88,12 +150,18 @@ public: // ctor/dtor for classes with shared virtual base
     GC_ALLOCATE_VARIADIC(RandomState_O, b, true );
     return b;
   }
+  static RandomState_sp create_seeded(uint64_t seed) {
+    GC_ALLOCATE_VARIADIC(RandomState_O, b, seed );
+    return b;
+  }
 
   virtual void __write__(T_sp strm) const;
   virtual void __writeReadable__(T_sp strm) const;
 
 }; // RandomState class
 
+RandomState_sp core__random_state_split(RandomState_sp random_state);
+
 }; // core namespace
 
 #endif /* _random_H_ */
@@ -89,13 +89,8 @@ namespace core {
     virtual void sxhash_(HashGenerator& hg) const final {this->ranged_sxhash(hg,0,this->length());}
     virtual void ranged_sxhash(HashGenerator& hg, size_t start, size_t end) const final {
       if (hg.isFilling()) {
-        Fixnum hash = 5381;
-        Fixnum c;
-        for ( size_t i(start); i<end; ++i ) {
-          const value_type& c = (*this)[i];
-          hash = ((hash << 5) + hash) + c;
-        }
-        hg.addValue(hash);
+        const unsigned char* chars = (start<end) ? (const unsigned char*)&(*this)[start] : NULL;
+        hg.addValue((Fixnum)hash_octets(chars,end-start,HASH_SEED));
       }
     }
   };
@@ -164,13 +159,9 @@ namespace core {
     virtual void sxhash_(HashGenerator& hg) const override {this->ranged_sxhash(hg,0,this->length());}
     virtual void ranged_sxhash(HashGenerator& hg, size_t start, size_t end) const override {
       if (hg.isFilling()) {
-        Fixnum hash = 5381;
-        Fixnum c;
-        for ( size_t i(start); i<end; ++i ) {
-          const value_type& c = (*this)[i];
-          hash = ((hash << 5) + hash) + c;
-        }
-        hg.addValue(hash);
+        // Hashes to the same value as a base string with the same characters
+        const value_type* chars = (start<end) ? &(*this)[start] : NULL;
+        hg.addValue((Fixnum)hash_codes(chars,end-start,HASH_SEED));
       }
     }
   };
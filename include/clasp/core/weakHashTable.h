@@ -57,8 +57,6 @@ public: // instance variables here
   typedef typename gctools::WeakKeyHashTable::value_type value_type;
   typedef typename gctools::WeakKeyHashTable::KeyBucketsType KeyBucketsType;
   typedef typename gctools::WeakKeyHashTable::ValueBucketsType ValueBucketsType;
-  typedef typename gctools::WeakKeyHashTable::KeyBucketsAllocatorType KeyBucketsAllocatorType;
-  typedef typename gctools::WeakKeyHashTable::ValueBucketsAllocatorType ValueBucketsAllocatorType;
   typedef gctools::WeakKeyHashTable HashTableType;
 #else
   typedef gctools::tagged_backcastable_base_ptr<T_O> value_type;
@@ -71,10 +69,19 @@ public: // instance variables here
   HashTableType _HashTable;
   
 public:
-  WeakKeyHashTable_O(size_t sz, Number_sp rehashSize, double rehashThreshold ) : _HashTable(sz,rehashSize, rehashThreshold) {};
+  WeakKeyHashTable_O(size_t sz, Number_sp rehashSize, double rehashThreshold,
+                     gctools::WeakTableKind weakness = gctools::WeakKey,
+                     gctools::WeakTableTest test = gctools::WeakTestEq)
+    : _HashTable(sz,rehashSize, rehashThreshold, weakness, test) {};
   WeakKeyHashTable_O();
   void initialize() override; 
+  /*! Make a weak table for make-hash-table, weakness is :key, :value, :key-and-value
+      or :key-or-value and test is one of the four standard tests */
+  static WeakKeyHashTable_sp make(size_t sz, Number_sp rehashSize, double rehashThreshold,
+                                  Symbol_sp weakness, T_sp test);
 public:
+  Symbol_sp weakness() const;
+  // O(size) - counting has to look at every entry to skip the collected ones
   size_t hashTableCount() const override { return this->_HashTable.tableSize();};
   cl_index size() const { return this->hashTableCount(); };
   size_t hashTableSize() const override { return this->_HashTable.length();};
@@ -84,10 +91,7 @@ public:
   bool fullp();
 
   void describe(T_sp stream) override;
-  virtual T_sp hashTableTest() const { return cl::_sym_eq; };
-  bool keyTest(T_sp entryKey, T_sp searchKey) const;
-
-  gc::Fixnum sxhashKey(T_sp key, gc::Fixnum bound, bool willAddKey) const;
+  virtual T_sp hashTableTest() const;
 
   void maphashLowLevel(std::function<void(T_sp, T_sp)> const &fn);
   void maphash(T_sp functionDesig) override; 
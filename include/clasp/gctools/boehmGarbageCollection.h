@@ -61,6 +61,21 @@ namespace gctools {
   void boehm_set_finalizer_list(gctools::Tagged object, gctools::Tagged finalizers );
   void boehm_clear_finalizer_list(gctools::Tagged object);
 
+  /*! Once the finalizer thread is running Boehm only finalizes on demand and
+      Lisp finalizers are queued and run in batches by that thread. */
+  void boehm_finalizer_thread_loop();
+  size_t boehm_run_pending_finalizers();
+  void boehm_wait_for_finalizers();
+
+  struct FinalizerStatistics {
+    size_t   _QueueDepth;
+    size_t   _Finalized;
+    size_t   _Batches;
+    uint64_t _TotalLatencyNanoseconds;
+    uint64_t _MaxLatencyNanoseconds;
+  };
+  FinalizerStatistics boehm_finalizer_statistics();
+
   void clasp_warn_proc(char *msg, GC_word arg);
 
   int initializeBoehm(MainFunctionType startupFn, int argc, char *argv[], bool mpiEnabled, int mpiRank, int mpiSize);
@@ -604,14 +604,19 @@ extern "C" {
 };
 
 namespace gctools {
-  extern void boehm_general_finalizer_from_BoehmFinalizer(void* client, void* dummy);
+  extern bool boehm_general_finalizer_from_BoehmFinalizer(void* client, void* dummy);
   
 #ifdef USE_BOEHM
 template <class OT>
 void BoehmFinalizer(void *base, void *data) {
   //        printf("%s:%d Finalizing ptr=%p\n", __FILE__, __LINE__, obj);
   OT *client = BasePtrToMostDerivedPtr<OT>(base);
-  boehm_general_finalizer_from_BoehmFinalizer((void*)client,data);
+  if (boehm_general_finalizer_from_BoehmFinalizer((void*)client,data)) {
+    // The Lisp finalizers were queued and they keep the object alive until they run.
+    // Finalize it again once they are done to run the destructor.
+    GC_register_finalizer_no_order(base,BoehmFinalizer<OT>,NULL,NULL,NULL);
+    return;
+  }
   client->~OT();
 }
 #endif
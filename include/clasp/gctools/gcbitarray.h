@@ -28,9 +28,70 @@ THE SOFTWARE.
 #define gc_gcbitarray_H
 
 #include <type_traits> // for std::conditional
+#include <algorithm> // for std::min
 
 namespace gctools {
 
+/* Bulk operations on the words of sub-byte arrays.
+ * Elements are stored from the most significant bit of each word down (see the
+ * offset calculation in GCBitUnitArray_moveable), so the words of an array form one
+ * stream of bits in which element i occupies bits [i*width, (i+1)*width). */
+
+// Return a word whose top nbits (1..BIT_ARRAY_WORD_BITS) are the bits at pos
+inline bit_array_word bit_array_load_bits(const bit_array_word* words, size_t pos, size_t nbits) {
+  size_t w = pos/BIT_ARRAY_WORD_BITS, s = pos%BIT_ARRAY_WORD_BITS;
+  bit_array_word value = words[w] << s;
+  if (s + nbits > BIT_ARRAY_WORD_BITS) value |= words[w+1] >> (BIT_ARRAY_WORD_BITS-s);
+  return value;
+}
+
+// Store the top nbits (1..BIT_ARRAY_WORD_BITS) of value at pos
+inline void bit_array_store_bits(bit_array_word* words, size_t pos, bit_array_word value, size_t nbits) {
+  size_t w = pos/BIT_ARRAY_WORD_BITS, s = pos%BIT_ARRAY_WORD_BITS;
+  bit_array_word mask = ~(bit_array_word)0 << (BIT_ARRAY_WORD_BITS-nbits);
+  value &= mask;
+  words[w] = (words[w] & ~(mask >> s)) | (value >> s);
+  if (s + nbits > BIT_ARRAY_WORD_BITS) {
+    size_t shift = BIT_ARRAY_WORD_BITS-s;
+    words[w+1] = (words[w+1] & ~(mask << shift)) | (value << shift);
+  }
+}
+
+/* Set nbits bits starting at pos to pattern, which must repeat with the element width
+ * (see initialFillValue) and pos must be a multiple of it. Whole words are stored directly. */
+inline void bit_array_fill_bits(bit_array_word* words, size_t pos, size_t nbits, bit_array_word pattern) {
+  size_t misalign = pos%BIT_ARRAY_WORD_BITS;
+  if (misalign && nbits) {
+    size_t n = std::min(nbits, BIT_ARRAY_WORD_BITS-misalign);
+    bit_array_store_bits(words, pos, pattern, n);
+    pos += n;
+    nbits -= n;
+  }
+  for ( ; nbits >= BIT_ARRAY_WORD_BITS; pos += BIT_ARRAY_WORD_BITS, nbits -= BIT_ARRAY_WORD_BITS)
+    words[pos/BIT_ARRAY_WORD_BITS] = pattern;
+  if (nbits) bit_array_store_bits(words, pos, pattern, nbits);
+}
+
+/* Copy nbits bits from src at src_pos to dest at dest_pos a word at a time.
+ * Like memmove the ranges may overlap. */
+inline void bit_array_copy_bits(bit_array_word* dest, size_t dest_pos,
+                                const bit_array_word* src, size_t src_pos, size_t nbits) {
+  if (dest == src && dest_pos > src_pos && dest_pos < src_pos+nbits) {
+    // Copy from the end so nothing is overwritten before it is read
+    while (nbits) {
+      size_t n = std::min(nbits, (size_t)BIT_ARRAY_WORD_BITS);
+      nbits -= n;
+      bit_array_store_bits(dest, dest_pos+nbits, bit_array_load_bits(src, src_pos+nbits, n), n);
+    }
+    return;
+  }
+  for (size_t done = 0; done < nbits; ) {
+    size_t n = std::min(nbits-done, (size_t)BIT_ARRAY_WORD_BITS);
+    bit_array_store_bits(dest, dest_pos+done, bit_array_load_bits(src, src_pos+done, n), n);
+    done += n;
+  }
+}
+
 /* Underlying type for arrays of sub-byte elements.
  * The array is represented as a C++ array of "words", a larger type chosen for efficiency.
  * (The bit_array_word type, defined in configure_clasp.h.)
@@ -199,6 +199,9 @@ struct BucketsBase : public WeakObject {
     return this->_deleted.unsafe_fixnum();
   };
   void setDeleted(int val) { this->_deleted = gctools::make_tagged_fixnum<core::Fixnum_I>(val); };
+  bool weakp() const { return this->kind() == WeakBucketKind; };
+  /*! Set through the Buckets<T,U,Link> that this really is */
+  void set(size_t idx, const value_type &val);
 };
 
 template <class T, class U, class Link>
@@ -211,6 +214,12 @@ inline bool unboundOrDeletedOrSplatted(core::T_sp bucket) {
           || !bucket           // splatted by Boehm
           );
 }
+
+/*! Only buckets that hold a pointer to an object have a disappearing link,
+    immediates and the no_key marker (see weak_bucket_encode) never go away */
+inline bool weakLinkedp(core::T_sp bucket) {
+  return bucket.objectp() && !bucket.no_keyp() && !unboundOrDeletedOrSplatted(bucket);
+}
 #endif
 
 template <class T, class U>
@@ -220,7 +229,7 @@ struct Buckets<T, U, WeakLinks> : public BucketsBase<T, U> {
   virtual ~Buckets() {
 #ifdef USE_BOEHM
     for (size_t i(0), iEnd(this->length()); i < iEnd; ++i) {
-      if (!unboundOrDeletedOrSplatted(this->bucket[i])) {
+      if (weakLinkedp(this->bucket[i])) {
         //		    printf("%s:%d Buckets dtor idx: %zu unregister disappearing link @%p\n", __FILE__, __LINE__, i, &this->bucket[i].rawRef_());
         int result = GC_unregister_disappearing_link(reinterpret_cast<void **>(&this->bucket[i].rawRef_()));
         if (!result) {
@@ -233,13 +242,9 @@ struct Buckets<T, U, WeakLinks> : public BucketsBase<T, U> {
   }
 
   void set(size_t idx, const value_type &val) {
-    if (!val.objectp()) {
-      printf("%s:%d Only  objectp() objects can be added to Mapping\n", __FILE__, __LINE__);
-      abort();
-    }
 #ifdef USE_BOEHM
     //	    printf("%s:%d ---- Buckets set idx: %zu   this->bucket[idx] = %p\n", __FILE__, __LINE__, idx, this->bucket[idx].raw_() );
-    if (!unboundOrDeletedOrSplatted(this->bucket[idx])) {
+    if (weakLinkedp(this->bucket[idx])) {
       auto &rawRef = this->bucket[idx].rawRef_();
       void **linkAddress = reinterpret_cast<void **>(&rawRef);
       //		printf("%s:%d Buckets set idx: %zu unregister disappearing link @%p\n", __FILE__, __LINE__, idx, linkAddress );
@@ -248,7 +253,7 @@ struct Buckets<T, U, WeakLinks> : public BucketsBase<T, U> {
         throw_hard_error("The link was not registered as a disappearing link!");
       }
     }
-    if (!unboundOrDeletedOrSplatted(val)) {
+    if (weakLinkedp(val)) {
       this->bucket[idx] = val;
       //		printf("%s:%d Buckets set idx: %zu register disappearing link @%p\n", __FILE__, __LINE__, idx, &this->bucket[idx].rawRef_());
       GCTOOLS_ASSERT(val.objectp());
@@ -282,47 +287,88 @@ typedef gctools::smart_ptr<core::T_O> BucketValueType;
 #endif
 typedef gctools::Buckets<BucketValueType, BucketValueType, gctools::WeakLinks> WeakBucketsObjectType;
 typedef gctools::Buckets<BucketValueType, BucketValueType, gctools::StrongLinks> StrongBucketsObjectType;
+typedef gctools::BucketsBase<BucketValueType, BucketValueType> BucketsObjectType;
+
+template <class T, class U>
+inline void BucketsBase<T, U>::set(size_t idx, const value_type &val) {
+  if (this->weakp())
+    static_cast<Buckets<T, U, WeakLinks> *>(this)->set(idx, val);
+  else
+    static_cast<Buckets<T, U, StrongLinks> *>(this)->set(idx, val);
+}
+
+/*! Fixnum 0 has the same bits as the NULL that Boehm writes into a disappearing
+    link when the object dies, so it is stored in buckets as the no_key marker. */
+inline BucketValueType weak_bucket_encode(core::T_sp obj) {
+  if (obj.raw_() == 0) return BucketValueType(gctools::make_tagged_no_key<core::T_O>());
+  return BucketValueType(obj);
+}
+
+inline core::T_sp weak_bucket_decode(const BucketValueType &bucket) {
+  if (bucket.no_keyp()) return gctools::make_tagged_fixnum<core::T_O>(0);
+  return core::T_sp(bucket);
+}
 
+/*! What keeps an entry of a weak hash table alive.
+    WeakKey and WeakKeyAndValue entries go away when the key (or either) is collected,
+    WeakValue entries when the value is. Neither collector can see through an entry
+    to decide WeakKeyOrValue, so make-hash-table rejects it. */
+typedef enum { WeakKey, WeakValue, WeakKeyAndValue, WeakKeyOrValue } WeakTableKind;
+typedef enum { WeakTestEq, WeakTestEql, WeakTestEqual, WeakTestEqualp } WeakTableTest;
+
+/*! Open addressed hash table whose keys, values or both are held by weak links.
+    The name is historical - _Weakness says which side is weak and _Test which
+    equality the keys are compared with.  Entries whose weak side was collected
+    are turned into deleted entries when a probe under the write lock runs into
+    them (see find_no_lock) and are dropped when the table is rehashed. */
 class WeakKeyHashTable {
   friend class core::WeakKeyHashTable_O;
 
 public:
   typedef BucketValueType value_type;
-  typedef WeakBucketsObjectType KeyBucketsType;
-  typedef StrongBucketsObjectType ValueBucketsType;
+  typedef BucketsObjectType KeyBucketsType;
+  typedef BucketsObjectType ValueBucketsType;
 
 public:
   typedef WeakKeyHashTable MyType;
 
-public:
-  typedef gctools::GCBucketAllocator<KeyBucketsType> KeyBucketsAllocatorType;
-  typedef gctools::GCBucketAllocator<ValueBucketsType> ValueBucketsAllocatorType;
-
 public:
   core::Number_sp _RehashSize;
   double _RehashThreshold;
   size_t _Length;
+  WeakTableKind _Weakness;
+  WeakTableTest _Test;
   gctools::tagged_pointer<KeyBucketsType> _Keys;     // hash buckets for keys
   gctools::tagged_pointer<ValueBucketsType> _Values; // hash buckets for values
 #ifdef CLASP_THREADS
     mutable mp::SharedMutex_sp _Mutex;
 #endif
 public:
-  WeakKeyHashTable(size_t length, core::Number_sp rehashSize, double rehashThreshold) : _Length(length), _RehashSize(rehashSize), _RehashThreshold(rehashThreshold) {};
+  WeakKeyHashTable(size_t length, core::Number_sp rehashSize, double rehashThreshold,
+                   WeakTableKind weakness = WeakKey, WeakTableTest test = WeakTestEq)
+    : _RehashSize(rehashSize), _RehashThreshold(rehashThreshold), _Length(length),
+      _Weakness(weakness), _Test(test) {};
   void initialize();
 public:
-  static uint sxhashKey(const value_type &key);
+  bool weakKeysp() const { return this->_Weakness == WeakKey || this->_Weakness == WeakKeyAndValue; };
+  bool weakValuesp() const { return this->_Weakness == WeakValue || this->_Weakness == WeakKeyAndValue; };
+  uint sxhashKey(core::T_sp key) const;
+  bool keyTest(core::T_sp entryKey, core::T_sp searchKey) const;
+  /*! True if the key and value, each loaded once from their buckets, are an entry
+      whose weak side has not been collected.  Boehm can clear a disappearing link
+      at any time, so test and decode the same loaded values rather than reading
+      a bucket again. */
+  static bool liveEntryp(const value_type& key, const value_type& value);
+  /*! Turn the entry at idx into a deleted entry */
+  static void deleteEntry(gctools::tagged_pointer<KeyBucketsType> keys, size_t idx);
 
   /*! Return 0 if there is no more room in the sequence of entries for the key
 	  Return 1 if the element is found or an unbound or deleted entry is found.
-	  Return the entry index in (b)
+	  Return the entry index in (b).
+          If cleanup is true (the caller holds the write lock) dead entries that
+          the probe passes over are deleted.
 	*/
-  static size_t find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, const value_type &key, size_t &b
-#ifdef DEBUG_FIND
-                  ,
-                  bool debugFind = false, stringstream *reportP = NULL
-#endif
-                  );
+  size_t find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, core::T_sp key, size_t &b, bool cleanup) const;
 
 public:
   void setupThreadSafeHashTable();
@@ -362,20 +408,24 @@ public:
     return fp;
   }
 
+  /*! Count the live entries.  This scans the whole table: the collector drops
+      entries without telling the table, so there is no live count to keep and
+      used-deleted overcounts until later probes delete the dead entries. */
   int tableSize() const {
     int result;
     safeRun<void()>([&result, this]() -> void {
-                    size_t used, deleted;
-                    used = this->_Keys->used();
-                    deleted = this->_Keys->deleted();
-                    GCTOOLS_ASSERT(used >= deleted);
-                    result = used - deleted;
+                    result = 0;
+                    for (size_t i = 0, iEnd(this->_Keys->length()); i < iEnd; ++i) {
+                      value_type k = (*this->_Keys)[i];
+                      value_type v = (*this->_Values)[i];
+                      if (liveEntryp(k, v)) ++result;
+                    }
     });
     return result;
   }
 
-  int rehash_not_safe( const value_type &key, size_t &key_bucket);
-  int rehash(const value_type &key, size_t &key_bucket);
+  int rehash_not_safe( core::T_sp key, size_t &key_bucket);
+  int rehash(core::T_sp key, size_t &key_bucket);
   int trySet(core::T_sp tkey, core::T_sp value);
 
   string dump(const string &prefix);
@@ -1,407 +1,113 @@
 #ifndef telemetry_H
 #define telemetry_H
 
-#include <cstddef>
-#include <stdio.h>
-#include <vector>
-#include <sstream>
-#include <map>
-#include <cstring>
-#include <string>
-namespace telemetry {
-
-typedef uintptr_t Handle;
-typedef uintptr_t Word;
-constexpr int StringBufferSize = 256;
-constexpr Handle label_undefined = 0; // must be zero
-constexpr Handle label_allocation = 1;
-constexpr Handle label_obj_pad = 2;
-constexpr Handle label_obj_scan_start = 3;
-constexpr Handle label_obj_scan = 4;
-constexpr Handle label_obj_isfwd_true = 5;
-constexpr Handle label_obj_isfwd_false = 6;
-constexpr Handle label_obj_skip = 7;
-constexpr Handle label_obj_fwd = 8;
-constexpr Handle label_obj_finalize = 9;
-constexpr Handle label_root_scan_start = 10;
-constexpr Handle label_root_scan_stop = 11;
-constexpr Handle label_smart_ptr_fix = 12;
-constexpr Handle label_tagged_pointer_fix = 13;
-constexpr Handle label_msg = 14;
-constexpr Handle label_stack_frame_scan_start = 15;
-constexpr Handle label_stack_frame_scan = 16;
-constexpr Handle label_stack_frame_skip = 17;
-constexpr Handle label_stack_frame_pad = 18;
-constexpr Handle label_stack_push_prepare = 19;
-constexpr Handle label_stack_push = 20;
-constexpr Handle label_stack_allocate = 21;
-constexpr Handle label_stack_pop = 22;
-constexpr Handle label_obj_deallocate_unmanaged_instance = 23;
- constexpr Handle label_cons_allocation = 24;
- constexpr Handle  label_cons_pad = 25;
- constexpr Handle  label_cons_scan_start = 26;
- constexpr Handle  label_cons_scan = 27;
- constexpr Handle  label_cons_isfwd_true = 28;
- constexpr Handle  label_cons_isfwd_false = 29;
- constexpr Handle  label_cons_skip = 30;
- constexpr Handle  label_cons_fwd = 31;
-
-struct Telemetry {
-  typedef size_t Header;
-  typedef size_t Handle;
-  bool _Write;
-  FILE *_File;
-  size_t _Index;
-  size_t _ThisRecordPos;
-  size_t _Mask;
-  std::vector<std::string> _Labels;
-  std::map<std::string, Handle> _LabelsToHandles;
-
-  const Header intern_header = 0xBEF4;
-  const Header data_header = 0xDADA;
-  static const size_t GC_telemetry = 0x01;
-  static const size_t STACK_telemetry = 0x02;
-  static const size_t Message_telemetry = 0x04;
+/*! Event telemetry
 
-Telemetry() : _Write(false), _File(NULL), _ThisRecordPos(0), _Mask(0) {
-    this->initialize();
-  }
+    Every thread records fixed size, timestamped Events into its own Ring.
+    A Ring has a single producer (the thread that owns it) and a single consumer
+    (the flusher thread) so recording an event is a couple of relaxed loads,
+    a clock read and a store - no locks.  If the flusher falls behind the ring is
+    full and events are counted as dropped rather than blocking the program.
 
-  void open_write(const char *file_name) {
-    this->_File = fopen(file_name, "wb");
-    this->_Write = true;
-  }
+    The flusher thread periodically drains every ring into a binary trace file:
 
-  void open_read(const char *file_name) {
-    this->_File = fopen(file_name, "rb");
-    this->_Write = false;
-  }
+      FileHeader
+      records, each a RecordHeader followed by _Size bytes
+        record_event_name    uint32 event type, then the name bytes
+        record_events        uint64 thread id, uint64 events dropped, Event[]
 
-  void initialize();
+    core:telemetry-to-chrome-json converts a trace file into Chrome trace-event JSON.
 
-  void set_mask(size_t mask) {
-    this->_Mask = mask;
-  }
+    Event types below event_first_user are recorded by the runtime (GC, JIT compiles,
+    lock waits and generic function dispatch misses) and are available to Lisp as the
+    constants core:+telemetry-event-gc+ and so on.  The rest are defined from Lisp
+    with core:telemetry-define-event.
+*/
 
-  void flush() {
-    if (this->_File)
-      fflush(this->_File);
-  }
-
-  void close() {
-    if (this->_File)
-      fclose(this->_File);
-  }
-
-  Handle intern(const std::string &label, size_t predefined_handle = 0) {
-    std::map<std::string, Handle>::iterator it = this->_LabelsToHandles.find(label);
-    if (label.size() >= StringBufferSize) {
-      printf("%s:%d The internd string is too long: %s\n", __FILE__, __LINE__, label.c_str());
-      abort();
-    }
-    Handle handle;
-    if (it == this->_LabelsToHandles.end()) {
-      handle = this->_Labels.size();
-      this->_LabelsToHandles[label] = handle;
-      this->_Labels.push_back(std::string(label));
-      if (predefined_handle == 0 && this->_Write) {
-        this->write_header(intern_header);
-        this->write_label(label);
-        this->write_footer();
-      }
-    } else {
-      handle = it->second;
-    }
-    if (predefined_handle != 0 && handle != predefined_handle) {
-      printf("%s:%d The predefined_handle[%lu] doesn't match the handle[%lu] assigned - they must match or telemetry won't work - this is for label: %s\n", __FILE__, __LINE__, predefined_handle, handle, label.c_str());
-      abort();
-    }
-    return handle;
-  }
-
-  void write_header(Header header) {
-    this->_ThisRecordPos = ftell(this->_File);
-    fwrite(&header, sizeof(Header), 1, this->_File);
-  }
+#include <cstdint>
+#include <atomic>
 
-  bool read_header(Header &header) {
-    this->_ThisRecordPos = ftell(this->_File);
-    ++this->_Index;
-    if (feof(this->_File)) {
-      printf("%s:%d Hit end of telemetry\n", __FILE__, __LINE__);
-      return false;
-    }
-    size_t read = fread(&header, sizeof(Header), 1, this->_File);
-    if (read != 1)
-      return false;
-    return true;
-  }
-
-  void write_footer() {
-    fwrite(&this->_ThisRecordPos, sizeof(this->_ThisRecordPos), 1, this->_File);
-  }
-
-  size_t read_footer() {
-    size_t prev;
-    fread(&prev, sizeof(this->_ThisRecordPos), 1, this->_File);
-    return prev;
-  }
-
-  void write_handle(Handle l) {
-    fwrite(&l, sizeof(l), 1, this->_File);
-  }
-
-  void read_handle(Handle &handle) {
-    fread(&handle, sizeof(handle), 1, this->_File);
-  }
-  void write_label(const std::string &label) {
-    size_t size = label.size();
-    std::stringstream buffer;
-    buffer << label << std::string(StringBufferSize, ' ');
-    fwrite(&size, sizeof(size_t), 1, this->_File);                  // number of bytes in string
-    fwrite(buffer.str().c_str(), StringBufferSize, 1, this->_File); // string without zero terminator
-  }
-
-  std::string read_label() {
-    size_t size;
-    fread(&size, sizeof(size_t), 1, this->_File); // read number of bytes in string
-    std::string s = std::string(StringBufferSize, ' ');
-    fread((void *)s.data(), StringBufferSize, 1, this->_File);
-    std::string label = s.substr(0, size);
-    return label;
-  }
+namespace telemetry {
 
-  std::string entry_as_string(Handle label, size_t num, Word data[]);
+typedef uint32_t EventType;
+constexpr EventType event_undefined = 0; // must be zero
+constexpr EventType event_gc = 1;
+constexpr EventType event_jit_compile = 2;
+constexpr EventType event_lock_wait = 3;
+constexpr EventType event_gf_miss = 4;
+constexpr EventType event_first_user = 16;
+constexpr EventType event_max = 256;
+
+typedef enum { phase_begin = 'B', phase_end = 'E', phase_instant = 'i' } EventPhase;
+
+struct Event {
+  uint64_t  _Timestamp;   // nanoseconds of CLOCK_MONOTONIC
+  uint32_t  _Type;
+  uint32_t  _Phase;
+  uint64_t  _Argument;
+};
 
-  void dump_entry_varargs(Handle label, size_t num, ... );
+#define TELEMETRY_RING_SIZE 4096   // Events - must be a power of two
 
-  void write(size_t kind, Handle label) {
-#ifdef DEBUG_TELEMETRY_DUMP
-    this->dump_entry_varargs(label,0);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 0;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      this->write_footer();
-    }
-  }
+struct Ring {
+  std::atomic<uint64_t>  _Head;    // Next event the owner writes
+  std::atomic<uint64_t>  _Tail;    // Next event the flusher reads
+  std::atomic<uint64_t>  _Dropped;
+  std::atomic<bool>      _InUse;
+  std::atomic<uint64_t>  _ThreadId;
+  Ring*                  _Next;
+  Event                  _Events[TELEMETRY_RING_SIZE];
+};
 
-  void write(size_t kind, Handle label, Word data0) {
-#ifdef DEBUG_TELEMETRY_DUMP
-    this->dump_entry_varargs(label,1,data0);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 1;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&data0, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+#define TELEMETRY_MAGIC 0x314d454c4554434c   // LCTELEM1
+#define TELEMETRY_VERSION 1
 
-  void write(size_t kind, Handle label, Word data0, Word data1) {
-#ifdef DEBUG_TELEMETRY_DUMP
-    this->dump_entry_varargs(label,2,data0,data1);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 2;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&data0, sizeof(Word), 1, this->_File);
-      fwrite(&data1, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+struct FileHeader {
+  uint64_t  _Magic;
+  uint64_t  _Version;
+  uint64_t  _ProcessId;
+};
 
-  void write(size_t kind, Handle label, Word data0, const std::string &msg) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,1,data0);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 2;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&data0, sizeof(Word), 1, this->_File);
-      Word data1 = 0;
-      int i;
-      for (i = 0; i < sizeof(Word) - 1; ++i) {
-        ((char *)(&data1))[i] = msg[i];
-      }
-      fwrite(&data1, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+typedef enum { record_event_name = 1, record_events = 2 } RecordKind;
 
-  void write(size_t kind, Handle label, Word data0, Word data1, Word data2) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,3,data0,data1,data2);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 3;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&data0, sizeof(Word), 1, this->_File);
-      fwrite(&data1, sizeof(Word), 1, this->_File);
-      fwrite(&data2, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+struct RecordHeader {
+  uint32_t  _Kind;
+  uint32_t  _Size;
+};
 
-  void write(size_t kind, Handle label, Word d0, Word d1, Word d2, Word d3) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,4,d0,d1,d2,d3);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 4;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&d0, sizeof(Word), 1, this->_File);
-      fwrite(&d1, sizeof(Word), 1, this->_File);
-      fwrite(&d2, sizeof(Word), 1, this->_File);
-      fwrite(&d3, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+extern std::atomic<bool> global_telemetry_on;
+extern std::atomic<bool> global_telemetry_enabled[event_max];
 
-  void write(size_t kind, Handle label, Word d0, Word d1, Word d2, Word d3, Word d4) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,5,d0,d1,d2,d3,d4);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 5;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&d0, sizeof(Word), 1, this->_File);
-      fwrite(&d1, sizeof(Word), 1, this->_File);
-      fwrite(&d2, sizeof(Word), 1, this->_File);
-      fwrite(&d3, sizeof(Word), 1, this->_File);
-      fwrite(&d4, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+/*! Every thread that records events calls this when it starts, so that the
+    ring it claims later is given back when it exits */
+void register_thread();
 
-  void write(size_t kind, Handle label, Word d0, Word d1, Word d2, Word d3, Word d4, Word d5) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,6,d0,d1,d2,d3,d4,d5);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 6;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&d0, sizeof(Word), 1, this->_File);
-      fwrite(&d1, sizeof(Word), 1, this->_File);
-      fwrite(&d2, sizeof(Word), 1, this->_File);
-      fwrite(&d3, sizeof(Word), 1, this->_File);
-      fwrite(&d4, sizeof(Word), 1, this->_File);
-      fwrite(&d5, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+/*! Record an event in the ring of the calling thread.
+    If may_allocate is false the event is dropped rather than allocating a ring -
+    this is for callers like the collector that must not call malloc. */
+void record_event(EventType type, EventPhase phase, uint64_t argument, bool may_allocate);
 
-  void write(size_t kind, Handle label, Word d0, Word d1, Word d2, Word d3, Word d4, Word d5, Word d6) {
-#ifdef DEBUG_TELEMETRY_DUMP
-      this->dump_entry_varargs(label,7,d0,d1,d2,d3,d4,d5,d6);
-#endif
-    if ((this->_Mask & kind) && this->_File) {
-      this->write_header(data_header);
-      this->write_handle(label);
-      size_t size = 7;
-      fwrite(&size, sizeof(size_t), 1, this->_File);
-      fwrite(&d0, sizeof(Word), 1, this->_File);
-      fwrite(&d1, sizeof(Word), 1, this->_File);
-      fwrite(&d2, sizeof(Word), 1, this->_File);
-      fwrite(&d3, sizeof(Word), 1, this->_File);
-      fwrite(&d4, sizeof(Word), 1, this->_File);
-      fwrite(&d5, sizeof(Word), 1, this->_File);
-      fwrite(&d6, sizeof(Word), 1, this->_File);
-      this->write_footer();
-    }
-  }
+inline bool event_enabled(EventType type) {
+  return global_telemetry_on.load(std::memory_order_relaxed)
+    && global_telemetry_enabled[type].load(std::memory_order_relaxed);
+}
 
-  bool process_header(Header header) {
-    if (header == intern_header) {
-      std::string label = this->read_label();
-      this->read_footer();
-      this->intern(label.c_str());
-      return true;
-    } else if (header == data_header) {
-      return false;
-    }
-    printf("%s:%d What do I do here?\n", __FILE__, __LINE__ );
-    abort();
-  }
+inline void event(EventType type, EventPhase phase, uint64_t argument = 0) {
+  if (__builtin_expect(event_enabled(type),0)) record_event(type,phase,argument,true);
+}
 
-  // Return false if no more record are available
-  size_t read_data(Handle &label, size_t num, Word *words) {
-    fread(&label, sizeof(Handle), 1, this->_File);
-    size_t real_num;
-    fread(&real_num, sizeof(size_t), 1, this->_File);
-    size_t read_num = (real_num < num) ? real_num : num;
-    // Read what will fit.
-    fread(words, sizeof(Word), read_num, this->_File);
-    // Read the rest of them
-    for (int i(read_num); i < real_num; ++i) {
-      Word dummy;
-      fread(&dummy, sizeof(size_t), 1, this->_File);
-    }
-    this->read_footer();
-    return read_num;
+/*! Records a begin event on construction and an end event on destruction */
+struct ScopedEvent {
+  EventType _Type;
+  bool      _Recorded;
+  ScopedEvent(EventType type, uint64_t argument = 0) : _Type(type), _Recorded(event_enabled(type)) {
+    if (__builtin_expect(this->_Recorded,0)) record_event(type,phase_begin,argument,true);
   }
-
-  void seek0() {
-    fseek(this->_File, 0, SEEK_SET);
-    this->_Index = 0;
+  ~ScopedEvent() {
+    if (__builtin_expect(this->_Recorded,0)) record_event(this->_Type,phase_end,0,true);
   }
 };
 
-extern char *global_clasp_telemetry_file;
-extern Telemetry *global_telemetry_search;
-
-void initialize_telemetry_functions();
- extern "C" {
- extern void global_telemetry_flush();
 };
 
-#if defined(DEBUG_TELEMETRY) || defined(DEBUG_STACK_TELEMETRY)
-#define TELEMETRY_FLUSH() telemetry::global_telemetry_flush();
-#else
-#define TELEMETRY_FLUSH()
-#endif
-
-#ifdef DEBUG_TELEMETRY
-#define GC_TELEMETRY0(label) telemetry::global_telemetry_search->write(telemetry::Telemetry::GC_telemetry, label)
-#define GC_TELEMETRY1(label, arg0) telemetry::global_telemetry_search->write(telemetry::Telemetry::GC_telemetry, label, (uintptr_t)arg0)
-#define GC_TELEMETRY2(label, arg0, arg1) telemetry::global_telemetry_search->write(telemetry::Telemetry::GC_telemetry, label, (uintptr_t)arg0, (uintptr_t)arg1)
-#define GC_TELEMETRY3(label, arg0, arg1, arg2) telemetry::global_telemetry_search->write(telemetry::Telemetry::GC_telemetry, label, (uintptr_t)arg0, (uintptr_t)arg1, (uintptr_t)arg2)
-#define GC_TELEMETRY4(label, arg0, arg1, arg2, arg3) telemetry::global_telemetry_search->write(telemetry::Telemetry::GC_telemetry, label, (uintptr_t)arg0, (uintptr_t)arg1, (uintptr_t)arg2, (uintptr_t)arg3)
-#else
-#define GC_TELEMETRY0(label)
-#define GC_TELEMETRY1(label, arg0)
-#define GC_TELEMETRY2(label, arg0, arg1)
-#define GC_TELEMETRY3(label, arg0, arg1, arg2)
-#define GC_TELEMETRY4(label, arg0, arg1, arg2, arg3)
-#endif
-#ifdef DEBUG_STACK_TELEMETRY
-#define STACK_TELEMETRY0(label) telemetry::global_telemetry_search->write(telemetry::Telemetry::STACK_telemetry, label)
-#define STACK_TELEMETRY1(label, arg0) telemetry::global_telemetry_search->write(telemetry::Telemetry::STACK_telemetry, label, (uintptr_t)arg0)
-#define STACK_TELEMETRY2(label, arg0, arg1) telemetry::global_telemetry_search->write(telemetry::Telemetry::STACK_telemetry, label, (uintptr_t)arg0, (uintptr_t)arg1)
-#define STACK_TELEMETRY3(label, arg0, arg1, arg2) telemetry::global_telemetry_search->write(telemetry::Telemetry::STACK_telemetry, label, (uintptr_t)arg0, (uintptr_t)arg1, (uintptr_t)arg2)
-#define STACK_TELEMETRY7(label, a0, a1, a2, a3, a4, a5, a6) telemetry::global_telemetry_search->write(telemetry::Telemetry::STACK_telemetry, label, (uintptr_t)a0, (uintptr_t)a1, (uintptr_t)a2, (uintptr_t)a3, (uintptr_t)a4, (uintptr_t)a5, (uintptr_t)a6)
-#else
-#define STACK_TELEMETRY0(label)
-#define STACK_TELEMETRY1(label, arg0)
-#define STACK_TELEMETRY2(label, arg0, arg1)
-#define STACK_TELEMETRY3(label, arg0, arg1, arg2)
-#define STACK_TELEMETRY7(label, a0, a1, a2, a3, a4, a5, a6)
-#endif
-};
 #endif
@@ -8,6 +8,11 @@ namespace gctools {
 
   extern "C" void HitAllocationSizeThreshold();
   extern "C" void HitAllocationNumberThreshold();
+  extern "C" void HitAllocationSampleThreshold(stamp_t stamp, size_t size);
+
+  /*! Bytes a thread allocates between checks of the sampling allocation
+      profiler when it is switched off. */
+#define ALLOCATION_SAMPLE_IDLE_BYTES (16*1024*1024)
 
   extern void monitorAllocation(stamp_t k, size_t sz);
   extern void count_allocation(const stamp_t k);
@@ -35,6 +40,8 @@ namespace gctools {
    std::atomic<int64_t> _HitAllocationSizeCounter;
    size_t               _AllocationNumberThreshold;
    size_t               _AllocationSizeThreshold;
+   /*! Bytes left until the sampling allocation profiler takes the next sample */
+   int64_t              _AllocationSampleCountdown;
 #ifdef DEBUG_MONITOR_ALLOCATIONS
    MonitorAllocations _Monitor;
 #endif
@@ -44,16 +51,25 @@ namespace gctools {
    , _AllocationNumberThreshold(16386)
      , _HitAllocationNumberCounter(0)
      , _HitAllocationSizeCounter(0)
+     , _AllocationSampleCountdown(ALLOCATION_SAMPLE_IDLE_BYTES)
    {};
  GlobalAllocationProfiler(size_t size, size_t number) : _AllocationSizeThreshold(size), _AllocationNumberThreshold(number)
      , _HitAllocationNumberCounter(0)
      , _HitAllocationSizeCounter(0)
+     , _AllocationSampleCountdown(ALLOCATION_SAMPLE_IDLE_BYTES)
    {};
     
    inline void registerAllocation(stamp_t stamp, size_t size) {
      this->_BytesAllocated += size;
      this->_AllocationSizeCounter += size;
      this->_AllocationNumberCounter++;
+     // The sampling profiler costs one subtract and compare per allocation.
+     // When it is off the countdown is reloaded with ALLOCATION_SAMPLE_IDLE_BYTES
+     // so that every thread notices within that many bytes when it is switched on.
+     this->_AllocationSampleCountdown -= size;
+     if (__builtin_expect(this->_AllocationSampleCountdown<0,0)) {
+       HitAllocationSampleThreshold(stamp,size);
+     }
 #if defined(DEBUG_COUNT_ALLOCATIONS) && defined(DEBUG_SLOW)
     gctools::count_allocation(stamp);
 #endif
@@ -66,6 +66,8 @@ THE SOFTWARE.
 #include <llvm/IR/Constants.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/LazyReexports.h>
 #include <llvm/ExecutionEngine/Orc/IRTransformLayer.h>
 #include <llvm/ExecutionEngine/Orc/LambdaResolver.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
@@ -4675,6 +4677,8 @@ struct ObjectFileInfo {
 };
 
 FORWARD(ClaspJIT);
+class ClaspObjectCache;
+
 class ClaspJIT_O : public core::General_O {
   LISP_CLASS(llvmo, LlvmoPkg, ClaspJIT_O, "clasp-jit", core::General_O);
 public:
@@ -4698,8 +4702,13 @@ public:
 #else
   llvm::orc::RTDyldObjectLinkingLayer *_LinkLayer;
 #endif
+  ClaspObjectCache* _ObjectCache;
   llvm::orc::ConcurrentIRCompiler *_Compiler;
   llvm::orc::IRCompileLayer *_CompileLayer;
+  /*! Modules added while llvm-sys:*jit-lazy* is true go through the _CODLayer,
+      it compiles functions the first time they are called through a stub */
+  std::unique_ptr<llvm::orc::LazyCallThroughManager> _LazyCallThroughManager;
+  llvm::orc::CompileOnDemandLayer *_CODLayer;
 };
 
 
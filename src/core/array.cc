@@ -583,8 +583,6 @@ CL_DEFUN T_sp core__PERCENTdisplaced_index_offset(MDArray_sp array) {
 }
 
 void core__copy_subarray(Array_sp dest, Fixnum_sp destStart, Array_sp orig, Fixnum_sp origStart, Fixnum_sp len) {
-  // TODO: THIS NEEDS TO BE OPTIMIZED FOR DIFFERENT TYPES OF ARRAYS!!!!!!!
-  //       Currently this is very inefficient
   size_t iLen = unbox_fixnum(len);
   if (iLen == 0)
     return;
@@ -594,6 +592,14 @@ void core__copy_subarray(Array_sp dest, Fixnum_sp destStart, Array_sp orig, Fixn
   size_t iOrigStart = unbox_fixnum(origStart);
   if ((iLen + iDestStart) >= dest->arrayTotalSize()) iLen = dest->arrayTotalSize()-iDestStart;
   if ((iLen + iOrigStart) >= orig->arrayTotalSize()) iLen = orig->arrayTotalSize()-iOrigStart;
+  // Look through displacement, if both arrays are backed by the same kind of
+  // simple vector the storage is copied in bulk
+  AbstractSimpleVector_sp destVector, origVector;
+  size_t destOffset, origOffset, ignoreEnd;
+  dest->asAbstractSimpleVectorRange(destVector,destOffset,ignoreEnd);
+  orig->asAbstractSimpleVectorRange(origVector,origOffset,ignoreEnd);
+  if (destVector->unsafe_copy_range(destOffset+iDestStart,origVector,origOffset+iOrigStart,iLen))
+    return;
   if (iDestStart < iOrigStart) {
     for (size_t i = 0; i < iLen; ++i) {
       dest->rowMajorAset(iDestStart, orig->rowMajorAref(iOrigStart));
@@ -7,6 +7,7 @@
 
 #include <clasp/core/foundation.h>
 #include <clasp/core/array.h>
+#include <clasp/core/bits.h>
 
 namespace core {
 void bitVectorDoesntSupportError() {
@@ -54,6 +55,42 @@ bool SimpleBitVector_O::equal(T_sp other) const {
   return false;
 }
 
+/* Bit vectors store element 0 in the most significant bit of the first word.
+ * Mask of the bits of word w that are within [start,end) */
+static inline bit_array_word bit_range_mask(size_t w, size_t start, size_t end) {
+  size_t lo = (w == start/BIT_ARRAY_WORD_BITS) ? start%BIT_ARRAY_WORD_BITS : 0;
+  size_t hi = (w == (end-1)/BIT_ARRAY_WORD_BITS) ? (end-1)%BIT_ARRAY_WORD_BITS+1 : BIT_ARRAY_WORD_BITS;
+  return (~(bit_array_word)0 >> lo) & (~(bit_array_word)0 << (BIT_ARRAY_WORD_BITS-hi));
+}
+
+Fixnum bit_vector_position(const bit_array_word* words, bool bit, size_t start, size_t end, bool from_end) {
+  if (start >= end) return -1;
+  const bit_array_word flip = bit ? 0 : ~(bit_array_word)0;
+  size_t first = start/BIT_ARRAY_WORD_BITS, last = (end-1)/BIT_ARRAY_WORD_BITS;
+  if (from_end) {
+    for (size_t w = last+1; w > first; --w) {
+      bit_array_word x = (words[w-1]^flip) & bit_range_mask(w-1, start, end);
+      if (x) return (w-1)*BIT_ARRAY_WORD_BITS + (BIT_ARRAY_WORD_BITS-1) - bit_array_word_ctz(x);
+    }
+  } else {
+    for (size_t w = first; w <= last; ++w) {
+      bit_array_word x = (words[w]^flip) & bit_range_mask(w, start, end);
+      if (x) return w*BIT_ARRAY_WORD_BITS + bit_array_word_clz(x);
+    }
+  }
+  return -1;
+}
+
+size_t bit_vector_count_ones(const bit_array_word* words, size_t start, size_t end) {
+  if (start >= end) return 0;
+  size_t first = start/BIT_ARRAY_WORD_BITS, last = (end-1)/BIT_ARRAY_WORD_BITS;
+  if (first == last) return bit_array_word_popcount(words[first] & bit_range_mask(first, start, end));
+  size_t count = bit_array_word_popcount(words[first] & bit_range_mask(first, start, end));
+  for (size_t w = first+1; w < last; ++w) count += bit_array_word_popcount(words[w]);
+  return count + bit_array_word_popcount(words[last] & bit_range_mask(last, start, end));
+}
+
+
 // The division is length/BIT_ARRAY_WORD_BITS, but rounding up.
 #define DEF_SBV_BIT_OP(name, form)\
   CL_DEFUN SimpleBitVector_sp core__sbv_bit_##name(SimpleBitVector_sp a, SimpleBitVector_sp b,\
@@ -75,6 +112,93 @@ DEF_SBV_BIT_OP(andc2, ab[i] & ~(bb[i]))
 DEF_SBV_BIT_OP(orc1, ~(ab[i]) | bb[i])
 DEF_SBV_BIT_OP(orc2, ab[i] | ~(bb[i]))
 
+/* Apply op word by word to length bits of a from a_start and b from b_start, storing
+ * into r from r_start.  When all three offsets are word aligned this is a plain loop
+ * over words that the compiler vectorizes, otherwise each word is assembled from two
+ * with bit_array_load_bits.  Only the bits in the range are changed in r. */
+template <typename Op>
+static void bit_array_op(Op op, const bit_array_word* a, size_t a_start, const bit_array_word* b, size_t b_start,
+                         bit_array_word* r, size_t r_start, size_t length) {
+  if (((a_start|b_start|r_start) % BIT_ARRAY_WORD_BITS) == 0) {
+    const bit_array_word* aw = a + a_start/BIT_ARRAY_WORD_BITS;
+    const bit_array_word* bw = b + b_start/BIT_ARRAY_WORD_BITS;
+    bit_array_word* rw = r + r_start/BIT_ARRAY_WORD_BITS;
+    size_t nwords = length/BIT_ARRAY_WORD_BITS;
+    for (size_t i = 0; i < nwords; ++i) rw[i] = op(aw[i], bw[i]);
+    size_t leftover = length%BIT_ARRAY_WORD_BITS;
+    if (leftover) gctools::bit_array_store_bits(rw, nwords*BIT_ARRAY_WORD_BITS, op(aw[nwords], bw[nwords]), leftover);
+    return;
+  }
+  for (size_t done = 0; done < length; ) {
+    size_t n = std::min(length-done, (size_t)BIT_ARRAY_WORD_BITS);
+    gctools::bit_array_store_bits(r, r_start+done,
+                                  op(gctools::bit_array_load_bits(a, a_start+done, n),
+                                     gctools::bit_array_load_bits(b, b_start+done, n)),
+                                  n);
+    done += n;
+  }
+}
+
+/* Working forward, writing r overwrites source bits that haven't been read yet if
+ * the source is the same vector and starts before r in the overlap. */
+static bool bit_array_op_clobbers(const bit_array_word* src, size_t src_start,
+                                  const bit_array_word* r, size_t r_start, size_t length) {
+  return src == r && src_start < r_start && r_start < src_start+length;
+}
+
+#define BIT_ARRAY_OP_CASE(name, form)\
+  case boole_##name:\
+      bit_array_op([](bit_array_word x, bit_array_word y) -> bit_array_word { return form; },\
+                   aw, a_start, bw, b_start, r->bytes(), r_start, length);\
+      break;
+
+CL_LAMBDA(op a a-start b b-start r r-start length);
+CL_DECLARE();
+CL_DOCSTRING("Store the BOOLE operation OP on LENGTH bits of the simple bit vectors A and B, starting at A-START and B-START, into the simple bit vector R starting at R-START. The offsets need not be word aligned and R may be A or B.");
+CL_DEFUN SimpleBitVector_sp core__sbv_bit_array_op(Fixnum op, SimpleBitVector_sp a, size_t a_start,
+                                                   SimpleBitVector_sp b, size_t b_start,
+                                                   SimpleBitVector_sp r, size_t r_start, size_t length) {
+  if (a_start+length > a->length() || b_start+length > b->length() || r_start+length > r->length())
+    SIMPLE_ERROR(BF("Bit array operation on %d bits is out of bounds") % length);
+  const bit_array_word* aw = a->bytes();
+  const bit_array_word* bw = b->bytes();
+  std::vector<bit_array_word> a_copy, b_copy;
+  if (bit_array_op_clobbers(aw, a_start, r->bytes(), r_start, length)) {
+    a_copy.resize(length/BIT_ARRAY_WORD_BITS+1);
+    gctools::bit_array_copy_bits(a_copy.data(), 0, aw, a_start, length);
+    aw = a_copy.data();
+    a_start = 0;
+  }
+  if (bit_array_op_clobbers(bw, b_start, r->bytes(), r_start, length)) {
+    b_copy.resize(length/BIT_ARRAY_WORD_BITS+1);
+    gctools::bit_array_copy_bits(b_copy.data(), 0, bw, b_start, length);
+    bw = b_copy.data();
+    b_start = 0;
+  }
+  switch (op) {
+    BIT_ARRAY_OP_CASE(clr, 0);
+    BIT_ARRAY_OP_CASE(set, ~(bit_array_word)0);
+    BIT_ARRAY_OP_CASE(1, x);
+    BIT_ARRAY_OP_CASE(2, y);
+    BIT_ARRAY_OP_CASE(c1, ~x);
+    BIT_ARRAY_OP_CASE(c2, ~y);
+    BIT_ARRAY_OP_CASE(and, x & y);
+    BIT_ARRAY_OP_CASE(ior, x | y);
+    BIT_ARRAY_OP_CASE(xor, x ^ y);
+    BIT_ARRAY_OP_CASE(eqv, ~(x ^ y));
+    BIT_ARRAY_OP_CASE(nand, ~(x & y));
+    BIT_ARRAY_OP_CASE(nor, ~(x | y));
+    BIT_ARRAY_OP_CASE(andc1, ~x & y);
+    BIT_ARRAY_OP_CASE(andc2, x & ~y);
+    BIT_ARRAY_OP_CASE(orc1, ~x | y);
+    BIT_ARRAY_OP_CASE(orc2, x | ~y);
+  default:
+      TYPE_ERROR(clasp_make_fixnum(op),
+                 Cons_O::createList(cl::_sym_Integer_O, clasp_make_fixnum(0), clasp_make_fixnum(boolOpsMax-1)));
+  }
+  return r;
+}
+
 CL_DEFUN SimpleBitVector_sp core__sbv_bit_not(SimpleBitVector_sp vec, SimpleBitVector_sp res,
                                               size_t length) {
   bit_array_word *vecb, *resb;
@@ -101,7 +225,7 @@ CL_DEFUN SimpleBitVector_sp core__sbv_bit_not(SimpleBitVector_sp vec, SimpleBitV
     for (i = 0; i < nwords; ++i) { word = bytes[i]; statement}                         \
     i = nwords;                                                                        \
     if (leftover != 0) {                                                               \
-      bit_array_word mask = ((1 << leftover) - 1) << (BIT_ARRAY_WORD_BITS - leftover); \
+      bit_array_word mask = ~(bit_array_word)0 << (BIT_ARRAY_WORD_BITS - leftover);      \
       word = bytes[i] & mask;                                                          \
       statement}                                                                       \
   } while (0);
@@ -109,9 +233,7 @@ CL_DEFUN SimpleBitVector_sp core__sbv_bit_not(SimpleBitVector_sp vec, SimpleBitV
 // Population count for simple bit vector.
 CL_DEFUN Integer_sp core__sbv_popcnt(SimpleBitVector_sp vec) {
   ASSERT(sizeof(bit_array_word) == sizeof(unsigned long long)); // for popcount. FIXME
-  gctools::Fixnum result = 0;
-  DO_BIT_ARRAY_WORDS(vec, word, i, result += bit_array_word_popcount(word););
-  return make_fixnum(result);
+  return make_fixnum(bit_vector_count_ones(vec->bytes(), 0, vec->length()));
 }
 
 CL_DEFUN bool core__sbv_zerop(SimpleBitVector_sp vec) {
@@ -121,10 +243,8 @@ CL_DEFUN bool core__sbv_zerop(SimpleBitVector_sp vec) {
 
 // Returns the index of the first 1 in the bit vector, or NIL.
 CL_DEFUN T_sp core__sbv_position_one(SimpleBitVector_sp v) {
-  DO_BIT_ARRAY_WORDS(v, w, i,
-                     if (w != 0)
-                       return make_fixnum(i*BIT_ARRAY_WORD_BITS + bit_array_word_clz(w)););
-  return _Nil<T_O>();
+  Fixnum index = bit_vector_position(v->bytes(), true, 0, v->length(), false);
+  return (index < 0) ? _Nil<T_O>() : make_fixnum(index);
 }
 
 // The following SimpleBitVector_ functions are used in Cando.
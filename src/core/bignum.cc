@@ -82,6 +82,35 @@ Integer_sp bignum_result(mp_size_t len, const mp_limb_t* limbs) {
                                             std::abs(len), limbs);
 }
 
+#ifdef BIGNUM_FAST_PATH
+Integer_sp small_bignum_result(small_bignum_t magnitude, bool negative) {
+  mp_limb_t limbs[BIGNUM_SMALL_LIMBS];
+  mp_size_t len = small_bignum_limbs(limbs, magnitude, negative);
+  return bignum_result(len, limbs);
+}
+
+// Schoolbook multiplication of magnitudes of at most BIGNUM_SMALL_LIMBS limbs.
+// result must have room for lsize+rsize limbs. Returns the normalized size.
+static mp_size_t small_bignum_mul(mp_limb_t* result,
+                                  const mp_limb_t* llimbs, mp_size_t lsize,
+                                  const mp_limb_t* rlimbs, mp_size_t rsize) {
+  for (mp_size_t i = 0; i < lsize + rsize; ++i) result[i] = 0;
+  for (mp_size_t i = 0; i < lsize; ++i) {
+    mp_limb_t carry = 0;
+    for (mp_size_t j = 0; j < rsize; ++j) {
+      // (2^64-1)^2 + 2*(2^64-1) = 2^128-1, so this cannot overflow.
+      small_bignum_t t = (small_bignum_t)llimbs[i] * rlimbs[j] + result[i+j] + carry;
+      result[i+j] = (mp_limb_t)t;
+      carry = (mp_limb_t)(t >> 64);
+    }
+    result[i+rsize] = carry;
+  }
+  mp_size_t size = lsize + rsize;
+  BIGNUM_NORMALIZE(size, result);
+  return size;
+}
+#endif
+
 mpz_class Bignum_O::mpz() const {
   mp_size_t len = this->length();
   mpz_class m;
@@ -234,6 +263,13 @@ CL_DEFUN Integer_sp core__next_fmul(Bignum_sp left, Fixnum right) {
   mp_size_t result_len;
   mp_limb_t result_limbs[size+1];
   mp_limb_t carry;
+#ifdef BIGNUM_FAST_PATH
+  if (size <= BIGNUM_SMALL_LIMBS) {
+    mp_limb_t aright = std::abs(right);
+    size = small_bignum_mul(result_limbs, llimbs, size, &aright, 1);
+    return bignum_result(((llen < 0) ^ (right < 0)) ? -size : size, result_limbs);
+  }
+#endif
   // NOTE that std::abs will be undefined if the result isn't representable,
   // which will happen if right is INT_MIN or whatever. So this will break if
   // most_negative_fixnum is that negative (which it isn't hopefully).
@@ -257,6 +293,18 @@ CL_DEFUN Bignum_sp core__next_lshift(Bignum_sp num, Fixnum shift) {
   mp_size_t len = num->length();
   size_t size = std::abs(len);
   const mp_limb_t* limbs = num->limbs();
+#ifdef BIGNUM_FAST_PATH
+  if ((size <= BIGNUM_SMALL_LIMBS) && (0 < shift) && (shift < 128)) {
+    small_bignum_t magnitude = small_bignum_magnitude(limbs, size);
+    // Only if no bits are shifted out of the top.
+    if ((magnitude >> (128 - shift)) == 0) {
+      mp_limb_t result_limbs[BIGNUM_SMALL_LIMBS];
+      mp_size_t result_len = small_bignum_limbs(result_limbs, magnitude << shift, len < 0);
+      return Bignum_O::create_from_limbs(result_len, 0, false,
+                                         std::abs(result_len), result_limbs);
+    }
+  }
+#endif
   unsigned int nlimbs = shift / mp_bits_per_limb;
   unsigned int nbits = shift % mp_bits_per_limb;
   size_t result_size = size + nlimbs + 1;
@@ -284,6 +332,16 @@ CL_DEFUN Integer_sp core__next_rshift(Bignum_sp num, Fixnum shift) {
   mp_size_t len = num->length();
   size_t size = std::abs(len);
   const mp_limb_t* limbs = num->limbs();
+#ifdef BIGNUM_FAST_PATH
+  if (size <= BIGNUM_SMALL_LIMBS) {
+    if (shift >= 128) return clasp_make_fixnum((len < 0) ? -1 : 0);
+    small_bignum_t magnitude = small_bignum_magnitude(limbs, size);
+    if (len < 0)
+      // Rounds toward negative infinity, as below.
+      return small_bignum_result(((magnitude - 1) >> shift) + 1, true);
+    else return small_bignum_result(magnitude >> shift, false);
+  }
+#endif
   unsigned int nlimbs = shift / mp_bits_per_limb;
   unsigned int nbits = shift % mp_bits_per_limb;
   if (len < 0) {
@@ -337,6 +395,15 @@ CL_DEFUN Bignum_sp core__next_mul(Bignum_sp left, Bignum_sp right) {
   mp_size_t result_size = lsize + rsize;
   mp_limb_t result_limbs[result_size];
   mp_limb_t msl;
+#ifdef BIGNUM_FAST_PATH
+  if ((lsize <= BIGNUM_SMALL_LIMBS) && (rsize <= BIGNUM_SMALL_LIMBS)) {
+    result_size = small_bignum_mul(result_limbs, llimbs, lsize, rlimbs, rsize);
+    return Bignum_O::create_from_limbs(((llen < 0) ^ (rlen < 0))
+                                       ? -result_size : result_size,
+                                       0, false,
+                                       result_size, result_limbs);
+  }
+#endif
   // "This function requires that s1n is greater than or equal to s2n."
   if (rsize > lsize)
     msl = mpn_mul(result_limbs, rlimbs, rsize, llimbs, lsize);
@@ -358,10 +425,14 @@ CL_DEFUN Bignum_sp core__mul_fixnums(Fixnum left, Fixnum right) {
   } else {
     llen = 1; limbs[0] = left;
   }
+#ifdef BIGNUM_FAST_PATH
+  result_size = std::abs(small_bignum_limbs(limbs, (small_bignum_t)limbs[0] * (mp_limb_t)std::abs(right), false));
+#else
   // Reusing the storage here is ok, according to docs,
   // provided that result_limbs <= input_limbs (as here).
   mp_limb_t msl = mpn_mul_1(limbs, limbs, 1, std::abs(right));
   if (msl == 0) --result_size; else limbs[1] = msl;
+#endif
   // We unconditionally return a bignum because this is only called
   // from contagion_mul in the case that multiplication is known to
   // overflow.
@@ -672,6 +743,21 @@ Rational_sp Bignum_O::ratdivide(Integer_sp divisor) const {
 Integer_sp next_add(const mp_limb_t *llimbs, mp_size_t llen,
                     const mp_limb_t* rlimbs, mp_size_t rlen) {
   mp_size_t absllen = std::abs(llen), absrlen = std::abs(rlen);
+
+#ifdef BIGNUM_FAST_PATH
+  if ((absllen <= BIGNUM_SMALL_LIMBS) && (absrlen <= BIGNUM_SMALL_LIMBS)) {
+    small_bignum_t l = small_bignum_magnitude(llimbs, absllen);
+    small_bignum_t r = small_bignum_magnitude(rlimbs, absrlen);
+    if ((llen ^ rlen) < 0) {
+      // Different signs, so the result has the sign of the larger magnitude.
+      if (l < r) return small_bignum_result(r - l, rlen < 0);
+      else return small_bignum_result(l - r, llen < 0);
+    }
+    small_bignum_t sum = l + r;
+    if (sum >= l) return small_bignum_result(sum, llen < 0);
+    // Otherwise the sum carried into a third limb, so fall through.
+  }
+#endif
   
   // Keep the larger number in the left.
   if (absllen < absrlen) {
@@ -733,6 +819,16 @@ Integer_sp next_fadd(const mp_limb_t* limbs, mp_size_t len,
   Fixnum aright = std::abs(right);
   mp_size_t size = std::abs(len);
 
+#ifdef BIGNUM_FAST_PATH
+  if (size <= BIGNUM_SMALL_LIMBS) {
+    small_bignum_t magnitude = small_bignum_magnitude(limbs, size);
+    if ((len < 0) ^ (right < 0))
+      return small_bignum_result(magnitude - (mp_limb_t)aright, len < 0);
+    small_bignum_t sum = magnitude + (mp_limb_t)aright;
+    if (sum >= magnitude) return small_bignum_result(sum, len < 0);
+  }
+#endif
+
   mp_size_t result_len = size;
   mp_limb_t result_limbs[size+1];
 
@@ -816,6 +912,14 @@ CL_DEFUN int core__next_compare(Bignum_sp left,
   if (llen < rlen) return -1;
   else if (llen > rlen) return 1;
   else { // actual comparison
+#ifdef BIGNUM_FAST_PATH
+    if (small_bignum_p(llen)) {
+      small_bignum_t l = small_bignum_magnitude(llimbs, std::abs(llen));
+      small_bignum_t r = small_bignum_magnitude(rlimbs, std::abs(rlen));
+      if (l == r) return 0;
+      else return ((l < r) ^ (llen < 0)) ? -1 : 1;
+    }
+#endif
     // mpn_cmp is only defined to return "a negative value" etc.,
     // so we normalize it to -1, 0, or 1.
     int cmp = mpn_cmp(llimbs, rlimbs, std::abs(llen));
@@ -708,7 +708,61 @@ Integer_sp next_boole_mixed2(next_bit_operator op,
   return bignum_result(rlen, result);
 }
 
+#ifdef BIGNUM_FAST_PATH
+// If the integer fits in a signed 128 bit integer store it in result.
+static bool small_integer_int128(Integer_sp i, __int128& result) {
+  if (i.fixnump()) {
+    result = i.unsafe_fixnum();
+    return true;
+  }
+  Bignum_sp big = gc::As<Bignum_sp>(i);
+  mp_size_t len = big->length();
+  if (!small_bignum_p(len)) return false;
+  small_bignum_t magnitude = small_bignum_magnitude(big->limbs(), std::abs(len));
+  // -2^127 fits but +2^127 does not.
+  small_bignum_t limit = (small_bignum_t)1 << 127;
+  if (len < 0) {
+    if (magnitude > limit) return false;
+    result = (__int128)(-magnitude);
+  } else {
+    if (magnitude >= limit) return false;
+    result = (__int128)magnitude;
+  }
+  return true;
+}
+
+static Integer_sp small_boole(Fixnum op, __int128 i, __int128 j) {
+  __int128 r;
+  switch (op) {
+  case boole_clr: r = 0; break;
+  case boole_and: r = i & j; break;
+  case boole_andc2: r = i & ~j; break;
+  case boole_1: r = i; break;
+  case boole_andc1: r = ~i & j; break;
+  case boole_2: r = j; break;
+  case boole_xor: r = i ^ j; break;
+  case boole_ior: r = i | j; break;
+  case boole_nor: r = ~(i | j); break;
+  case boole_eqv: r = ~(i ^ j); break;
+  case boole_c2: r = ~j; break;
+  case boole_orc2: r = i | ~j; break;
+  case boole_c1: r = ~i; break;
+  case boole_orc1: r = ~i | j; break;
+  case boole_nand: r = ~(i & j); break;
+  default: r = -1; break; // boole_set
+  }
+  if (r < 0) return small_bignum_result(-(small_bignum_t)r, true);
+  else return small_bignum_result((small_bignum_t)r, false);
+}
+#endif
+
 Integer_sp clasp_boole(Fixnum op, Integer_sp i1, Integer_sp i2) {
+#ifdef BIGNUM_FAST_PATH
+  __int128 s1, s2;
+  if (!(i1.fixnump() && i2.fixnump())
+      && small_integer_int128(i1, s1) && small_integer_int128(i2, s2))
+    return small_boole(op, s1, s2);
+#endif
   if (i1.fixnump()) {
     if (i2.fixnump()) {
       bit_operator bop = fixnum_operations[op];
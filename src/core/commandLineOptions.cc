@@ -110,8 +110,6 @@ void process_clasp_arguments(CommandLineOptions* options)
              "export CLASP_DEBUG_BYTE_CODE   Dump info during startup for every byte-code\n"
              "export CLASP_PAUSE_STARTUP (set to anything)  Pause right at startup\n"
              "export CLASP_DUMP_FUNCTIONS (set to anything)  Dump all function definitions at startup\n"
-             "export CLASP_TELEMETRY_MASK=1  #turn on telemetry for (1=gc,2=stack)\n"
-             "export CLASP_TELEMETRY_FILE=/tmp/clasp.tel # (file to write telemetry)\n"
              "export CLASP_QUICKLISP_DIRECTORY=<dir> # (directory that contains quicklisp setup.lisp)\n"
              "export CLASP_FEATURES=clasp-builder-repl  # Set *features* (separate multiple features with spaces)\n"
              "export CLASP_MEMORY_PROFILE <size-threshold> <number-theshold> # Options means call \n"
@@ -33,6 +33,8 @@ THE SOFTWARE.
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
+#include <limits.h>
 #include <dlfcn.h>
 #ifdef _TARGET_OS_DARWIN
 #import <mach-o/dyld.h>
@@ -503,6 +505,118 @@ void setup_FasoHeader(FasoHeader* header)
   header->_PageSize = getpagesize();
 }
 
+/*! Writes a faso file with positioned, vectored writes.
+    Buffers are queued as iovecs and written with pwritev once IOV_MAX of them are pending,
+    the page padding between object files comes from one shared page of padding bytes and
+    object files from other fasos are copied in the kernel with copy_file_range
+    where it is available. */
+struct FasoWriter {
+  int                       _FileDescriptor;
+  std::string               _Filename;
+  off_t                     _Offset;        // File offset of the first pending buffer
+  size_t                    _PendingBytes;
+  std::vector<struct iovec> _Pending;
+  std::vector<char>         _Padding;
+
+  FasoWriter(const std::string& filename, size_t pageSize) : _Filename(filename), _Offset(0), _PendingBytes(0), _Padding(pageSize,(char)0xcc) {
+    this->_FileDescriptor = open(filename.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if (this->_FileDescriptor<0) {
+      SIMPLE_ERROR(BF("Could not open file %s because of %s") % filename % strerror(errno));
+    }
+  }
+  ~FasoWriter() {
+    if (this->_FileDescriptor>=0) ::close(this->_FileDescriptor);
+  }
+
+  void write(const void* buffer, size_t bytes) {
+    if (bytes==0) return;
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(buffer);
+    iov.iov_len = bytes;
+    this->_Pending.push_back(iov);
+    this->_PendingBytes += bytes;
+    if (this->_Pending.size()>=IOV_MAX) this->flush();
+  }
+
+  /*! Pad with at most one page of bytes */
+  void pad(size_t bytes) {
+    while (bytes>0) {
+      size_t chunk = std::min(bytes,this->_Padding.size());
+      this->write(this->_Padding.data(),chunk);
+      bytes -= chunk;
+    }
+  }
+
+  void flush() {
+    size_t first = 0;
+    while (first<this->_Pending.size()) {
+      ssize_t written = pwritev(this->_FileDescriptor,&this->_Pending[first],this->_Pending.size()-first,this->_Offset);
+      if (written<0) {
+        if (errno==EINTR) continue;
+        SIMPLE_ERROR(BF("Could not write to %s because of %s") % this->_Filename % strerror(errno));
+      }
+      this->_Offset += written;
+      this->_PendingBytes -= written;
+      // Skip the buffers that were written completely and adjust a partially written one
+      while (first<this->_Pending.size() && (size_t)written>=this->_Pending[first].iov_len) {
+        written -= this->_Pending[first].iov_len;
+        ++first;
+      }
+      if (written>0) {
+        this->_Pending[first].iov_base = (char*)this->_Pending[first].iov_base + written;
+        this->_Pending[first].iov_len -= written;
+      }
+    }
+    this->_Pending.clear();
+  }
+
+  /*! Append bytes bytes of the file fd starting at offset */
+  void copy(int fd, const std::string& fromFilename, off_t offset, size_t bytes) {
+    this->flush();
+#ifdef _TARGET_OS_LINUX
+    while (bytes>0) {
+      loff_t in_offset = offset;
+      loff_t out_offset = this->_Offset;
+      ssize_t copied = copy_file_range(fd,&in_offset,this->_FileDescriptor,&out_offset,bytes,0);
+      if (copied<0 && errno==EINTR) continue;
+      if (copied<=0) break; // Fall back to read/write for what is left
+      offset += copied;
+      this->_Offset += copied;
+      bytes -= copied;
+    }
+#endif
+    std::vector<char> buffer(std::min(bytes,(size_t)(1024*1024)));
+    while (bytes>0) {
+      ssize_t got = pread(fd,buffer.data(),std::min(bytes,buffer.size()),offset);
+      if (got<0 && errno==EINTR) continue;
+      if (got<=0) {
+        SIMPLE_ERROR(BF("Could not read %lu bytes from %s because of %s") % bytes % fromFilename % (got<0 ? strerror(errno) : "end of file"));
+      }
+      this->write(buffer.data(),got);
+      this->flush();
+      offset += got;
+      bytes -= got;
+    }
+  }
+
+  void close() {
+    this->flush();
+    if (::close(this->_FileDescriptor)!=0) {
+      this->_FileDescriptor = -1;
+      SIMPLE_ERROR(BF("Could not close %s because of %s") % this->_Filename % strerror(errno));
+    }
+    this->_FileDescriptor = -1;
+  }
+};
+
+/*! Write the header of a faso file and pad it out to its first object file */
+void write_faso_header(FasoWriter& writer, FasoHeader* header)
+{
+  size_t header_bytes = FasoHeader::calculateSize(header->_NumberOfObjectFiles);
+  writer.write((const void*)header,header_bytes);
+  writer.pad(header->_HeaderPageCount*header->_PageSize-header_bytes);
+}
+
 CL_LAMBDA(path-desig object-files &key (start-object-id 0));
 CL_DOCSTRING(R"doc(Concatenate object files in OBJECT-FILES into a faso file and write it out to PATH-DESIG.
 You can set the starting objectID using the keyword START-OBJECT-ID argument.)doc");
@@ -520,112 +634,100 @@ CL_DEFUN void core__write_faso(T_sp pathDesig, List_sp objectFiles, T_sp tstart_
     }
   }
   //  printf("%s:%d start_object_id = %lu\n", __FILE__, __LINE__, start_object_id );
-  FasoHeader* header = (FasoHeader*)malloc(FasoHeader::calculateSize(cl__length(objectFiles)));
+  size_t numberOfObjectFiles = cl__length(objectFiles);
+  std::unique_ptr<char[]> header_buffer(new char[FasoHeader::calculateSize(numberOfObjectFiles)]);
+  FasoHeader* header = (FasoHeader*)header_buffer.get();
   setup_FasoHeader(header);
-  header->_HeaderPageCount = FasoHeader::calculateHeaderNumberOfPages(cl__length(objectFiles),getpagesize());
-  header->_NumberOfObjectFiles = cl__length(objectFiles);
-  List_sp cur = objectFiles;
+  header->_HeaderPageCount = FasoHeader::calculateHeaderNumberOfPages(numberOfObjectFiles,getpagesize());
+  header->_NumberOfObjectFiles = numberOfObjectFiles;
   size_t nextPage = header->_HeaderPageCount;
-  for ( size_t ii=0; ii<cl__length(objectFiles); ++ii ) {
+  size_t ii = 0;
+  for ( auto cur : objectFiles ) {
+    Array_sp of = gc::As<Array_sp>(CONS_CAR(cur));
+    size_t num_pages = header->calculateObjectFileNumberOfPages(of->length());
     header->_ObjectFiles[ii]._ObjectID = ii+start_object_id;
     header->_ObjectFiles[ii]._StartPage = nextPage;
-    Array_sp of = gc::As<Array_sp>(oCar(cur));
-    cur = oCdr(cur);
-    size_t num_pages = header->calculateObjectFileNumberOfPages(cl__length(of));
     header->_ObjectFiles[ii]._NumberOfPages = num_pages;
+    header->_ObjectFiles[ii]._ObjectFileSize = of->length();
     nextPage += num_pages;
-    header->_ObjectFiles[ii]._ObjectFileSize = cl__length(of);
-#if 0
-    write_bf_stream(BF("Object-file %d StartPage = %lu    _NumberOfPages: %lu  _ObjectFileSize: %lu\n")
-                    % ii
-                    % header->_ObjectFiles[ii]._StartPage
-                    % header->_ObjectFiles[ii]._NumberOfPages
-                    % header->_ObjectFiles[ii]._ObjectFileSize);
-#endif
+    ++ii;
   }
   String_sp filename = gc::As<String_sp>(cl__namestring(pathDesig));
-  FILE* fout = fopen(filename->get_std_string().c_str(),"w");
-  // Write header
-  size_t header_bytes = FasoHeader::calculateSize(header->_NumberOfObjectFiles);
-  fwrite( (const void*)header,header_bytes,1,fout);
-  //  write_bf_stream(BF("Writing header %lu bytes\n") % header_bytes );
-
-  // Fill out to the end of the page
-  size_t pad_bytes = FasoHeader::calculateHeaderNumberOfPages(header->_NumberOfObjectFiles,header->_PageSize)*header->_PageSize-header_bytes;
-  //  write_bf_stream(BF("Padding header %lu bytes\n") % pad_bytes );
-  char empty_byte(0xcc);
-  for ( size_t ii=0; ii<pad_bytes; ++ii) {
-    fwrite( (const void*)&empty_byte,1,1,fout);
-  }
-  // Write out each object file
-  List_sp ocur = objectFiles;
-  for (size_t ofindex=0; ofindex<header->_NumberOfObjectFiles; ofindex++) {
-    size_t of_bytes = header->_ObjectFiles[ofindex]._ObjectFileSize;
-    //    write_bf_stream(BF("Writing object file %d with %lu bytes\n") % ofindex % of_bytes );
-    Array_sp of = gc::As<Array_sp>(oCar(ocur));
-    ocur = oCdr(ocur);
-    fwrite( (const void*)of->rowMajorAddressOfElement_(0),of_bytes,1,fout);
-    size_t of_pad_bytes = header->_ObjectFiles[ofindex]._NumberOfPages*header->_PageSize-of_bytes;
-    //    write_bf_stream(BF("Padding object file %d with %lu bytes\n") % ofindex % of_pad_bytes );
-    for (size_t of_padi=0; of_padi<of_pad_bytes; ++of_padi) {
-      fwrite( (const void*)&empty_byte,1,1,fout);
-    }
-  }
-  fclose(fout);
-};
-
-
-struct MmapInfo {
-  int  _FileDescriptor;
-  void* _Memory;
-  size_t _ObjectFileAreaStart;
-  size_t _ObjectFileAreaSize;
-  MmapInfo(int fd,void* mem, size_t start, size_t size) : _FileDescriptor(fd), _Memory(mem), _ObjectFileAreaStart(start), _ObjectFileAreaSize(size) {};
+  FasoWriter writer(filename->get_std_string(),header->_PageSize);
+  write_faso_header(writer,header);
+  // The object files are written straight from their arrays
+  ii = 0;
+  for ( auto cur : objectFiles ) {
+    Array_sp of = gc::As<Array_sp>(CONS_CAR(cur));
+    size_t of_bytes = header->_ObjectFiles[ii]._ObjectFileSize;
+    writer.write((const void*)of->rowMajorAddressOfElement_(0),of_bytes);
+    writer.pad(header->_ObjectFiles[ii]._NumberOfPages*header->_PageSize-of_bytes);
+    ++ii;
+  }
+  writer.close();
 };
 
 
 struct FasoObjectFileInfo {
+  size_t _FileIndex;
   size_t _ObjectID;
+  off_t  _Offset;          // Where the object file starts in its faso file
   size_t _ObjectFileSize;
-  FasoObjectFileInfo(size_t oid, size_t ofs) : _ObjectID(oid), _ObjectFileSize(ofs) {};
+  FasoObjectFileInfo(size_t fileIndex, size_t oid, off_t offset, size_t ofs) : _FileIndex(fileIndex), _ObjectID(oid), _Offset(offset), _ObjectFileSize(ofs) {};
 };
+
+/*! Read exactly bytes bytes at offset from the faso file fd */
+void read_faso_bytes(int fd, const std::string& filename, void* buffer, size_t bytes, off_t offset)
+{
+  while (bytes>0) {
+    ssize_t got = pread(fd,buffer,bytes,offset);
+    if (got<0 && errno==EINTR) continue;
+    if (got<=0) {
+      close(fd);
+      SIMPLE_ERROR(BF("Could not read the header of %s because of %s") % filename % (got<0 ? strerror(errno) : "end of file"));
+    }
+    buffer = (char*)buffer + got;
+    bytes -= got;
+    offset += got;
+  }
+}
   
 CL_LAMBDA(output-path-designator faso-files &optional (verbose nil))
+CL_DOCSTRING(R"doc(Link the object files of the FASO-FILES into one faso file OUTPUT-PATH-DESIGNATOR.
+Only the headers of the faso files are kept in memory - the object files are copied
+one faso file at a time.)doc");
 CL_DEFUN void core__link_faso_files(T_sp outputPathDesig, List_sp fasoFiles, bool verbose) {
   if (verbose) write_bf_stream(BF("Writing FASO file to %s for %d object files\n") % _rep_(outputPathDesig) % cl__length(fasoFiles));
+  std::vector<std::string> filenames;
   std::vector<FasoObjectFileInfo> allObjectFiles;
-  std::vector<MmapInfo> mmaps;
-  List_sp cur = fasoFiles;
-  for ( size_t ii=0; ii<cl__length(fasoFiles); ++ii ) {
-    String_sp filename = gc::As<String_sp>(cl__namestring(oCar(cur)));
-    cur = oCdr(cur);
-    int fd = open(filename->get_std_string().c_str(),O_RDONLY);
-    if (verbose) write_bf_stream(BF("mmap'ing file[%lu] %s\n") % ii % _rep_(filename)); 
-    off_t fsize = lseek(fd, 0, SEEK_END);
-    lseek(fd,0,SEEK_SET);
-    void* memory = mmap(NULL, fsize, PROT_READ, MAP_SHARED|MAP_FILE, fd, 0);
-    if (memory==MAP_FAILED) {
+  // Read the headers to find the object files
+  for ( auto cur : fasoFiles ) {
+    std::string filename = gc::As<String_sp>(cl__namestring(CONS_CAR(cur)))->get_std_string();
+    if (verbose) write_bf_stream(BF("Reading header of file[%lu] %s\n") % filenames.size() % filename);
+    int fd = open(filename.c_str(),O_RDONLY);
+    if (fd<0) {
+      SIMPLE_ERROR(BF("Could not open %s because of %s") % filename % strerror(errno));
+    }
+    FasoHeader header;
+    read_faso_bytes(fd,filename,&header,sizeof(FasoHeader),0);
+    if (header._Magic != FASO_MAGIC_NUMBER) {
       close(fd);
-      SIMPLE_ERROR(BF("Could not mmap %s because of %s") % _rep_(filename) % strerror(errno));
+      SIMPLE_ERROR(BF("Illegal and unknown file type - magic number: %X\n") % (size_t)header._Magic);
     }
+    std::vector<ObjectFileInfo> entries(header._NumberOfObjectFiles);
+    read_faso_bytes(fd,filename,entries.data(),entries.size()*sizeof(ObjectFileInfo),sizeof(FasoHeader));
     close(fd);
-    FasoHeader* header = (FasoHeader*)memory;
-    if (header->_Magic == FASO_MAGIC_NUMBER) {
-      size_t object0_offset = (header->_HeaderPageCount*header->_PageSize);
-      if (verbose) write_bf_stream(BF("object0_offset %lu  fsize-object0_offset %lu bytes\n") % object0_offset % ((size_t)fsize-object0_offset) );
-      mmaps.emplace_back(MmapInfo(fd,memory,object0_offset,(size_t)fsize-object0_offset));
-      for (size_t ofi = 0; ofi<header->_NumberOfObjectFiles; ++ofi) {
-        size_t of_length = header->_ObjectFiles[ofi]._ObjectFileSize;
-        if (verbose) write_bf_stream(BF("%s:%d object file %lu id: %lu  length: %lu\n") % __FILE__ % __LINE__ % ofi % header->_ObjectFiles[ofi]._ObjectID % of_length);
-        FasoObjectFileInfo fofi(header->_ObjectFiles[ofi]._ObjectID,of_length);
-        allObjectFiles.emplace_back(fofi);
-        if (verbose) write_bf_stream(BF("allObjectFiles.size() = %lu\n") % allObjectFiles.size());
-      }
-    } else {
-      SIMPLE_ERROR(BF("Illegal and unknown file type - magic number: %X\n") % (size_t)header->_Magic);
+    for (size_t ofi = 0; ofi<entries.size(); ++ofi) {
+      if (verbose) write_bf_stream(BF("%s:%d object file %lu id: %lu  length: %lu\n") % __FILE__ % __LINE__ % ofi % entries[ofi]._ObjectID % entries[ofi]._ObjectFileSize);
+      allObjectFiles.emplace_back(filenames.size(),
+                                  entries[ofi]._ObjectID,
+                                  (off_t)(entries[ofi]._StartPage*header._PageSize),
+                                  entries[ofi]._ObjectFileSize);
     }
+    filenames.push_back(filename);
   }
-  FasoHeader* header = (FasoHeader*)malloc(FasoHeader::calculateSize(allObjectFiles.size()));
+  std::unique_ptr<char[]> header_buffer(new char[FasoHeader::calculateSize(allObjectFiles.size())]);
+  FasoHeader* header = (FasoHeader*)header_buffer.get();
   setup_FasoHeader(header);
   header->_HeaderPageCount = FasoHeader::calculateHeaderNumberOfPages(allObjectFiles.size(),getpagesize());
   header->_NumberOfObjectFiles = allObjectFiles.size();
@@ -646,48 +748,35 @@ CL_DEFUN void core__link_faso_files(T_sp outputPathDesig, List_sp fasoFiles, boo
 
   }
   String_sp filename = gc::As<String_sp>(cl__namestring(outputPathDesig));
-  
-  FILE* fout = fopen(filename->get_std_string().c_str(),"w");
-  if (!fout) {
-    SIMPLE_ERROR(BF("Could not open file %s") % _rep_(filename));
-  }
   if (verbose) {
     write_bf_stream(BF("Writing file: %s\n") % _rep_(filename));
   }
-  // Write header
-  size_t header_bytes = FasoHeader::calculateSize(header->_NumberOfObjectFiles);
-  if (verbose) write_bf_stream(BF("Writing %lu bytes of header\n") % header_bytes );
-  fwrite( (const void*)header,header_bytes,1,fout);
-  
-  //  write_bf_stream(BF("Writing header %lu bytes\n") % header_bytes );
-  // Fill out to the end of the page
-  size_t pad_bytes = FasoHeader::calculateHeaderNumberOfPages(header->_NumberOfObjectFiles,header->_PageSize)*header->_PageSize-header_bytes;
-  if (verbose) write_bf_stream(BF("Writing %lu bytes of header for padding\n") % pad_bytes );
-  char empty_byte(0xcc);
-  for ( size_t ii=0; ii<pad_bytes; ++ii) {
-    fwrite( (const void*)&empty_byte,1,1,fout);
-  }
-  unsigned char pad(0xcc);
-  for ( size_t mmi=0; mmi<mmaps.size(); mmi++ ) {
-    size_t bytes_to_write = mmaps[mmi]._ObjectFileAreaSize;
-    size_t page_size = getpagesize();
-    size_t padding = (((size_t)(bytes_to_write+page_size-1)/page_size)*page_size - bytes_to_write);
-    if (verbose) write_bf_stream(BF("Writing %lu bytes of object files\n") % bytes_to_write );
-    fwrite( (const void*)((const char*)mmaps[mmi]._Memory+mmaps[mmi]._ObjectFileAreaStart), bytes_to_write,1,fout);
-    if (verbose) write_bf_stream(BF("Writing %lu bytes of padding\n") % padding );
-    for ( size_t pi=0; pi<padding; ++pi ) {
-      fwrite(&pad,1,1,fout);
+  FasoWriter writer(filename->get_std_string(),header->_PageSize);
+  write_faso_header(writer,header);
+  // Copy the object files - one input file is open at a time
+  int fd = -1;
+  size_t fd_index = 0;
+  for (size_t ofi=0; ofi<allObjectFiles.size(); ofi++ ) {
+    FasoObjectFileInfo& info = allObjectFiles[ofi];
+    if (fd<0 || fd_index!=info._FileIndex) {
+      if (fd>=0) close(fd);
+      fd_index = info._FileIndex;
+      fd = open(filenames[fd_index].c_str(),O_RDONLY);
+      if (fd<0) {
+        SIMPLE_ERROR(BF("Could not open %s because of %s") % filenames[fd_index] % strerror(errno));
+      }
     }
-    size_t mmap_size
-      = mmaps[mmi]._ObjectFileAreaStart
-      + mmaps[mmi]._ObjectFileAreaSize;
-    int res = munmap(mmaps[mmi]._Memory,mmap_size);
-    if (res!=0) {
-      SIMPLE_ERROR(BF("Could not munmap memory"));
+    try {
+      writer.copy(fd,filenames[fd_index],info._Offset,info._ObjectFileSize);
+    } catch (...) {
+      close(fd);
+      throw;
     }
+    writer.pad(header->_ObjectFiles[ofi]._NumberOfPages*header->_PageSize-info._ObjectFileSize);
   }
+  if (fd>=0) close(fd);
   if (verbose) write_bf_stream(BF("Closing %s\n") % _rep_(filename));
-  fclose(fout);
+  writer.close();
   if (verbose) write_bf_stream(BF("Returning %s\n") % _rep_(filename));
 }
 
@@ -1238,27 +1327,25 @@ CL_DEFUN T_mv core__funwind_protect(T_sp protected_fn, T_sp cleanup_fn) {
   return returnTypeLoadFromTemp(nvals, mv_temp);
 }
 
-CL_LAMBDA(function &rest thunks);
+CL_LAMBDA(function core:&va-rest thunks);
 CL_DECLARE();
 CL_DOCSTRING("multipleValueFuncall");
-CL_DEFUN T_mv core__multiple_value_funcall(Function_sp fmv, List_sp thunks) {
+CL_DEFUN T_mv core__multiple_value_funcall(Function_sp fmv, VaList_sp thunks) {
   MAKE_STACK_FRAME(frame, fmv.raw_(), MultipleValues::MultipleValuesLimit);
-  size_t numArgs = 0;
   size_t idx = 0;
   MultipleValues& mv = lisp_multipleValues();
-  for (auto cur : thunks) {
-    Function_sp tfunc = gc::As<Function_sp>(oCar(cur));
+  while (thunks->remaining_nargs() > 0) {
+    Function_sp tfunc = gc::As<Function_sp>(thunks->next_arg());
     T_mv result = (tfunc->entry.load())(LCC_PASS_ARGS0_ELLIPSIS(tfunc.raw_()));
-    ASSERT(idx < MultipleValues::MultipleValuesLimit);
-    if (result.number_of_values() > 0  ) {
-        (*frame)[idx] = result.raw_();
-        ++idx;
-        for (size_t i = 1, iEnd(result.number_of_values()); i < iEnd; ++i) {
-          ASSERT(idx < MultipleValues::MultipleValuesLimit);
-          (*frame)[idx] = mv._Values[i];
-          ++idx;
-        }
-      }
+    size_t nvals = result.number_of_values();
+    if (nvals > 0) {
+      if (idx + nvals > MultipleValues::MultipleValuesLimit)
+        SIMPLE_ERROR(BF("Too many arguments to multiple-value-call - only %d are supported") % MultipleValues::MultipleValuesLimit);
+      (*frame)[idx] = result.raw_();
+      // The rest of the values go straight from the values buffer into the frame.
+      mv.copyValues(frame->arguments(idx + 1), 1, nvals);
+      idx += nvals;
+    }
   }
   frame->set_number_of_arguments(idx);
   Vaslist valist_s(frame);
@@ -120,6 +120,7 @@ THE SOFTWARE.
 //
 #define NAMESPACE_core
 #include <clasp/gctools/gc_interface.h>
+#include <clasp/gctools/telemetry.h>
 #undef NAMESPACE_core
 
 namespace core {
@@ -190,6 +191,10 @@ SYMBOL_EXPORT_SC_(CorePkg,c_local);
 SYMBOL_EXPORT_SC_(CorePkg,_PLUS_known_typep_predicates_PLUS_);
 SYMBOL_EXPORT_SC_(CorePkg,_PLUS_class_name_to_lisp_name_PLUS_);
 SYMBOL_EXPORT_SC_(CorePkg,_PLUS_type_header_value_map_PLUS_);
+SYMBOL_EXPORT_SC_(CorePkg,_PLUS_telemetry_event_gc_PLUS_);
+SYMBOL_EXPORT_SC_(CorePkg,_PLUS_telemetry_event_jit_compile_PLUS_);
+SYMBOL_EXPORT_SC_(CorePkg,_PLUS_telemetry_event_lock_wait_PLUS_);
+SYMBOL_EXPORT_SC_(CorePkg,_PLUS_telemetry_event_gf_miss_PLUS_);
 SYMBOL_EXPORT_SC_(ExtPkg,check_arguments_type);
 SYMBOL_EXPORT_SC_(ExtPkg,array_index);
 SYMBOL_EXPORT_SC_(CorePkg,index);
@@ -1057,6 +1062,10 @@ void CoreExposer_O::define_essential_globals(Lisp_sp lisp) {
   _sym_STARbuild_linkflagsSTAR->defconstant(SimpleBaseString_O::make(BUILD_LINKFLAGS));
   _sym__PLUS_run_all_function_name_PLUS_->defconstant(SimpleBaseString_O::make(RUN_ALL_FUNCTION_NAME));
   _sym__PLUS_clasp_ctor_function_name_PLUS_->defconstant(SimpleBaseString_O::make(CLASP_CTOR_FUNCTION_NAME));
+  _sym__PLUS_telemetry_event_gc_PLUS_->defconstant(make_fixnum(telemetry::event_gc));
+  _sym__PLUS_telemetry_event_jit_compile_PLUS_->defconstant(make_fixnum(telemetry::event_jit_compile));
+  _sym__PLUS_telemetry_event_lock_wait_PLUS_->defconstant(make_fixnum(telemetry::event_lock_wait));
+  _sym__PLUS_telemetry_event_gf_miss_PLUS_->defconstant(make_fixnum(telemetry::event_gf_miss));
   SYMBOL_SC_(CorePkg, cArgumentsLimit);
   _sym_cArgumentsLimit->defconstant(make_fixnum(Lisp_O::MaxFunctionArguments));
   _sym_STARdebugMacroexpandSTAR->defparameter(_Nil<T_O>());
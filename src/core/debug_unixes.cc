@@ -311,6 +311,7 @@ void add_dynamic_library_impl(bool is_executable, const std::string& libraryName
     abort();
   }
   BT_LOG((buf,"OpenDynamicLibraryInfo libraryName: %s handle: %p library_origin: %p\n", libraryName.c_str(),(void*)handle,(void*)library_origin));
+  index_library_symbol_table(libraryName,library_origin,symbol_table);
   OpenDynamicLibraryInfo odli(libraryName,handle,symbol_table,library_origin);
   debugInfo()._OpenDynamicLibraryHandles[libraryName] = odli;
 }
@@ -31,6 +31,8 @@ THE SOFTWARE.
 #include <execinfo.h>
 #include <dlfcn.h>
 #include <iomanip>
+#include <functional>
+#include <unordered_map>
 #include <clasp/core/foundation.h>
 #ifdef USE_LIBUNWIND
 #include <libunwind.h>
@@ -552,6 +554,53 @@ void SymbolTable::sort() {
 }
 
 
+void SymbolIndexRegion::addEntry(const std::string& name, uintptr_t start, uintptr_t end, char type, uintptr_t functionDescription) {
+  SymbolIndexEntry entry;
+  entry._Start = start;
+  entry._End = end;
+  entry._FunctionDescription = functionDescription;
+  entry._NameOffset = this->_Names.size();
+  entry._Type = type;
+  this->_Names.append(name);
+  this->_Names.push_back('\0');
+  this->_Entries.push_back(entry);
+}
+
+void SymbolIndexRegion::finish() {
+  std::sort(this->_Entries.begin(),this->_Entries.end());
+  if (this->_Entries.size()>0) {
+    this->_Low = this->_Entries.front()._Start;
+    for ( auto& entry : this->_Entries ) {
+      if (entry._End > this->_High) this->_High = entry._End;
+    }
+  }
+}
+
+const SymbolIndexEntry* SymbolIndexRegion::find(uintptr_t address) const {
+  auto it = std::upper_bound(this->_Entries.begin(),this->_Entries.end(),address,
+                             [] (uintptr_t addr, const SymbolIndexEntry& entry) { return addr < entry._Start; });
+  if (it == this->_Entries.begin()) return NULL;
+  --it;
+  if (address < it->_End) return &*it;
+  return NULL;
+}
+
+void FrameIndexRegion::finish() {
+  std::sort(this->_Entries.begin(),this->_Entries.end());
+  if (this->_Entries.size()>0) {
+    this->_Low = this->_Entries.front()._Start;
+    this->_High = this->_Entries.back()._Start+1;
+  }
+}
+
+const FrameIndexEntry* FrameIndexRegion::find(uintptr_t address) const {
+  auto it = std::lower_bound(this->_Entries.begin(),this->_Entries.end(),address,
+                             [] (const FrameIndexEntry& entry, uintptr_t addr) { return entry._Start < addr; });
+  if (it != this->_Entries.end() && it->_Start == address) return &*it;
+  return NULL;
+}
+
+
 std::string backtrace_frame(size_t index, BacktraceEntry* frame)
 {
   stringstream ss;
@@ -637,7 +686,10 @@ void parse_constant(uintptr_t& address, uint64_t& constant) {
   constant = read_then_advance<uint64_t>(address);
 }
 
-void parse_record(std::vector<BacktraceEntry>& backtrace, uintptr_t& address, size_t functionIndex, const StkSizeRecord& function, StkMapRecord& record, bool library) {
+/*! Called for every location of every stackmap record */
+typedef std::function<void(const StkSizeRecord& function, uint64_t patchPointID, int32_t offsetOrSmallConstant)> StackmapLocationCallback;
+
+void parse_record(const StackmapLocationCallback& callback, uintptr_t& address, size_t functionIndex, const StkSizeRecord& function, StkMapRecord& record) {
   uintptr_t recordAddress = address;
   BT_LOG((buf,"Parse record at %p\n", (void*)address));
   uint64_t patchPointID = read_then_advance<uint64_t>(address);
@@ -656,25 +708,7 @@ void parse_record(std::vector<BacktraceEntry>& backtrace, uintptr_t& address, si
       abort();
     }
     int32_t offsetOrSmallConstant = read_then_advance<int32_t>(address);
-    if (backtrace.size() == 0 ) {
-      if (library) {
-        WRITE_DEBUG_IO(BF("Stackmap-library function %p stack-size %ld patchPointId %u frame-offset %d\n") % (void*)function.FunctionAddress % function.StackSize % patchPointID % offsetOrSmallConstant );
-      } else {
-        WRITE_DEBUG_IO(BF("Stackmap-jit function %p stack-size %ld patchPointId %u frame-offset %d\n") % (void*)function.FunctionAddress % function.StackSize % patchPointID % offsetOrSmallConstant );
-      }
-    }
-    if (patchPointID == 1234567 ) {
-      BT_LOG((buf,"patchPointID matched at %p\n", (void*)recordAddress));
-      for (size_t j=0; j<backtrace.size(); ++j ) {
-        BT_LOG((buf,"comparing function#%lu @%p to %s\n", functionIndex, (void*)function.FunctionAddress, backtrace_frame(j,&backtrace[j]).c_str() ));
-        if (function.FunctionAddress == backtrace[j]._FunctionStart) {
-          backtrace[j]._Stage = lispFrame;  // anything with a stackmap is a lisp frame
-          backtrace[j]._FrameSize = (int)function.StackSize; // Sometimes the StackSize is (int64_t)-1 why???????
-          backtrace[j]._FrameOffset = offsetOrSmallConstant;
-          BT_LOG((buf,"Identified lispFrame frameOffset = %d\n", offsetOrSmallConstant));
-        }
-      }
-    }
+    callback(function,patchPointID,offsetOrSmallConstant);
   }
   BT_LOG((buf,"Done with records at %p\n", (void*)address));
   if (((uintptr_t)address)&0x7) {
@@ -706,7 +740,7 @@ void parse_record(std::vector<BacktraceEntry>& backtrace, uintptr_t& address, si
      The format is described here: https://llvm.org/docs/StackMaps.html#stack-map-format
 */
 
-void walk_one_llvm_stackmap(std::vector<BacktraceEntry>&backtrace, uintptr_t& address, uintptr_t end, bool library) {
+void walk_one_llvm_stackmap_locations(const StackmapLocationCallback& callback, uintptr_t& address, uintptr_t end) {
   uintptr_t stackMapAddress = address;
   Header header;
   size_t NumFunctions;
@@ -741,13 +775,59 @@ void walk_one_llvm_stackmap(std::vector<BacktraceEntry>&backtrace, uintptr_t& ad
     BT_LOG((buf,"PASS2 Examining function #%lu at %p - %" PRu " records\n", functionIndex, (void*)function.FunctionAddress, function.RecordCount));
     for ( size_t index=0; index<function.RecordCount; index++) {
       StkMapRecord record;
-      parse_record(backtrace,address,functionIndex,function,record,library);
+      parse_record(callback,address,functionIndex,function,record);
     }
   }
 }
 
+void walk_one_llvm_stackmap(std::vector<BacktraceEntry>&backtrace, uintptr_t& address, uintptr_t end, bool library) {
+  walk_one_llvm_stackmap_locations([&backtrace,library] (const StkSizeRecord& function, uint64_t patchPointID, int32_t offsetOrSmallConstant) {
+      if (backtrace.size() == 0 ) {
+        if (library) {
+          WRITE_DEBUG_IO(BF("Stackmap-library function %p stack-size %ld patchPointId %u frame-offset %d\n") % (void*)function.FunctionAddress % function.StackSize % patchPointID % offsetOrSmallConstant );
+        } else {
+          WRITE_DEBUG_IO(BF("Stackmap-jit function %p stack-size %ld patchPointId %u frame-offset %d\n") % (void*)function.FunctionAddress % function.StackSize % patchPointID % offsetOrSmallConstant );
+        }
+      }
+      if (patchPointID == LISP_FRAME_PATCH_POINT_ID ) {
+        for (size_t j=0; j<backtrace.size(); ++j ) {
+          BT_LOG((buf,"comparing function @%p to %s\n", (void*)function.FunctionAddress, backtrace_frame(j,&backtrace[j]).c_str() ));
+          if (function.FunctionAddress == backtrace[j]._FunctionStart) {
+            backtrace[j]._Stage = lispFrame;  // anything with a stackmap is a lisp frame
+            backtrace[j]._FrameSize = (int)function.StackSize; // Sometimes the StackSize is (int64_t)-1 why???????
+            backtrace[j]._FrameOffset = offsetOrSmallConstant;
+            BT_LOG((buf,"Identified lispFrame frameOffset = %d\n", offsetOrSmallConstant));
+          }
+        }
+      }
+    },address,end);
+}
+
 
 
+/*! Parse the stackmaps once and add the lisp frames that they describe to the frame index */
+void index_llvm_stackmaps(const std::string& name, uintptr_t startAddress, uintptr_t endAddress, size_t numStackmaps) {
+  FrameIndexRegion* region = new FrameIndexRegion(name);
+  uintptr_t address = startAddress;
+  for ( size_t num = 0; num<numStackmaps && address<endAddress; ++num ) {
+    walk_one_llvm_stackmap_locations([region] (const StkSizeRecord& function, uint64_t patchPointID, int32_t offsetOrSmallConstant) {
+        if (patchPointID == LISP_FRAME_PATCH_POINT_ID) {
+          FrameIndexEntry entry;
+          entry._Start = function.FunctionAddress;
+          entry._FrameSize = (int)function.StackSize;
+          entry._FrameOffset = offsetOrSmallConstant;
+          region->_Entries.push_back(entry);
+        }
+      },address,endAddress);
+  }
+  if (region->_Entries.size()==0) {
+    delete region;
+    return;
+  }
+  region->finish();
+  debugInfo()._FrameIndex.add(region);
+}
+
 /*! Register contiguous range of stackmaps.
 There may be 0, 1 or any number of adjacent stackmaps.  
 Pass (size_t)~0 if you don't know how many and want to rely on the memory range.
@@ -755,9 +835,12 @@ Stop parsing them when read numStackmaps or if curAddress >= endAddress */
 void register_llvm_stackmaps(uintptr_t startAddress, uintptr_t endAddress, size_t numStackmaps ) {
 //  printf("%s:%d register_llvm_stackmaps %p - %p num: %lu\n", __FILE__, __LINE__, (void*)startAddress, (void*)endAddress, numStackmaps);
   BT_LOG((buf,"register_llvm_stackmaps  startAddress: %p  endAddress: %p\n", (void*)startAddress, (void*)endAddress));
-  WITH_READ_WRITE_LOCK(debugInfo()._StackMapsLock);
-  StackMapRange range(startAddress,endAddress,numStackmaps);
-  debugInfo()._StackMaps[startAddress] = range;
+  {
+    WITH_READ_WRITE_LOCK(debugInfo()._StackMapsLock);
+    StackMapRange range(startAddress,endAddress,numStackmaps);
+    debugInfo()._StackMaps[startAddress] = range;
+  }
+  index_llvm_stackmaps("",startAddress,endAddress,numStackmaps);
 }
 
 
@@ -787,6 +870,113 @@ void register_jitted_object(const std::string& name, uintptr_t address, int size
   debugInfo()._JittedObjects.emplace_back(JittedObject(name,address,size));
 }
 
+void register_jitted_symbols(const std::vector<JittedSymbol>& symbols) {
+  std::unordered_map<std::string,uintptr_t> descriptions;
+  for ( auto& symbol : symbols ) {
+    size_t len = symbol._Name.size();
+    if (len>5 && symbol._Name.compare(len-5,5,"^DESC")==0) {
+      descriptions[symbol._Name.substr(0,len-5)] = symbol._Address;
+    }
+  }
+  // Only the functions go in the index - the data of an object is allocated away from
+  // its code and a region that covered both would overlap the code of other objects
+  SymbolIndexRegion* region = new SymbolIndexRegion("",true,0);
+  for ( auto& symbol : symbols ) {
+    if (!symbol._Function || symbol._Size==0) continue;
+    auto desc = descriptions.find(symbol._Name);
+    region->addEntry(symbol._Name,symbol._Address,symbol._Address+symbol._Size,'T',
+                     (desc==descriptions.end()) ? 0 : desc->second);
+  }
+  if (region->_Entries.size()==0) {
+    delete region;
+    return;
+  }
+  region->finish();
+  debugInfo()._SymbolIndex.add(region);
+}
+
+// The loaders finish every table with a __TAIL_SYMBOL ('!') at the end of the highest code
+bool symbol_table_has_tail_symbol(const SymbolTable& symbolTable) {
+  bool foundTail = false;
+  uintptr_t tail = 0, highestCode = 0;
+  for ( auto& entry : symbolTable ) {
+    if (entry._Type=='!') {
+      foundTail = true;
+      tail = entry._Address;
+    } else if ((entry._Type=='t' || entry._Type=='T') && highestCode<entry._Address) {
+      highestCode = entry._Address;
+    }
+  }
+  return foundTail && highestCode<tail;
+}
+
+void index_library_symbol_table(const std::string& libraryName, uintptr_t libraryOrigin, const SymbolTable& symbolTable) {
+  // A library that is registered again replaces what was indexed before
+  debugInfo()._SymbolIndex.remove(libraryName);
+  debugInfo()._FrameIndex.remove(libraryName);
+  std::unordered_map<std::string,uintptr_t> descriptions;
+  for ( auto& entry : symbolTable ) {
+    if (entry._Type == 'd' || entry._Type=='D' || entry._Type=='s' || entry._Type=='S') {
+      const char* name = symbolTable._SymbolNames+entry._SymbolOffset;
+      size_t len = strlen(name);
+      if (len>5 && strcmp(name+len-5,"^DESC")==0) {
+        descriptions[std::string(name,len-5)] = entry._Address;
+      }
+    }
+  }
+  // A function ends where the next symbol starts, like findSymbolForAddress.
+  // _SymbolsHighAddress is the highest symbol *start* so it can't bound the last
+  // function - that end comes from the tail symbol, which is above every code symbol.
+  ASSERT(symbolTable._Symbols.empty() || symbol_table_has_tail_symbol(symbolTable));
+  SymbolIndexRegion* region = new SymbolIndexRegion(libraryName,false,libraryOrigin);
+  const std::vector<SymbolEntry>& symbols = symbolTable._Symbols;
+  for ( size_t i=0; i<symbols.size(); ++i ) {
+    const SymbolEntry& entry = symbols[i];
+    if (entry._Type != 't' && entry._Type != 'T') continue;
+    size_t next = i+1;
+    while (next<symbols.size() && symbols[next]._Address<=entry._Address) ++next;
+    if (next==symbols.size()) continue; // no end without the tail symbol
+    uintptr_t end = symbols[next]._Address;
+    std::string name(symbolTable._SymbolNames+entry._SymbolOffset);
+    auto desc = descriptions.find(name);
+    region->addEntry(name,entry._Address,end,entry._Type,
+                     (desc==descriptions.end()) ? 0 : desc->second);
+  }
+  if (region->_Entries.size()==0) {
+    delete region;
+  } else {
+    region->finish();
+    debugInfo()._SymbolIndex.add(region);
+  }
+  if (symbolTable._StackmapStart) {
+    index_llvm_stackmaps(libraryName,symbolTable._StackmapStart,symbolTable._StackmapEnd,~(size_t)0);
+  }
+}
+
+bool symbolize_address(BacktraceEntry& entry, std::string* libraryName, uintptr_t* libraryOrigin, char* type) {
+  bool found = debugInfo()._SymbolIndex.find(entry._ReturnAddress,[&] (const SymbolIndexRegion& region, const SymbolIndexEntry& symbol) {
+      entry._Stage = region._Jitted ? lispFrame : symbolicated; // jitted functions are lisp functions
+      entry._FunctionStart = symbol._Start;
+      entry._FunctionEnd = symbol._End;
+      entry._SymbolName = region.entryName(symbol);
+      if (symbol._FunctionDescription) {
+        entry._Stage = lispFrame; // Anything with a FunctionDescription is a lispFrame
+        entry._FunctionDescription = symbol._FunctionDescription;
+      }
+      if (libraryName) *libraryName = region._Name;
+      if (libraryOrigin) *libraryOrigin = region._Origin;
+      if (type) *type = symbol._Type;
+    });
+  if (found) {
+    debugInfo()._FrameIndex.find(entry._FunctionStart,[&entry] (const FrameIndexRegion& region, const FrameIndexEntry& frame) {
+        entry._Stage = lispFrame;  // anything with a stackmap is a lisp frame
+        entry._FrameSize = frame._FrameSize;
+        entry._FrameOffset = frame._FrameOffset;
+      });
+  }
+  return found;
+}
+
 void search_jitted_objects(std::vector<BacktraceEntry>& backtrace, bool searchFunctionDescriptions)
 {
   BT_LOG((buf,"Starting search_jitted_objects\n" ));
@@ -837,6 +1027,8 @@ bool if_dynamic_library_loaded_remove(const std::string& libraryName) {
   map<string,OpenDynamicLibraryInfo>::iterator fi = debugInfo()._OpenDynamicLibraryHandles.find(libraryName);
   bool exists = (fi!=debugInfo()._OpenDynamicLibraryHandles.end());
   if (exists) {
+    debugInfo()._SymbolIndex.remove(libraryName);
+    debugInfo()._FrameIndex.remove(libraryName);
     if (fi->second._SymbolTable._SymbolNames) free((void*)(fi->second._SymbolTable._SymbolNames));
     BT_LOG((buf,"What about the stackmaps for this library - you need to remove them as well - I should probably NOT store stackmaps for libraries - but fetch them every time we need a backtrace!\n"));
     if (fi->second._Handle==0) {
@@ -862,16 +1054,29 @@ CL_DEFUN List_sp core__dynamic_library_handles() {
   return result.cons();
 }
 
-bool lookup_address_main(uintptr_t address, const char*& symbol, uintptr_t& start, uintptr_t& end, char& type, bool& foundLibrary, std::string& libraryName, uintptr_t& libraryStart )
+bool lookup_address_main(uintptr_t address, std::string& symbol, uintptr_t& start, uintptr_t& end, char& type, bool& foundLibrary, std::string& libraryName, uintptr_t& libraryStart )
 {
   foundLibrary = false;
+  // The region is only valid while find calls us - copy the name out
+  bool foundInIndex = debugInfo()._SymbolIndex.find(address,[&] (const SymbolIndexRegion& region, const SymbolIndexEntry& entry) {
+      symbol = region.entryName(entry);
+      start = entry._Start;
+      end = entry._End;
+      type = region._Jitted ? '?' : entry._Type;
+      foundLibrary = !region._Jitted;
+      libraryName = region._Name;
+      libraryStart = region._Origin;
+    });
+  if (foundInIndex) return true;
 #ifdef CLASP_THREADS
   WITH_READ_LOCK(debugInfo()._OpenDynamicLibraryMutex);
 #endif
   size_t index;
-  for ( auto entry : debugInfo()._OpenDynamicLibraryHandles ) {
-    SymbolTable symtab = entry.second._SymbolTable;
-    if (symtab.findSymbolForAddress(address,symbol,start,end,type,index)) {
+  for ( auto& entry : debugInfo()._OpenDynamicLibraryHandles ) {
+    SymbolTable& symtab = entry.second._SymbolTable;
+    const char* tableSymbol;
+    if (symtab.findSymbolForAddress(address,tableSymbol,start,end,type,index)) {
+      symbol = tableSymbol;
       foundLibrary = true;
       libraryName = entry.second._Filename;
       libraryStart = entry.second._LibraryOrigin;
@@ -885,7 +1090,7 @@ bool lookup_address_main(uintptr_t address, const char*& symbol, uintptr_t& star
     for ( auto entry : debugInfo()._JittedObjects ) {
       BT_LOG((buf,"Looking at jitted object name: %s @%p size: %d\n", entry._Name.c_str(), (void*)entry._ObjectPointer, entry._Size));
       if (entry._ObjectPointer<=address && address<(entry._ObjectPointer+entry._Size)) {
-        symbol = entry._Name.c_str();
+        symbol = entry._Name;
         start = entry._ObjectPointer;
         end = entry._ObjectPointer+entry._Size;
         type = '?';
@@ -896,7 +1101,7 @@ bool lookup_address_main(uintptr_t address, const char*& symbol, uintptr_t& star
   return false;
 }
 
-bool lookup_address(uintptr_t address, const char*& symbol, uintptr_t& start, uintptr_t& end, char& type) {
+bool lookup_address(uintptr_t address, std::string& symbol, uintptr_t& start, uintptr_t& end, char& type) {
   bool libraryFound;
   std::string libraryName;
   uintptr_t libraryStart;  
@@ -1353,14 +1558,12 @@ void operating_system_backtrace(std::vector<BacktraceEntry>& backtrace_)
       // printf("%s:%s:%d Resizing backtrace to %lu\n", __FILE__, __FUNCTION__, __LINE__, returned);
       backtrace_.resize(returned);
       // printf("%s:%s:%d Filling backtrace to %lu\n", __FILE__, __FUNCTION__, __LINE__, returned);
-      char **strings = backtrace_symbols(buffer, returned);
+      // Only the return addresses - symbolize_backtrace names the frames
       for ( size_t j=0; j<returned; ++j ) {
         // printf("%s:%s:%d Filling backtrace at %lu\n", __FILE__, __FUNCTION__, __LINE__, j);
         backtrace_[j]._ReturnAddress = (uintptr_t)buffer[j];
-        backtrace_[j]._SymbolName = strings[j];
       }
       free(buffer);
-      free(strings);
       return;
     }
     free(buffer);
@@ -1487,12 +1690,36 @@ void fill_in_interpreted_frames(std::vector<BacktraceEntry>& backtrace) {
 
 
 
+/*! Fill in the symbol and frame information of every frame from the symbol and frame indices.
+    Frames that are not in the index are named by backtrace_symbols like before. */
+void symbolize_backtrace(std::vector<BacktraceEntry>& backtrace) {
+  std::vector<void*> unknown;
+  std::vector<size_t> unknown_index;
+  for ( size_t j=0; j<backtrace.size(); ++j ) {
+    if (!symbolize_address(backtrace[j])) {
+      unknown.push_back((void*)backtrace[j]._ReturnAddress);
+      unknown_index.push_back(j);
+    }
+  }
+  if (unknown.size()>0) {
+    char **strings = backtrace_symbols(unknown.data(),unknown.size());
+    if (strings) {
+      for ( size_t j=0; j<unknown.size(); ++j ) backtrace[unknown_index[j]]._SymbolName = strings[j];
+      free(strings);
+    }
+  }
+}
+
 /*! If you pass a backtrace then it will be filled with symbol information.
     If you pass an empty backtrace then symbol information will be printed.
     eg: std::vector<BacktraceEntry> emptyBacktrace;  fill_backtrace_or_dump_info(emptyBacktrace) 
 */
 void fill_backtrace_or_dump_info(std::vector<BacktraceEntry>& backtrace) {
 //  printf("walk symbol tables and stackmaps for DARWIN\n");
+  if (backtrace.size()>0) {
+    symbolize_backtrace(backtrace);
+    return;
+  }
   size_t symbol_table_memory = 0;
   walk_loaded_objects(backtrace,symbol_table_memory);
     // Now search the jitted objects
@@ -1750,6 +1977,48 @@ CL_DEFUN T_mv core__call_with_frame(Function_sp closure, bool args_as_pointers)
   return eval::funcall(closure, backtrace_stack(backtrace, false));
 }
 
+CL_LAMBDA();
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Return the return addresses of the current stack as a vector of ext:byte64 without
+symbolizing them.  This is cheap enough to do for every condition that is handled,
+core:symbolize-return-addresses resolves them later.)doc");
+CL_DEFUN SimpleVector_byte64_t_sp core__backtrace_return_addresses() {
+  std::vector<void*> buffer(START_BACKTRACE_SIZE);
+  size_t returned;
+  while ((returned = backtrace(buffer.data(),buffer.size())) == buffer.size()) {
+    buffer.resize(buffer.size()*2);
+  }
+  // Leave out this function
+  size_t skip = (returned>0) ? 1 : 0;
+  SimpleVector_byte64_t_sp result = SimpleVector_byte64_t_O::make(returned-skip);
+  for ( size_t j=skip; j<returned; ++j ) (*result)[j-skip] = (uint64_t)buffer[j];
+  return result;
+}
+
+CL_LAMBDA(addresses);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Resolve a vector of return addresses from core:backtrace-return-addresses using the
+symbol index.  Return a list with an element for each address, either NIL if the address is unknown
+or (name function-start function-end library-name-or-nil lisp-frame-p).)doc");
+CL_DEFUN List_sp core__symbolize_return_addresses(SimpleVector_byte64_t_sp addresses) {
+  ql::list result;
+  for ( size_t j=0; j<addresses->length(); ++j ) {
+    BacktraceEntry entry;
+    entry._ReturnAddress = (uintptr_t)(*addresses)[j];
+    std::string libraryName;
+    if (symbolize_address(entry,&libraryName)) {
+      result << Cons_O::createList(SimpleBaseString_O::make(entry._SymbolName),
+                                   Pointer_O::create((void*)entry._FunctionStart),
+                                   Pointer_O::create((void*)entry._FunctionEnd),
+                                   libraryName.empty() ? _Nil<T_O>() : T_sp(SimpleBaseString_O::make(libraryName)),
+                                   _lisp->_boolean(entry._Stage == lispFrame));
+    } else {
+      result << _Nil<T_O>();
+    }
+  }
+  return result.cons();
+}
+
 CL_DOCSTRING(R"doc(Dump a backtrace containing only Common Lisp frames by default but includes C++ frames if all is T.
 If args is T then print arguments, otherwise don't.  If source-info is T then dump source-info after every frame.)doc");
 CL_LAMBDA(&key (stream *error-output*) all (args t) source-info);
@@ -1837,7 +2106,7 @@ CL_DEFUN void core__lowLevelDescribe(T_sp obj) {
 }
 
 CL_DEFUN core::T_mv core__lookup_address(core::Pointer_sp address) {
-  const char* symbol;
+  std::string symbol;
   uintptr_t start, end;
   char type;
   bool libraryFound;
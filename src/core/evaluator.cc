@@ -584,6 +584,23 @@ CL_DEFUN T_mv core__apply4(Function_sp func, T_sp lastArg,
   UNREACHABLE();
 }
 
+CL_LAMBDA(function vector &optional (start 0) end);
+CL_DECLARE();
+CL_DOCSTRING("Call FUNCTION with the elements of the simple-vector VECTOR from START to END as its arguments. Like APPLY of the same elements as a list, without the list.");
+CL_DEFUN T_mv core__apply_vector(T_sp function, SimpleVector_sp vector, size_t start, T_sp end) {
+  Function_sp func = coerce::functionDesignator(function);
+  size_t_pair bounds = sequenceStartEnd(cl::_sym_apply, vector->length(), start, end);
+  size_t nargs = bounds.end - bounds.start;
+  if (nargs > CALL_ARGUMENTS_LIMIT)
+    SIMPLE_ERROR(BF("Too many arguments to apply - only %d are supported and you tried to pass %d") % CALL_ARGUMENTS_LIMIT % nargs);
+  MAKE_STACK_FRAME(frame, func.raw_(), nargs);
+  T_O** args = frame->arguments(0);
+  for (size_t i = 0; i < nargs; ++i) args[i] = (*vector)[bounds.start + i].raw_();
+  Vaslist valist_s(frame);
+  VaList_sp valist(&valist_s);
+  return funcall_consume_valist_<Function_O>(func.tagged_(), valist);
+}
+
 gctools::return_type fast_apply_general(T_O* func_tagged, T_O* args_tagged) {
   ASSERT(gctools::tagged_consp(args_tagged));
   Cons_O* cons_args = reinterpret_cast<Cons_O*>(gctools::untag_cons(args_tagged));
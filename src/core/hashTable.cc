@@ -240,17 +240,14 @@ CL_DEFUN T_sp cl__make_hash_table(T_sp test, Fixnum_sp size,
                                   Symbol_sp weakness, T_sp debug,
                                   T_sp thread_safe, T_sp hashf) {
   SYMBOL_EXPORT_SC_(KeywordPkg, key);
+  double rehash_threshold = maybeFixRehashThreshold(clasp_to_double(orehash_threshold));
   if (weakness.notnilp()) {
-    if (weakness == INTERN_(kw, key)) {
-      if (test == cl::_sym_eq || test == cl::_sym_eq->symbolFunction()) {
-        return core__make_weak_key_hash_table(size);
-      } else {
-        SIMPLE_ERROR(BF("Weak hash tables non-EQ tests are not yet supported"));
-      }
-    }
-    SIMPLE_ERROR(BF("Only :weakness :key (weak-key hash tables) are currently supported"));
+    if (hashf.notnilp()) SIMPLE_ERROR(BF("Weak hash tables do not support a :hash-function"));
+    size_t wsize = clasp_to_int(size);
+    WeakKeyHashTable_sp table = WeakKeyHashTable_O::make((wsize==0) ? 16 : wsize, rehash_size, rehash_threshold, weakness, test);
+    if (thread_safe.notnilp()) table->_HashTable.setupThreadSafeHashTable();
+    return table;
   }
-  double rehash_threshold = maybeFixRehashThreshold(clasp_to_double(orehash_threshold));
   HashTable_sp table = _Nil<HashTable_O>();
   size_t isize = clasp_to_int(size);
   if (isize==0) isize = 16;
@@ -291,7 +288,7 @@ CL_DECLARE();
 CL_DOCSTRING("hash_table_weakness");
 CL_DEFUN Symbol_sp core__hash_table_weakness(T_sp ht) {
   if (gc::IsA<WeakKeyHashTable_sp>(ht)) {
-    return kw::_sym_key;
+    return gc::As_unsafe<WeakKeyHashTable_sp>(ht)->weakness();
   }
   return _Nil<Symbol_O>();
 }
@@ -415,10 +412,11 @@ CL_DEFUN bool cl__remhash(T_sp key, HashTableBase_sp ht) {
 
 T_sp HashTable_O::clrhash() {
   ASSERT(!clasp_zerop(this->_RehashSize));
+  HT_WRITE_LOCK(this);
   this->_HashTableCount = 0;
   T_sp no_key = _NoKey<T_O>();
   this->_Table.resize(0,KeyValuePair(no_key,no_key));
-  this->setup(16, this->_RehashSize, this->_RehashThreshold);
+  this->resizeEmptyTable_no_lock(16);
   VERIFY_HASH_TABLE(this);
   return this->asSmartPtr();
 }
@@ -541,7 +539,7 @@ void HashTable_O::sxhash_equal(HashGenerator &hg, T_sp obj) {
   } else if (obj.consp()) {
     Cons_sp cobj = gc::As_unsafe<Cons_sp>(obj);
     if (hg.isFilling()) HashTable_O::sxhash_equal(hg, CONS_CAR(cobj));
-    if (hg.isFilling()) HashTable_O::sxhash_equal(hg, CONS_CAR(cobj));
+    if (hg.isFilling()) HashTable_O::sxhash_equal(hg, CONS_CDR(cobj));
     return;
   } else if (obj.generalp()) {
     if (cl__numberp(obj)) {
@@ -659,6 +657,8 @@ void HashTable_O::fields(Record_sp node) {
 
 uint HashTable_O::resizeEmptyTable_no_lock(size_t sz) {
   if (sz < 16) sz = 16;
+  // Round up to a power of two so that hashes are reduced with a mask (see hash_reduce)
+  sz = (size_t)1 << (64-__builtin_clzl(sz-1));
   T_sp no_key = _NoKey<T_O>();
   this->_HashTableCount = 0;
   this->_Table.resize(sz,KeyValuePair(no_key,no_key));
@@ -825,6 +825,47 @@ KeyValuePair* HashTable_O::find(T_sp key) {
   return keyValue;
 }
 
+gc::Fixnum HashTable_O::stringKeyHash(SimpleString_sp key) {
+  HashGenerator hg;
+  HashTable_O::sxhash_equal(hg, key);
+  return hg.rawhash();
+}
+
+/*! EQUAL on two simple strings, without dispatching for the common cases */
+static bool string_key_equal(T_sp entryKey, SimpleString_sp key) {
+  if (gc::IsA<SimpleBaseString_sp>(entryKey) && gc::IsA<SimpleBaseString_sp>(key)) {
+    SimpleBaseString_sp a = gc::As_unsafe<SimpleBaseString_sp>(entryKey);
+    SimpleBaseString_sp b = gc::As_unsafe<SimpleBaseString_sp>(key);
+    return (a->length() == b->length())
+      && (memcmp(a->begin(), b->begin(), a->length()*sizeof(*a->begin())) == 0);
+  }
+  if (gc::IsA<SimpleCharacterString_sp>(entryKey) && gc::IsA<SimpleCharacterString_sp>(key)) {
+    SimpleCharacterString_sp a = gc::As_unsafe<SimpleCharacterString_sp>(entryKey);
+    SimpleCharacterString_sp b = gc::As_unsafe<SimpleCharacterString_sp>(key);
+    return (a->length() == b->length())
+      && (memcmp(a->begin(), b->begin(), a->length()*sizeof(*a->begin())) == 0);
+  }
+  return cl__equal(entryKey, key);
+}
+
+KeyValuePair* HashTable_O::findStringKey(SimpleString_sp key, gc::Fixnum hash) {
+  HT_READ_LOCK(this);
+  size_t size = this->_Table.size();
+  if (size == 0) return nullptr;
+  size_t index = hash_reduce(hash, size);
+  size_t cur = index;
+  do {
+    KeyValuePair& entry = this->_Table[cur];
+    if (entry._Key.no_keyp()) return nullptr;
+    if (!entry._Key.deletedp() && string_key_equal(entry._Key, key)) {
+      if (entry._Value.no_keyp()) return nullptr;
+      return &entry;
+    }
+    cur = (cur + 1 == size) ? 0 : cur + 1;
+  } while (cur != index);
+  return nullptr;
+}
+
 bool HashTable_O::contains(T_sp key) {
   HT_READ_LOCK(this);
   KeyValuePair* keyValue = this->find(key);
@@ -1098,6 +1139,30 @@ CL_DEFMETHOD T_sp HashTable_O::hash_table_average_search_length()
   return _Nil<T_O>();
 }  
 
+/*! Return a vector whose element I is the number of keys that are found
+    I probes after the bucket that their hash selects */
+CL_DEFMETHOD SimpleVector_sp HashTable_O::hash_table_probe_histogram()
+{
+  HT_READ_LOCK(this);
+  gc::Fixnum iend(this->_Table.size());
+  std::vector<size_t> histogram;
+  for (gc::Fixnum it(0), itEnd(iend); it < itEnd; ++it) {
+    const KeyValuePair& entry = this->_Table[it];
+    if (!(entry._Key.no_keyp()||entry._Key.deletedp())) {
+      HashGenerator hg;
+      gc::Fixnum index = this->sxhashKey(entry._Key, this->_Table.size(), hg );
+      size_t delta = (index > it) ? (it+iend)-index : it-index;
+      if (delta>=histogram.size()) histogram.resize(delta+1,0);
+      histogram[delta]++;
+    }
+  }
+  SimpleVector_sp result = SimpleVector_O::make(histogram.size());
+  for (size_t ii=0; ii<histogram.size(); ++ii) {
+    (*result)[ii] = make_fixnum(histogram[ii]);
+  }
+  return result;
+}
+
 CL_DEFMETHOD string HashTable_O::hash_table_dump() {
   stringstream ss;
   HT_READ_LOCK(this);
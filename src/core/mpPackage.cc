@@ -41,6 +41,7 @@ THE SOFTWARE.
 #include <clasp/core/lispList.h>
 #include <clasp/gctools/interrupt.h>
 #include <clasp/core/evaluator.h>
+#include <clasp/core/random.h>
 
 
 extern "C" {
@@ -341,6 +342,25 @@ string SharedMutex_O::__repr__() const {
   return ss.str();
 }
 
+Process_sp Process_O::make_process(core::T_sp name, core::T_sp function, core::T_sp arguments, core::T_sp special_bindings, size_t stack_size) {
+  core::List_sp passed_bindings = core::cl__reverse(special_bindings);
+  core::List_sp all_bindings = core::lisp_copy_default_special_bindings();
+  // The new process gets its own random number stream.  It is split off here in the
+  // creating thread, so the split comes between this thread's own calls to RANDOM and
+  // doesn't depend on when the new thread starts.  It is bound first, so that a default
+  // or passed binding of *random-state* overrides it.
+  core::RandomState_sp random_state = core::core__random_state_split(gc::As<core::RandomState_sp>(cl::_sym_STARrandom_stateSTAR->symbolValue()));
+  core::List_sp random_binding = core::Cons_O::create(cl::_sym_STARrandom_stateSTAR,
+                                                      core::Cons_O::createList(cl::_sym_quote,random_state));
+  all_bindings = core::clasp_nconc(all_bindings,core::Cons_O::create(random_binding,_Nil<core::T_O>()));
+  for ( auto cur : passed_bindings) {
+    all_bindings = core::Cons_O::create(oCar(cur),all_bindings);
+  }
+  if (stack_size==0) stack_size = DEFAULT_THREAD_STACK_SIZE;
+  GC_ALLOCATE_VARIADIC(Process_O,p,name,function,arguments,all_bindings,stack_size);
+  return p;
+};
+
 string Process_O::phase_as_string() const {
   switch (this->_Phase) {
   case Nascent:
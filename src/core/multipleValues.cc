@@ -61,22 +61,24 @@ void dump_values_pos(T_sp v, const char* name, int n)
 }; /* core */
 
 core::T_mv ValuesFromCons(core::List_sp vals) {
-  size_t len = cl__length(vals);
-  if (len == 0) {
+  if (vals.nilp()) {
     return core::T_mv(_Nil<core::T_O>(), 0);
   }
+  // One pass: the values go straight into the buffer, and the length
+  // falls out at the end.
   core::MultipleValues &me = (core::lisp_multipleValues());
-  int i = 1;
+  size_t i = 1;
   SUPPRESS_GC();
   me.setSize(0);
-  for (auto cur : (core::List_sp)oCdr(vals)) {
+  core::T_sp cur = oCdr(vals);
+  for (; cur.consp(); cur = oCdr(cur)) {
     if (i >= core::MultipleValues::MultipleValuesLimit) {
       SIMPLE_ERROR(BF("Overflow when returning multiple values - only %d are supported and you tried to return %d values") % core::MultipleValues::MultipleValuesLimit % cl__length(vals));
     }
-    core::T_sp obj = oCar(cur);
-    me.valueSet(i, obj);
+    me[i] = oCar(cur).raw_();
     ++i;
   }
+  if (cur.notnilp()) TYPE_ERROR_PROPER_LIST(vals);
   me.setSize(i);
   ENABLE_GC();
   core::T_mv mv = gctools::multiple_values<core::T_O>(oCar(vals), i);
@@ -459,7 +459,7 @@ Fixnum bignum_hash(const mpz_class &bignum) {
     printf("%s:%d Adding hash bignum\n", __FILE__, __LINE__);
   }
 #endif
-  gc::Fixnum hash(5381);
+  gc::Fixnum hash(HASH_SEED);
   for (int i = 0; i < (int)size; i++) {
     hash = (gc::Fixnum)hash_word(hash,(uintptr_t)bn->_mp_d[i]);
   }
@@ -448,6 +448,9 @@ void Package_O::initialize() {
   this->_InternalSymbols = HashTableEqual_O::create_default();
   this->_ExternalSymbols = HashTableEqual_O::create_default();
   this->_Shadowing = HashTableEq_O::create_default();
+  // Filled in by lookups that only hold the package read lock
+  this->_InheritedSymbols = HashTableEqual_O::create_default();
+  this->_InheritedSymbols->setupThreadSafeHashTable();
 #if 0
   this->_InternalSymbols->setupThreadSafeHashTable();
   this->_ExternalSymbols->setupThreadSafeHashTable();
@@ -520,39 +523,44 @@ string Package_O::allSymbols() {
   return ss.str();
 }
 
+void Package_O::clearInheritedSymbols() const {
+  this->_InheritedSymbols->clrhash();
+}
+
+void Package_O::clearUsersInheritedSymbols() const {
+  for (auto user : this->_PackagesUsedBy) {
+    if (user.notnilp()) user->clearInheritedSymbols();
+  }
+}
+
 Symbol_mv Package_O::findSymbol_SimpleString_no_lock(SimpleString_sp nameKey) const {
-//  client_validate(nameKey);
-  T_mv ei = this->_ExternalSymbols->gethash(nameKey, _Nil<T_O>());
-//  client_validate(nameKey);
-  Symbol_sp val = gc::As<Symbol_sp>(ei);
-  bool foundp = ei.second().isTrue();
-  if (foundp) {
-//    client_validate(val->_Name);
-    LOG(BF("Found it in the _ExternalsSymbols list - returning[%s]") % (_rep_(val)));
-    return Values(val, kw::_sym_external);
+  // Hash the name once for all of the tables it is looked up in
+  gc::Fixnum hash = HashTable_O::stringKeyHash(nameKey);
+  if (KeyValuePair* external = this->_ExternalSymbols->findStringKey(nameKey, hash)) {
+    return Values(gc::As<Symbol_sp>(external->_Value), kw::_sym_external);
   }
   // There is no need to look further if this is the keyword package
   if (this->isKeywordPackage())
     return Values(_Nil<T_O>(), _Nil<T_O>());
-  T_mv ej = this->_InternalSymbols->gethash(nameKey, _Nil<T_O>());
-  val = gc::As<Symbol_sp>(ej);
-  foundp = ej.second().isTrue();
-  if (foundp) {
-    LOG(BF("Found it in the _InternalSymbols list - returning[%s]") % (_rep_(first)));
-    return (Values(val, kw::_sym_internal));
+  if (KeyValuePair* internal = this->_InternalSymbols->findStringKey(nameKey, hash)) {
+    return Values(gc::As<Symbol_sp>(internal->_Value), kw::_sym_internal);
   }
-  {
-    _BLOCK_TRACEF(BF("Looking in _UsingPackages"));
-    for (auto it = this->_UsingPackages.begin(); it != this->_UsingPackages.end(); it++) {
-      Package_sp upkg = *it;
-      LOG(BF("Looking in package[%s]") % _rep_(upkg));
-      T_mv eu = upkg->_ExternalSymbols->gethash(nameKey, _Nil<T_O>());
-      val = gc::As<Symbol_sp>(eu);
-      foundp = ei.second().isTrue();
-      if (foundp) {
-        LOG(BF("Found it in the _ExternalsSymbols list - returning[%s]") % (_rep_(val)));
-        return Values(val, kw::_sym_inherited);
-      }
+  if (this->_UsingPackages.size() == 0)
+    return Values(_Nil<Symbol_O>(), _Nil<Symbol_O>());
+  if (KeyValuePair* inherited = this->_InheritedSymbols->findStringKey(nameKey, hash)) {
+    return Values(gc::As<Symbol_sp>(inherited->_Value), kw::_sym_inherited);
+  }
+  for (auto it = this->_UsingPackages.begin(); it != this->_UsingPackages.end(); it++) {
+    Package_sp upkg = *it;
+    LOG(BF("Looking in package[%s]") % _rep_(upkg));
+    // Hold the used package's lock until the symbol is cached, so an unexport or
+    // unintern there can't clear our cache in between and leave a stale entry in it
+    WITH_PACKAGE_READ_LOCK(upkg);
+    if (KeyValuePair* used = upkg->_ExternalSymbols->findStringKey(nameKey, hash)) {
+      Symbol_sp val = gc::As<Symbol_sp>(used->_Value);
+      // Key the cache by the symbol's own name - nameKey may be a reused buffer
+      this->_InheritedSymbols->hash_table_setf_gethash(val->_Name, val);
+      return Values(val, kw::_sym_inherited);
     }
   }
   return Values(_Nil<Symbol_O>(), _Nil<Symbol_O>());
@@ -672,6 +680,7 @@ bool Package_O::usePackage(Package_sp usePackage) {
   {
     WITH_PACKAGE_READ_WRITE_LOCK(this);
     this->_UsingPackages.push_back(usePackage);
+    this->clearInheritedSymbols();
   }
   Package_sp me(this);
   {
@@ -687,6 +696,7 @@ bool Package_O::unusePackage_no_outer_lock(Package_sp usePackage) {
        it != this->_UsingPackages.end(); ++it) {
     if ((*it) == usePackage) {
       this->_UsingPackages.erase(it);
+      this->clearInheritedSymbols();
       for (auto jt = usePackage->_PackagesUsedBy.begin();
            jt != usePackage->_PackagesUsedBy.end(); ++jt) {
         if (*jt == me) {
@@ -709,6 +719,7 @@ bool Package_O::unusePackage_no_inner_lock(Package_sp usePackage) {
        it != this->_UsingPackages.end(); ++it) {
     if ((*it) == usePackage) {
       this->_UsingPackages.erase(it);
+      this->clearInheritedSymbols();
       for (auto jt = usePackage->_PackagesUsedBy.begin();
            jt != usePackage->_PackagesUsedBy.end(); ++jt) {
         if (*jt == me) {
@@ -852,6 +863,7 @@ void Package_O::unexport(Symbol_sp sym) {
     } else if (status == kw::_sym_external) {
       this->_ExternalSymbols->remhash(nameKey);
       this->_InternalSymbols->setf_gethash(nameKey,sym);
+      this->clearUsersInheritedSymbols();
     }
   }
   if (error == not_accessible_in_this_package) {
@@ -865,6 +877,7 @@ void Package_O::unexport(Symbol_sp sym) {
 void Package_O::add_symbol_to_package_no_lock(SimpleString_sp nameKey, Symbol_sp sym, bool exportp) {
   if (this->isKeywordPackage() || this->actsLikeKeywordPackage() || exportp) {
     this->_ExternalSymbols->hash_table_setf_gethash(nameKey, sym);
+    this->clearUsersInheritedSymbols();
   } else {
     this->_InternalSymbols->hash_table_setf_gethash(nameKey, sym);
   }
@@ -945,6 +958,7 @@ bool Package_O::unintern_no_lock(Symbol_sp sym) {
         return true;
       } else if (status == kw::_sym_external) {
         this->_ExternalSymbols->remhash(nameKey);
+        this->clearUsersInheritedSymbols();
         if (sym->getPackage().get() == this)
           sym->setPackage(_Nil<Package_O>());
         return true;
@@ -1758,6 +1758,49 @@ bool clasp_stringMatch(T_sp s, size_t j, size_t ls,
   return (j >= ls);
 }
 
+/* clasp_stringMatch on raw bytes, for matching file names as they come
+ * out of the directory before making strings of them. It must agree
+ * with clasp_stringMatch exactly. */
+bool clasp_stringMatchBytes(const char* s, size_t j, size_t ls,
+                            const char* p, size_t i, size_t lp) {
+  while (i < lp) {
+    unsigned char cp = p[i];
+    switch (cp) {
+    case '*': {
+      size_t next;
+      for (next = i + 1; next < lp && p[next] == '*'; next++)
+        ;
+      if (next == lp) {
+        return true;
+      }
+      while (j < ls) {
+        if (clasp_stringMatchBytes(s, j, ls, p, next, lp)) {
+          return true;
+        }
+        j++;
+      }
+      return false;
+    }
+    case '?':
+      if (j > ls)
+        return false;
+      i++;
+      j++;
+      break;
+    case '\\':
+      if (++i >= lp)
+        i--;
+    default:
+      if ((j >= ls) || (cp != (unsigned char)s[j])) {
+        return false;
+      }
+      i++;
+      j++;
+    }
+  }
+  return (j >= ls);
+}
+
 static bool
 path_item_match(T_sp a, T_sp mask) {
   if (mask == kw::_sym_wild)
@@ -26,6 +26,8 @@ THE SOFTWARE.
 /* -^- */
 //#define DEBUG_LEVEL_FULL
 
+#include <mutex>
+
 #include <clasp/core/foundation.h>
 #include <clasp/core/common.h>
 #include <clasp/core/numbers.h>
@@ -34,10 +36,56 @@ THE SOFTWARE.
 #include <clasp/core/lispStream.fwd.h>
 #include <clasp/core/print.h>
 #include <clasp/core/random.h>
+#include <clasp/core/array.h>
+#include <clasp/core/bignum.h>
 #include <clasp/core/wrappers.h>
 
 namespace core {
 
+void Xoshiro256::jump_with(const uint64_t* polynomial) {
+  uint64_t s[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; ++i) {
+    for (int b = 0; b < 64; ++b) {
+      if (polynomial[i] & ((uint64_t)1 << b)) {
+        for (int j = 0; j < 4; ++j) s[j] ^= this->_State[j];
+      }
+      (*this)();
+    }
+  }
+  for (int j = 0; j < 4; ++j) this->_State[j] = s[j];
+}
+
+void Xoshiro256::jump() {
+  static const uint64_t polynomial[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                         0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+  this->jump_with(polynomial);
+}
+
+void Xoshiro256::long_jump() {
+  static const uint64_t polynomial[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                         0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+  this->jump_with(polynomial);
+}
+
+std::ostream& operator<<(std::ostream& os, const Xoshiro256& gen) {
+  os << gen._State[0] << ' ' << gen._State[1] << ' ' << gen._State[2] << ' ' << gen._State[3];
+  return os;
+}
+
+// Leaves the generator alone unless the whole state could be read.
+// An all-zero state is the one state xoshiro can never leave, so it's rejected.
+std::istream& operator>>(std::istream& is, Xoshiro256& gen) {
+  uint64_t s[4];
+  if (is >> s[0] >> s[1] >> s[2] >> s[3]) {
+    if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+      is.setstate(std::ios::failbit);
+    } else {
+      for (int i = 0; i < 4; ++i) gen._State[i] = s[i];
+    }
+  }
+  return is;
+}
+
 CL_LAMBDA(&optional state);
 CL_PKG_NAME(ClPkg,make-random-state);
 CL_DEFUN RandomState_sp RandomState_O::make(T_sp state) {
@@ -69,8 +117,7 @@ CL_DEFUN T_sp cl__random(Number_sp olimit, RandomState_sp random_state) {
   if (olimit.fixnump()) {
     gc::Fixnum n = olimit.unsafe_fixnum();
     if (n > 0) {
-      std::uniform_int_distribution<uint64_t> range(0, n - 1);
-      return make_fixnum(range(random_state->_Producer));
+      return make_fixnum(random_state->_Producer.bounded(n));
     } else TYPE_ERROR_cl_random(olimit);
   } else if (gc::IsA<Bignum_sp>(olimit)) {
     Bignum_sp gbn = gc::As_unsafe<Bignum_sp>(olimit);
@@ -78,35 +125,94 @@ CL_DEFUN T_sp cl__random(Number_sp olimit, RandomState_sp random_state) {
     const mp_limb_t* limbs = gbn->limbs();
     if (len < 1) TYPE_ERROR_cl_random(olimit); // positive only
     mp_limb_t res[len];
-    const mp_limb_t minlimb = std::numeric_limits<mp_limb_t>::min();
-    const mp_limb_t maxlimb = std::numeric_limits<mp_limb_t>::max();
-    std::uniform_int_distribution<mp_limb_t> range(minlimb, maxlimb);
-    for (mp_size_t i = 0; i < len; ++i)
-      res[i] = range(random_state->_Producer);
-    // FIXME: We KLUDGE the range by doing mod (basically).
-    // This will in general result in deviations from a truly uniform
-    // distribution.
-    // For comparison, the native mpz code tries 80 rounds of rejection
-    // sampling, and then gives up and uses mod.
-    // FIXME: Also we could avoid actually consing a bignum for the
-    // intermediate here.
+    // Rejection sampling: draw as many bits as the limit has and try again
+    // if the result is too big. Each try succeeds with probability > 1/2.
+    int top_bits = GMP_LIMB_BITS - __builtin_clzll(limbs[len - 1]);
+    mp_limb_t top_mask = (top_bits == GMP_LIMB_BITS) ? ~(mp_limb_t)0 : (((mp_limb_t)1 << top_bits) - 1);
+    do {
+      for (mp_size_t i = 0; i < len; ++i)
+        res[i] = random_state->_Producer();
+      res[len - 1] &= top_mask;
+    } while (mpn_cmp(res, limbs, len) >= 0);
     BIGNUM_NORMALIZE(len, res);
-    return cl__mod(bignum_result(len, res), gbn);
+    return bignum_result(len, res);
   } else if (DoubleFloat_sp df = olimit.asOrNull<DoubleFloat_O>()) {
-    if (df->get() > 0.0) {
-      std::uniform_real_distribution<> range(0.0, df->get());
-      return DoubleFloat_O::create(range(random_state->_Producer));
+    double limit = df->get();
+    if (limit > 0.0) {
+      double result = random_state->_Producer.unit_double() * limit;
+      // Rounding can carry the product up to the limit itself.
+      if (result >= limit) result = std::nextafter(limit, 0.0);
+      return DoubleFloat_O::create(result);
     } else TYPE_ERROR_cl_random(olimit);
   } else if (olimit.single_floatp()) {
     float flimit = olimit.unsafe_single_float();
     if (flimit >  0.0f) {
-      std::uniform_real_distribution<> range(0.0, flimit);
-      return clasp_make_single_float(range(random_state->_Producer));
+      float result = random_state->_Producer.unit_float() * flimit;
+      if (result >= flimit) result = std::nextafter(flimit, 0.0f);
+      return clasp_make_single_float(result);
     } else TYPE_ERROR_cl_random(olimit);
   }
   TYPE_ERROR_cl_random(olimit);
 }
 
+CL_LAMBDA(seed);
+CL_DECLARE();
+CL_DOCSTRING("Return a new random-state seeded from the fixnum SEED. States made from the same seed produce the same numbers.");
+CL_DEFUN RandomState_sp core__seed_random_state(Fixnum seed) {
+  return RandomState_O::create_seeded((uint64_t)seed);
+}
+
+CL_LAMBDA(random-state);
+CL_DECLARE();
+CL_DOCSTRING("Advance RANDOM-STATE by 2^128 numbers and return it.");
+CL_DEFUN RandomState_sp core__random_state_jump(RandomState_sp random_state) {
+  random_state->_Producer.jump();
+  return random_state;
+}
+
+// Splitting the global state from several new threads at once
+// mustn't hand two of them the same stream.
+static std::mutex global_random_state_split_mutex;
+
+CL_LAMBDA(&optional (random-state cl:*random-state*));
+CL_DECLARE();
+CL_DOCSTRING("Return a new random-state that continues from RANDOM-STATE, and jump RANDOM-STATE 2^128 numbers ahead. The two produce non-overlapping streams, so each thread can have its own.");
+CL_DEFUN RandomState_sp core__random_state_split(RandomState_sp random_state) {
+  std::lock_guard<std::mutex> guard(global_random_state_split_mutex);
+  RandomState_sp result = RandomState_O::create(random_state);
+  random_state->_Producer.jump();
+  return result;
+}
+
+CL_LAMBDA(vector limit &optional (random-state cl:*random-state*));
+CL_DECLARE();
+CL_DOCSTRING("Fill VECTOR with (random LIMIT random-state) for each element and return it. VECTOR is a simple vector of double-floats with a positive double-float LIMIT, or of fixnums with a positive fixnum LIMIT.");
+CL_DEFUN T_sp core__random_fill(T_sp vector, Number_sp limit, RandomState_sp random_state) {
+  RandomState_O::Generator& producer = random_state->_Producer;
+  if (SimpleVector_double_sp dv = vector.asOrNull<SimpleVector_double_O>()) {
+    DoubleFloat_sp df = limit.asOrNull<DoubleFloat_O>();
+    if (df.nilp() || !(df->get() > 0.0))
+      TYPE_ERROR(limit, Cons_O::createList(cl::_sym_double_float, Cons_O::createList(clasp_make_double_float(0.0))));
+    double dlimit = df->get();
+    double below = std::nextafter(dlimit, 0.0);
+    for (size_t i = 0, iEnd = dv->length(); i < iEnd; ++i) {
+      double result = producer.unit_double() * dlimit;
+      (*dv)[i] = (result < dlimit) ? result : below;
+    }
+    return dv;
+  } else if (SimpleVector_fixnum_sp fv = vector.asOrNull<SimpleVector_fixnum_O>()) {
+    if (!limit.fixnump() || limit.unsafe_fixnum() <= 0)
+      TYPE_ERROR(limit, Cons_O::createList(cl::_sym_Integer_O, make_fixnum(1), make_fixnum(gc::most_positive_fixnum)));
+    uint64_t n = limit.unsafe_fixnum();
+    for (size_t i = 0, iEnd = fv->length(); i < iEnd; ++i)
+      (*fv)[i] = producer.bounded(n);
+    return fv;
+  }
+  TYPE_ERROR(vector, Cons_O::createList(cl::_sym_or,
+                                        Cons_O::createList(cl::_sym_simple_array, cl::_sym_double_float, Cons_O::createList(cl::_sym__TIMES_)),
+                                        Cons_O::createList(cl::_sym_simple_array, cl::_sym_fixnum, Cons_O::createList(cl::_sym__TIMES_))));
+}
+
 
 void RandomState_O::__write__(T_sp stream) const {
   bool readably = clasp_print_readably();
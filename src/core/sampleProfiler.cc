@@ -0,0 +1,315 @@
+/*
+    File: sampleProfiler.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*! In process sampling CPU profiler.
+
+    SIGPROF is delivered by an ITIMER_PROF timer to whichever thread is using the CPU.
+    The handler walks the frame pointer chain from the interrupted context - clasp
+    is built with frame pointers and JIT'd code keeps them too, so this unwinds
+    through Lisp and C++ frames alike - and copies the return addresses into a
+    preallocated sample buffer.  The handler only touches that buffer and atomics.
+
+    Symbolization happens when the profile is written, using lookup_address which
+    knows about the loaded libraries and the JIT'd objects registered by save_symbol_info.
+*/
+
+#include <csignal>
+#include <atomic>
+#include <map>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <ucontext.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <sched.h>
+#ifdef _TARGET_OS_LINUX
+#include <sys/syscall.h>
+#endif
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/debugger.h>
+#include <clasp/core/array.h>
+#include <clasp/core/pathname.h>
+#include <clasp/core/symbolTable.h>
+#include <clasp/core/wrappers.h>
+
+namespace core {
+
+#define CPU_SAMPLE_MAX_DEPTH 128
+
+struct CpuSample {
+  uint64_t   _Thread;
+  uint32_t   _Depth;
+  uintptr_t  _Frames[CPU_SAMPLE_MAX_DEPTH];
+};
+
+std::atomic<bool>      global_CpuSampling(false);
+std::atomic<size_t>    global_CpuSamplesTaken(0);
+std::atomic<size_t>    global_CpuSamplesDropped(0);
+/*! Number of SIGPROF handlers currently running - the sample buffer must not
+    be freed while any of them may still write into it. */
+std::atomic<size_t>    global_CpuSampleHandlersRunning(0);
+CpuSample*             global_CpuSamples = NULL;
+size_t                 global_CpuSamplesMax = 0;
+size_t                 global_CpuSamplingFrequency = 0;
+struct sigaction       global_CpuSamplingSavedAction;
+
+static inline uint64_t cpu_sample_thread_id() {
+#if defined(_TARGET_OS_LINUX)
+  return (uint64_t)syscall(SYS_gettid);
+#else
+  return (uint64_t)pthread_self();
+#endif
+}
+
+static void cpu_sample_context(void* vcontext, uintptr_t& pc, uintptr_t& bp, uintptr_t& sp) {
+  pc = 0;
+  bp = 0;
+  sp = 0;
+  ucontext_t* context = (ucontext_t*)vcontext;
+  if (!context) return;
+#if defined(_TARGET_OS_LINUX) && defined(__x86_64__)
+  pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+  bp = (uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+  sp = (uintptr_t)context->uc_mcontext.gregs[REG_RSP];
+#elif defined(_TARGET_OS_LINUX) && defined(__aarch64__)
+  pc = (uintptr_t)context->uc_mcontext.pc;
+  bp = (uintptr_t)context->uc_mcontext.regs[29];
+  sp = (uintptr_t)context->uc_mcontext.sp;
+#elif defined(_TARGET_OS_DARWIN) && defined(__x86_64__)
+  pc = (uintptr_t)context->uc_mcontext->__ss.__rip;
+  bp = (uintptr_t)context->uc_mcontext->__ss.__rbp;
+  sp = (uintptr_t)context->uc_mcontext->__ss.__rsp;
+#elif defined(_TARGET_OS_FREEBSD) && defined(__x86_64__)
+  pc = (uintptr_t)context->uc_mcontext.mc_rip;
+  bp = (uintptr_t)context->uc_mcontext.mc_rbp;
+  sp = (uintptr_t)context->uc_mcontext.mc_rsp;
+#endif
+}
+
+static void cpu_sample_handler(int sig, siginfo_t* info, void* context) {
+  // Count ourselves as running before looking at global_CpuSampling so that
+  // once it is false and no handler is running none can touch the buffer
+  global_CpuSampleHandlersRunning.fetch_add(1);
+  if (!global_CpuSampling.load()) {
+    global_CpuSampleHandlersRunning.fetch_sub(1);
+    return;
+  }
+  int saved_errno = errno;
+  size_t index = global_CpuSamplesTaken.fetch_add(1,std::memory_order_relaxed);
+  if (index >= global_CpuSamplesMax) {
+    global_CpuSamplesTaken.fetch_sub(1,std::memory_order_relaxed);
+    global_CpuSamplesDropped.fetch_add(1,std::memory_order_relaxed);
+    errno = saved_errno;
+    global_CpuSampleHandlersRunning.fetch_sub(1);
+    return;
+  }
+  CpuSample& sample = global_CpuSamples[index];
+  sample._Thread = cpu_sample_thread_id();
+  uintptr_t pc, bp, sp;
+  cpu_sample_context(context,pc,bp,sp);
+  size_t depth = 0;
+  if (pc) sample._Frames[depth++] = pc;
+  // Only follow the frame pointer chain between the interrupted stack pointer and the
+  // top of the stack of a thread that clasp knows about.  Code built without frame
+  // pointers leaves anything in bp, and reading through that would fault in here.
+  uintptr_t stackTop = my_thread_low_level ? (uintptr_t)my_thread_low_level->_StackTop : 0;
+  while (bp && sp && stackTop && depth < CPU_SAMPLE_MAX_DEPTH) {
+    if ((bp & (sizeof(void*)-1)) || bp < sp || bp + 2*sizeof(void*) > stackTop) break;
+    uintptr_t next_bp = ((uintptr_t*)bp)[0];
+    uintptr_t return_address = ((uintptr_t*)bp)[1];
+    if (!return_address) break;
+    sample._Frames[depth++] = return_address;
+    if (next_bp <= bp) break;
+    bp = next_bp;
+  }
+  sample._Depth = depth;
+  errno = saved_errno;
+  global_CpuSampleHandlersRunning.fetch_sub(1);
+}
+
+/*! Wait for SIGPROF handlers on other threads that started before sampling was turned off */
+static void cpu_sample_wait_for_handlers() {
+  while (global_CpuSampleHandlersRunning.load() != 0) sched_yield();
+}
+
+CL_LAMBDA(&optional (frequency 100) (max-samples 100000));
+CL_DECLARE();
+CL_DOCSTRING(R"(Start sampling the CPU frequency times a second of process CPU time.
+Up to max-samples samples are kept - further samples are counted as dropped.
+Any previous samples are discarded.)");
+CL_DEFUN void core__start_cpu_sampling(size_t frequency, size_t max_samples) {
+  if (global_CpuSampling) SIMPLE_ERROR(BF("CPU sampling is already running"));
+  if (frequency == 0 || frequency > 10000) SIMPLE_ERROR(BF("The CPU sampling frequency must be between 1 and 10000 - it was %d") % frequency);
+  if (max_samples == 0) SIMPLE_ERROR(BF("max-samples must be positive"));
+  cpu_sample_wait_for_handlers();
+  if (global_CpuSamplesMax < max_samples) {
+    CpuSample* samples = (CpuSample*)malloc(sizeof(CpuSample)*max_samples);
+    if (!samples) SIMPLE_ERROR(BF("Could not allocate space for %d CPU samples") % max_samples);
+    if (global_CpuSamples) free(global_CpuSamples);
+    global_CpuSamples = samples;
+  }
+  global_CpuSamplesMax = max_samples;
+  global_CpuSamplesTaken = 0;
+  global_CpuSamplesDropped = 0;
+  global_CpuSamplingFrequency = frequency;
+  struct sigaction action;
+  memset(&action,0,sizeof(action));
+  action.sa_sigaction = cpu_sample_handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  if (sigaction(SIGPROF,&action,&global_CpuSamplingSavedAction) != 0) {
+    SIMPLE_ERROR(BF("Could not install the SIGPROF handler: %s") % strerror(errno));
+  }
+  global_CpuSampling = true;
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000/frequency;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF,&timer,NULL) != 0) {
+    int err = errno;
+    global_CpuSampling = false;
+    cpu_sample_wait_for_handlers();
+    sigaction(SIGPROF,&global_CpuSamplingSavedAction,NULL);
+    SIMPLE_ERROR(BF("Could not start the profiling timer: %s") % strerror(err));
+  }
+}
+
+CL_DOCSTRING("Stop CPU sampling and return (values samples-taken samples-dropped).");
+CL_DEFUN T_mv core__stop_cpu_sampling() {
+  if (global_CpuSampling) {
+    struct itimerval timer;
+    memset(&timer,0,sizeof(timer));
+    setitimer(ITIMER_PROF,&timer,NULL);
+    global_CpuSampling = false;
+    cpu_sample_wait_for_handlers();
+    sigaction(SIGPROF,&global_CpuSamplingSavedAction,NULL);
+  }
+  return Values(make_fixnum(global_CpuSamplesTaken.load()),make_fixnum(global_CpuSamplesDropped.load()));
+}
+
+static std::string cpu_sample_symbolize(uintptr_t address, std::map<uintptr_t,std::string>& cache) {
+  auto found = cache.find(address);
+  if (found != cache.end()) return found->second;
+  std::string name;
+  std::string symbol;
+  uintptr_t start, end;
+  char type;
+  Dl_info info;
+  if (lookup_address(address,symbol,start,end,type) && !symbol.empty()) {
+    name = symbol;
+  } else if (dladdr((void*)address,&info) && info.dli_sname) {
+    name = info.dli_sname;
+  } else {
+    stringstream ss;
+    ss << "0x" << std::hex << address;
+    name = ss.str();
+  }
+  if (name.size()>2 && name[0]=='_' && name[1]=='Z') {
+    int status;
+    char* demangled = abi::__cxa_demangle(name.c_str(),NULL,NULL,&status);
+    if (demangled && status==0) name = demangled;
+    if (demangled) free(demangled);
+  }
+  // ';' separates frames in the folded stacks format
+  for ( auto& c : name ) if (c==';') c = ':';
+  cache[address] = name;
+  return name;
+}
+
+static void write_cpu_profile_folded(FILE* fout) {
+  std::map<std::string,size_t> stacks;
+  std::map<uintptr_t,std::string> names;
+  uint64_t main_thread = (uint64_t)getpid();
+  size_t num = std::min(global_CpuSamplesTaken.load(),global_CpuSamplesMax);
+  for ( size_t idx=0; idx<num; ++idx ) {
+    CpuSample& sample = global_CpuSamples[idx];
+    stringstream ss;
+    if (sample._Thread == main_thread) ss << "main";
+    else ss << "thread-" << sample._Thread;
+    // Frames are innermost first - folded stacks are outermost first
+    for ( size_t frame = sample._Depth; frame > 0; --frame ) {
+      // Return addresses point after the call - back up one byte so the call is symbolized
+      uintptr_t address = sample._Frames[frame-1] - ((frame-1)==0 ? 0 : 1);
+      ss << ";" << cpu_sample_symbolize(address,names);
+    }
+    stacks[ss.str()]++;
+  }
+  for ( auto& entry : stacks ) {
+    fprintf(fout,"%s %zu\n", entry.first.c_str(), entry.second);
+  }
+}
+
+/*! Write the legacy gperftools CPU profile format that pprof reads */
+static void write_cpu_profile_pprof(FILE* fout) {
+  size_t num = std::min(global_CpuSamplesTaken.load(),global_CpuSamplesMax);
+  uintptr_t header[5] = { 0, 3, 0, (uintptr_t)(1000000/global_CpuSamplingFrequency), 0 };
+  fwrite(header,sizeof(uintptr_t),5,fout);
+  for ( size_t idx=0; idx<num; ++idx ) {
+    CpuSample& sample = global_CpuSamples[idx];
+    uintptr_t record[2] = { 1, sample._Depth };
+    fwrite(record,sizeof(uintptr_t),2,fout);
+    fwrite(sample._Frames,sizeof(uintptr_t),sample._Depth,fout);
+  }
+  uintptr_t trailer[3] = { 0, 1, 0 };
+  fwrite(trailer,sizeof(uintptr_t),3,fout);
+  FILE* maps = fopen("/proc/self/maps","r");
+  if (maps) {
+    char buffer[4096];
+    size_t got;
+    while ((got = fread(buffer,1,sizeof(buffer),maps))>0) fwrite(buffer,1,got,fout);
+    fclose(maps);
+  }
+}
+
+SYMBOL_EXPORT_SC_(KeywordPkg,folded);
+SYMBOL_EXPORT_SC_(KeywordPkg,pprof);
+
+CL_LAMBDA(filename &optional (format :folded));
+CL_DECLARE();
+CL_DOCSTRING(R"(Write the CPU samples to filename.
+format :folded writes one line per distinct stack, threads first and outermost frames next,
+suitable for flamegraph.pl - JIT'd functions are symbolized from the saved JIT symbol info.
+format :pprof writes the binary gperftools CPU profile that pprof reads - pprof can only
+symbolize addresses in the executable and shared libraries.)");
+CL_DEFUN size_t core__write_cpu_profile(T_sp filename, Symbol_sp format) {
+  if (global_CpuSampling) SIMPLE_ERROR(BF("Stop CPU sampling before writing the profile"));
+  if (!global_CpuSamples) SIMPLE_ERROR(BF("There are no CPU samples - use core:start-cpu-sampling"));
+  if (format != kw::_sym_folded && format != kw::_sym_pprof) {
+    SIMPLE_ERROR(BF("The CPU profile format must be :folded or :pprof - it was %s") % _rep_(format));
+  }
+  std::string fname = gc::As<String_sp>(cl__namestring(filename))->get_std_string();
+  FILE* fout = fopen(fname.c_str(),(format == kw::_sym_pprof) ? "wb" : "w");
+  if (!fout) SIMPLE_ERROR(BF("Could not open %s for writing: %s") % fname % strerror(errno));
+  if (format == kw::_sym_pprof) write_cpu_profile_pprof(fout);
+  else write_cpu_profile_folded(fout);
+  fclose(fout);
+  return std::min(global_CpuSamplesTaken.load(),global_CpuSamplesMax);
+}
+
+};
@@ -26,6 +26,7 @@ THE SOFTWARE.
 /* -^- */
 //#define DEBUG_LEVEL_FULL
 
+#include <string.h>
 #include <clasp/core/foundation.h>
 #include <clasp/core/common.h>
 #include <clasp/core/environment.h>
@@ -279,4 +280,320 @@ size_t_pair sequenceStartEnd(Symbol_sp fn_name, size_t vector_length, size_t sta
   return p;
 }
 
+/* ----------------------------------------------------------------------
+ * Kernels for FIND, POSITION, COUNT, MISMATCH and SEARCH on simple specialized
+ * vectors.  seqlib.lsp calls these when there is no key and the test agrees with
+ * EQL for the item.  Each returns a second value of T when it handled the vector,
+ * or NIL when there is no kernel for the vector type and the caller must use
+ * the generic loop.  START and END have already been checked by the caller.
+ */
+
+namespace {
+
+/* Which kernel to use for a vector, and a pointer to its raw elements. */
+enum KernelKind { kernel_none, kernel_byte, kernel_character, kernel_double, kernel_bit };
+
+struct KernelVector {
+  KernelKind  _Kind;
+  const void* _Data;
+  bool        _BaseString;
+};
+
+KernelVector kernel_vector(T_sp vec) {
+  if (SimpleBaseString_sp sbs = vec.asOrNull<SimpleBaseString_O>())
+    return KernelVector{kernel_byte, sbs->begin(), true};
+  if (SimpleVector_byte8_t_sp sv8 = vec.asOrNull<SimpleVector_byte8_t_O>())
+    return KernelVector{kernel_byte, sv8->begin(), false};
+  if (SimpleCharacterString_sp scs = vec.asOrNull<SimpleCharacterString_O>())
+    return KernelVector{kernel_character, scs->begin(), false};
+  if (SimpleVector_double_sp svd = vec.asOrNull<SimpleVector_double_O>())
+    return KernelVector{kernel_double, svd->begin(), false};
+  if (SimpleBitVector_sp sbv = vec.asOrNull<SimpleBitVector_O>())
+    return KernelVector{kernel_bit, sbv->bytes(), false};
+  return KernelVector{kernel_none, NULL, false};
+}
+
+/* Convert ITEM to the raw element representation of a vector.
+ * These return false if no element of such a vector can be EQL to ITEM. */
+bool byte_item(T_sp item, bool base_string, unsigned char& raw) {
+  // Base strings hold characters, (unsigned-byte 8) vectors hold fixnums
+  if (base_string) {
+    if (!item.characterp() || item.unsafe_character() > 255) return false;
+    raw = item.unsafe_character();
+    return true;
+  }
+  if (!item.fixnump() || item.unsafe_fixnum() < 0 || item.unsafe_fixnum() > 255) return false;
+  raw = item.unsafe_fixnum();
+  return true;
+}
+
+bool character_item(T_sp item, claspCharacter& raw) {
+  if (!item.characterp()) return false;
+  raw = item.unsafe_character();
+  return true;
+}
+
+bool double_item(T_sp item, uint64_t& raw) {
+  // EQL on double-floats compares the representation
+  if (DoubleFloat_sp df = item.asOrNull<DoubleFloat_O>()) {
+    double d = df->get();
+    memcpy(&raw, &d, sizeof(raw));
+    return true;
+  }
+  return false;
+}
+
+template <typename Elt>
+Fixnum kernel_position(const Elt* data, Elt item, size_t start, size_t end, bool from_end) {
+  if (from_end) {
+    for (size_t i = end; i > start; --i) if (data[i-1] == item) return i-1;
+  } else {
+    for (size_t i = start; i < end; ++i) if (data[i] == item) return i;
+  }
+  return -1;
+}
+
+template <>
+Fixnum kernel_position<unsigned char>(const unsigned char* data, unsigned char item, size_t start, size_t end, bool from_end) {
+  if (start >= end) return -1;
+#ifdef _TARGET_OS_LINUX
+  const void* found = from_end ? memrchr(data+start, item, end-start) : memchr(data+start, item, end-start);
+#else
+  if (from_end) {
+    for (size_t i = end; i > start; --i) if (data[i-1] == item) return i-1;
+    return -1;
+  }
+  const void* found = memchr(data+start, item, end-start);
+#endif
+  return found ? (const unsigned char*)found - data : -1;
+}
+
+template <typename Elt>
+size_t kernel_count(const Elt* data, Elt item, size_t start, size_t end) {
+  // No early exit so this loop vectorizes
+  size_t count = 0;
+  for (size_t i = start; i < end; ++i) count += (data[i] == item);
+  return count;
+}
+
+/* Number of equal elements at the front (or the back if from_end) of two ranges of length n.
+ * Chunks are compared with memcmp, which is vectorized, and only the chunk that differs
+ * is scanned element by element. */
+template <typename Elt>
+size_t kernel_common_run(const Elt* a, const Elt* b, size_t n, bool from_end) {
+  const size_t chunk = 64/sizeof(Elt);
+  size_t i = 0;
+  if (from_end) {
+    while (i+chunk <= n && memcmp(a+n-i-chunk, b+n-i-chunk, chunk*sizeof(Elt)) == 0) i += chunk;
+    while (i < n && a[n-i-1] == b[n-i-1]) ++i;
+  } else {
+    while (i+chunk <= n && memcmp(a+i, b+i, chunk*sizeof(Elt)) == 0) i += chunk;
+    while (i < n && a[i] == b[i]) ++i;
+  }
+  return i;
+}
+
+template <typename Elt>
+T_sp kernel_mismatch(const Elt* d1, size_t start1, size_t end1,
+                     const Elt* d2, size_t start2, size_t end2, bool from_end) {
+  size_t len1 = end1-start1, len2 = end2-start2;
+  size_t n = MIN(len1, len2);
+  if (from_end) {
+    size_t run = kernel_common_run(d1+end1-n, d2+end2-n, n, true);
+    if (run < n || len1 != len2) return make_fixnum(end1-run);
+  } else {
+    size_t run = kernel_common_run(d1+start1, d2+start2, n, false);
+    if (run < n || len1 != len2) return make_fixnum(start1+run);
+  }
+  return _Nil<T_O>();
+}
+
+/* Search for the pattern p[start1,end1) in d[start2,end2) - scan for the first
+ * element of the pattern and compare the rest with memcmp. */
+template <typename Elt>
+Fixnum kernel_search(const Elt* p, size_t start1, size_t end1,
+                     const Elt* d, size_t start2, size_t end2, bool from_end) {
+  size_t plen = end1-start1;
+  if (plen == 0) return from_end ? end2 : start2;
+  if (end2-start2 < plen) return -1;
+  size_t last = end2-plen;  // last index where the pattern can start
+  Elt first = p[start1];
+  if (from_end) {
+    for (Fixnum i = kernel_position(d, first, start2, last+1, true); i >= 0;
+         i = (i > (Fixnum)start2) ? kernel_position(d, first, start2, i, true) : -1) {
+      if (memcmp(d+i+1, p+start1+1, (plen-1)*sizeof(Elt)) == 0) return i;
+    }
+  } else {
+    for (Fixnum i = kernel_position(d, first, start2, last+1, false); i >= 0;
+         i = kernel_position(d, first, i+1, last+1, false)) {
+      if (memcmp(d+i+1, p+start1+1, (plen-1)*sizeof(Elt)) == 0) return i;
+    }
+  }
+  return -1;
+}
+
+template <>
+Fixnum kernel_search<unsigned char>(const unsigned char* p, size_t start1, size_t end1,
+                                    const unsigned char* d, size_t start2, size_t end2, bool from_end) {
+  size_t plen = end1-start1;
+  if (plen == 0) return from_end ? end2 : start2;
+  if (end2-start2 < plen) return -1;
+  if (!from_end) {
+    // glibc memmem uses the Two-Way algorithm and vectorized scans for short needles
+    const void* found = memmem(d+start2, end2-start2, p+start1, plen);
+    return found ? (const unsigned char*)found - d : -1;
+  }
+  size_t last = end2-plen;
+  for (Fixnum i = kernel_position(d, p[start1], start2, last+1, true); i >= 0;
+       i = (i > (Fixnum)start2) ? kernel_position(d, p[start1], start2, i, true) : -1) {
+    if (memcmp(d+i+1, p+start1+1, plen-1) == 0) return i;
+  }
+  return -1;
+}
+
+bool bit_item(T_sp item, bool& bit) {
+  if (item.fixnump() && (item.unsafe_fixnum() == 0 || item.unsafe_fixnum() == 1)) {
+    bit = item.unsafe_fixnum();
+    return true;
+  }
+  return false;
+}
+
+};
+
+CL_LAMBDA(item vector start end from-end);
+CL_DECLARE();
+CL_DOCSTRING("Return the index of the first (or last if FROM-END) element of the simple specialized VECTOR between START and END that is EQL to ITEM, or NIL. The second value is NIL if VECTOR has no kernel.");
+CL_DEFUN T_mv core__vector_position_eql(T_sp item, T_sp vector, size_t start, size_t end, bool from_end) {
+  KernelVector kv = kernel_vector(vector);
+  Fixnum index = -1;
+  switch (kv._Kind) {
+  case kernel_none:
+      return Values(_Nil<T_O>(), _Nil<T_O>());
+  case kernel_byte: {
+      unsigned char raw;
+      if (byte_item(item, kv._BaseString, raw))
+        index = kernel_position((const unsigned char*)kv._Data, raw, start, end, from_end);
+      break;
+  }
+  case kernel_character: {
+      claspCharacter raw;
+      if (character_item(item, raw))
+        index = kernel_position((const claspCharacter*)kv._Data, raw, start, end, from_end);
+      break;
+  }
+  case kernel_double: {
+      uint64_t raw;
+      if (double_item(item, raw))
+        index = kernel_position((const uint64_t*)kv._Data, raw, start, end, from_end);
+      break;
+  }
+  case kernel_bit: {
+      bool bit;
+      if (bit_item(item, bit))
+        index = bit_vector_position((const bit_array_word*)kv._Data, bit, start, end, from_end);
+      break;
+  }
+  }
+  return Values(index < 0 ? _Nil<T_O>() : make_fixnum(index), _lisp->_true());
+}
+
+CL_LAMBDA(item vector start end);
+CL_DECLARE();
+CL_DOCSTRING("Return the number of elements of the simple specialized VECTOR between START and END that are EQL to ITEM. The second value is NIL if VECTOR has no kernel.");
+CL_DEFUN T_mv core__vector_count_eql(T_sp item, T_sp vector, size_t start, size_t end) {
+  KernelVector kv = kernel_vector(vector);
+  size_t count = 0;
+  switch (kv._Kind) {
+  case kernel_none:
+      return Values(_Nil<T_O>(), _Nil<T_O>());
+  case kernel_byte: {
+      unsigned char raw;
+      if (byte_item(item, kv._BaseString, raw))
+        count = kernel_count((const unsigned char*)kv._Data, raw, start, end);
+      break;
+  }
+  case kernel_character: {
+      claspCharacter raw;
+      if (character_item(item, raw))
+        count = kernel_count((const claspCharacter*)kv._Data, raw, start, end);
+      break;
+  }
+  case kernel_double: {
+      uint64_t raw;
+      if (double_item(item, raw))
+        count = kernel_count((const uint64_t*)kv._Data, raw, start, end);
+      break;
+  }
+  case kernel_bit: {
+      bool bit;
+      if (bit_item(item, bit)) {
+        size_t ones = bit_vector_count_ones((const bit_array_word*)kv._Data, start, end);
+        count = bit ? ones : (end-start)-ones;
+      }
+      break;
+  }
+  }
+  return Values(make_fixnum(count), _lisp->_true());
+}
+
+/* MISMATCH and SEARCH need both vectors to have the same kernel.  Base strings and
+ * (unsigned-byte 8) vectors share a representation but their elements are never EQL. */
+static bool kernel_same_kind(const KernelVector& kv1, const KernelVector& kv2) {
+  if (kv1._Kind == kernel_none || kv1._Kind == kernel_bit) return false;
+  return kv1._Kind == kv2._Kind && kv1._BaseString == kv2._BaseString;
+}
+
+CL_LAMBDA(vector1 start1 end1 vector2 start2 end2 from-end);
+CL_DECLARE();
+CL_DOCSTRING("MISMATCH with an EQL test on two simple specialized vectors of the same kind. The second value is NIL if there is no kernel for the vectors.");
+CL_DEFUN T_mv core__vector_mismatch_eql(T_sp vector1, size_t start1, size_t end1,
+                                        T_sp vector2, size_t start2, size_t end2, bool from_end) {
+  KernelVector kv1 = kernel_vector(vector1);
+  KernelVector kv2 = kernel_vector(vector2);
+  if (!kernel_same_kind(kv1, kv2)) return Values(_Nil<T_O>(), _Nil<T_O>());
+  T_sp result;
+  switch (kv1._Kind) {
+  case kernel_byte:
+      result = kernel_mismatch((const unsigned char*)kv1._Data, start1, end1,
+                               (const unsigned char*)kv2._Data, start2, end2, from_end);
+      break;
+  case kernel_character:
+      result = kernel_mismatch((const claspCharacter*)kv1._Data, start1, end1,
+                               (const claspCharacter*)kv2._Data, start2, end2, from_end);
+      break;
+  default:
+      result = kernel_mismatch((const uint64_t*)kv1._Data, start1, end1,
+                               (const uint64_t*)kv2._Data, start2, end2, from_end);
+      break;
+  }
+  return Values(result, _lisp->_true());
+}
+
+CL_LAMBDA(vector1 start1 end1 vector2 start2 end2 from-end);
+CL_DECLARE();
+CL_DOCSTRING("SEARCH with an EQL test for VECTOR1 in VECTOR2, two simple specialized vectors of the same kind. The second value is NIL if there is no kernel for the vectors.");
+CL_DEFUN T_mv core__vector_search_eql(T_sp vector1, size_t start1, size_t end1,
+                                      T_sp vector2, size_t start2, size_t end2, bool from_end) {
+  KernelVector kv1 = kernel_vector(vector1);
+  KernelVector kv2 = kernel_vector(vector2);
+  if (!kernel_same_kind(kv1, kv2)) return Values(_Nil<T_O>(), _Nil<T_O>());
+  Fixnum index;
+  switch (kv1._Kind) {
+  case kernel_byte:
+      index = kernel_search((const unsigned char*)kv1._Data, start1, end1,
+                            (const unsigned char*)kv2._Data, start2, end2, from_end);
+      break;
+  case kernel_character:
+      index = kernel_search((const claspCharacter*)kv1._Data, start1, end1,
+                            (const claspCharacter*)kv2._Data, start2, end2, from_end);
+      break;
+  default:
+      index = kernel_search((const uint64_t*)kv1._Data, start1, end1,
+                            (const uint64_t*)kv2._Data, start2, end2, from_end);
+      break;
+  }
+  return Values(index < 0 ? _Nil<T_O>() : make_fixnum(index), _lisp->_true());
+}
+
 }; /* core */
@@ -86,6 +86,12 @@ typedef int mode_t;
 #endif
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#if defined(_TARGET_OS_LINUX)
+#include <sys/syscall.h>
+#endif
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <clasp/core/pathname.h>
 #include <clasp/core/array.h>
@@ -100,6 +106,7 @@ typedef int mode_t;
 #include <clasp/core/lispList.h>
 #include <clasp/core/lispStream.h>
 #include <clasp/core/unixfsys.h>
+#include <clasp/core/mpPackage.h>
 #include <clasp/core/wrappers.h>
 
 #if defined( DEBUG_LEVEL_FULL )
@@ -301,6 +308,241 @@ CL_DEFUN T_mv core__fork_redirect(int stdout_fd, int stderr_fd) {
 };
 
 
+/*! Fork server primitives - see src/lisp/kernel/lsp/fork-server.lsp for the server loop.
+    A client connects to the Unix domain socket and sends a single message whose payload
+    is the request string and whose SCM_RIGHTS ancillary data carries its stdin, stdout and
+    stderr.  When the forked worker exits the server writes the raw wait status as a decimal
+    line to the connection and closes it.
+*/
+#define FORK_SERVER_MAX_REQUEST 65536
+#define FORK_SERVER_PASSED_FDS 3
+
+CL_LAMBDA(socket-path &optional (backlog 16));
+CL_DECLARE();
+CL_DOCSTRING("Create a Unix domain socket bound to socket-path that listens for fork server requests and return its file descriptor.");
+CL_DEFUN int core__fork_server_listen(String_sp socket_path, int backlog) {
+  std::string path = socket_path->get_std_string();
+  struct sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    SIMPLE_ERROR(BF("The fork server socket path %s is longer than %d characters") % path % (sizeof(addr.sun_path)-1));
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) SIMPLE_ERROR(BF("Could not create the fork server socket: %s") % std::strerror(errno));
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+  unlink(path.c_str());
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+    int err = errno;
+    close(fd);
+    SIMPLE_ERROR(BF("Could not listen on the fork server socket %s: %s") % path % std::strerror(err));
+  }
+  return fd;
+};
+
+CL_LAMBDA(listen-fd &optional (timeout-ms -1));
+CL_DECLARE();
+CL_DOCSTRING(R"(Wait up to timeout-ms milliseconds (forever if negative) for a fork server request on listen-fd.
+Returns NIL on timeout or (values connection-fd request stdin-fd stdout-fd stderr-fd).)");
+CL_DEFUN T_mv core__fork_server_accept(int listen_fd, int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = listen_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int ready = poll(&pfd, 1, timeout_ms);
+  if (ready == 0 || (ready < 0 && errno == EINTR)) return Values(_Nil<T_O>());
+  if (ready < 0) SIMPLE_ERROR(BF("poll on the fork server socket failed: %s") % std::strerror(errno));
+  int conn;
+  while ((conn = accept(listen_fd, NULL, NULL)) < 0 && errno == EINTR) {}
+  if (conn < 0) {
+    if (errno == EAGAIN || errno == ECONNABORTED) return Values(_Nil<T_O>());
+    SIMPLE_ERROR(BF("accept on the fork server socket failed: %s") % std::strerror(errno));
+  }
+  fcntl(conn, F_SETFD, FD_CLOEXEC);
+  std::string request(FORK_SERVER_MAX_REQUEST, '\0');
+  struct iovec iov;
+  iov.iov_base = (void*)request.data();
+  iov.iov_len = request.size();
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int)*FORK_SERVER_PASSED_FDS)];
+  } control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+  ssize_t got;
+  while ((got = recvmsg(conn, &msg, 0)) < 0 && errno == EINTR) {}
+  int fds[FORK_SERVER_PASSED_FDS] = {-1,-1,-1};
+  size_t nfds = 0;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      nfds = (cmsg->cmsg_len - CMSG_LEN(0))/sizeof(int);
+      memcpy(fds, CMSG_DATA(cmsg), sizeof(int)*std::min(nfds,(size_t)FORK_SERVER_PASSED_FDS));
+    }
+  }
+  if (got <= 0 || nfds != FORK_SERVER_PASSED_FDS || (msg.msg_flags & MSG_CTRUNC)) {
+    // Malformed request - drop the connection and whatever descriptors came with it
+    for (size_t i = 0; i < std::min(nfds,(size_t)FORK_SERVER_PASSED_FDS); ++i) close(fds[i]);
+    close(conn);
+    return Values(_Nil<T_O>());
+  }
+  request.resize(got);
+  return Values(make_fixnum(conn),
+                SimpleBaseString_O::make(request),
+                make_fixnum(fds[0]), make_fixnum(fds[1]), make_fixnum(fds[2]));
+};
+
+CL_LAMBDA(listen-fd connection-fd stdin-fd stdout-fd stderr-fd);
+CL_DECLARE();
+CL_DOCSTRING(R"(Fork a fork server worker. In the child the passed descriptors replace
+stdin/stdout/stderr, the server descriptors are closed and processes that did not survive
+the fork are marked as exited - the result is 0.  In the parent the passed descriptors are
+closed and the child pid is returned.)");
+CL_DEFUN int core__fork_server_fork(int listen_fd, int connection_fd, int stdin_fd, int stdout_fd, int stderr_fd) {
+  pid_t pid;
+  {
+    // Park the collector so that no collection is in flight while the heap is duplicated.
+    // Boehm also runs its own atfork handlers because initializeBoehm calls GC_set_handle_fork(1).
+    // Holding the active threads lock across fork() guarantees that the child
+    // does not inherit it in a locked state.
+    gctools::SafeGCPark park;
+    WITH_READ_WRITE_LOCK(_lisp->_Roots._ActiveThreadsMutex);
+    pid = fork();
+    if (pid == 0) {
+      // Only the thread that called fork() exists in the child
+      List_sp survivors = _Nil<T_O>();
+      for ( auto cur : (List_sp)_lisp->_Roots._ActiveThreads ) {
+        mp::Process_sp process = gc::As<mp::Process_sp>(oCar(cur));
+        if (process == my_thread->_Process) survivors = Cons_O::create(process,survivors);
+        else process->_Phase = mp::Exited;
+      }
+      _lisp->_Roots._ActiveThreads = survivors;
+    }
+  }
+  if (pid < 0) {
+    int err = errno;
+    close(stdin_fd);
+    close(stdout_fd);
+    close(stderr_fd);
+    SIMPLE_ERROR(BF("The fork server could not fork: %s") % std::strerror(err));
+  }
+  if (pid == 0) {
+    close(listen_fd);
+    close(connection_fd);
+    int passed[FORK_SERVER_PASSED_FDS] = {stdin_fd, stdout_fd, stderr_fd};
+    for ( int target = 0; target < FORK_SERVER_PASSED_FDS; ++target ) {
+      while ((dup2(passed[target],target) == -1) && (errno == EINTR)) {}
+    }
+    for ( int target = 0; target < FORK_SERVER_PASSED_FDS; ++target ) {
+      if (passed[target] >= FORK_SERVER_PASSED_FDS) close(passed[target]);
+    }
+    return 0;
+  }
+  close(stdin_fd);
+  close(stdout_fd);
+  close(stderr_fd);
+  return pid;
+};
+
+CL_LAMBDA(connection-fd status);
+CL_DECLARE();
+CL_DOCSTRING("Send the wait status of a fork server worker to its client and close the connection.");
+CL_DEFUN void core__fork_server_report_status(int connection_fd, int status) {
+  std::string line = std::to_string(status) + "\n";
+  const char* cur = line.data();
+  size_t left = line.size();
+  while (left > 0) {
+    ssize_t wrote = send(connection_fd, cur, left, MSG_NOSIGNAL);
+    if (wrote < 0) {
+      if (errno == EINTR) continue;
+      break; // The client went away - nothing left to tell it
+    }
+    cur += wrote;
+    left -= wrote;
+  }
+  close(connection_fd);
+};
+
+CL_LAMBDA(socket-path request &optional (stdin-fd 0) (stdout-fd 1) (stderr-fd 2));
+CL_DECLARE();
+CL_DOCSTRING(R"(Send request to the fork server listening on socket-path, passing it stdin-fd, stdout-fd
+and stderr-fd, and wait for the worker to exit.  Returns the worker's wait status.  This is the
+client side that src/fork-server/fork-run.c implements for the shell.)");
+CL_DEFUN int core__fork_server_request(String_sp socket_path, String_sp request, int stdin_fd, int stdout_fd, int stderr_fd) {
+  std::string path = socket_path->get_std_string();
+  std::string payload = request->get_std_string();
+  if (payload.empty()) payload = "\n"; // a message with no payload would look like EOF
+  if (payload.size() > FORK_SERVER_MAX_REQUEST) {
+    SIMPLE_ERROR(BF("The fork server request is longer than %d bytes") % FORK_SERVER_MAX_REQUEST);
+  }
+  struct sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    SIMPLE_ERROR(BF("The fork server socket path %s is longer than %d characters") % path % (sizeof(addr.sun_path)-1));
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) SIMPLE_ERROR(BF("Could not create a fork server client socket: %s") % std::strerror(errno));
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    int err = errno;
+    close(fd);
+    SIMPLE_ERROR(BF("Could not connect to the fork server socket %s: %s") % path % std::strerror(err));
+  }
+  int fds[FORK_SERVER_PASSED_FDS] = {stdin_fd, stdout_fd, stderr_fd};
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(fds))];
+  } control;
+  struct iovec iov;
+  iov.iov_base = (void*)payload.data();
+  iov.iov_len = payload.size();
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  ssize_t sent;
+  while ((sent = sendmsg(fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) {}
+  if (sent < 0) {
+    int err = errno;
+    close(fd);
+    SIMPLE_ERROR(BF("Could not send the fork server request: %s") % std::strerror(err));
+  }
+  std::string reply;
+  char buffer[64];
+  for (;;) {
+    ssize_t got = read(fd, buffer, sizeof(buffer));
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) break;
+    reply.append(buffer, got);
+  }
+  close(fd);
+  if (reply.empty()) {
+    SIMPLE_ERROR(BF("The fork server closed the connection without a status"));
+  }
+  return atoi(reply.c_str());
+};
+
+CL_LAMBDA(listen-fd socket-path);
+CL_DECLARE();
+CL_DOCSTRING("Close the fork server socket and remove socket-path.");
+CL_DEFUN void core__fork_server_close(int listen_fd, String_sp socket_path) {
+  close(listen_fd);
+  unlink(socket_path->get_std_string().c_str());
+};
+
 CL_DOCSTRING(R"(wait - see unix wait - returns (values pid status).
 The status can be passed to //core:wifexited// and //core:wifsignaled//. )");
 CL_DEFUN T_mv core__wait() {
@@ -1205,16 +1447,164 @@ CL_DEFUN Pathname_sp cl__user_homedir_pathname(T_sp host) {
   return clasp_homedir_pathname(_Nil<T_O>());
 }
 
+/*
+ * The lisp string PATTERN as bytes, for matching raw file names with
+ * clasp_stringMatchBytes. False if it has characters that aren't bytes.
+ */
 static bool
-string_match(const char *s, T_sp pattern) {
-  if (pattern.nilp() || pattern == kw::_sym_wild) {
-    return 1;
-  } else {
-    int ls = strlen(s);
-    String_sp strng = Str8Ns_O::create(s, strlen(s));
-    return clasp_stringMatch(strng, 0, ls,
-                             pattern, 0, cl__length(pattern));
+pattern_bytes(T_sp pattern, std::string &bytes) {
+  String_sp spattern = gc::As<String_sp>(pattern);
+  size_t len = cl__length(spattern);
+  bytes.clear();
+  bytes.reserve(len);
+  for (size_t i = 0; i < len; ++i) {
+    claspCharacter c = cl__char(spattern, i).unsafe_character();
+    if (c > 255) return false;
+    bytes.push_back((char)c);
+  }
+  return true;
+}
+
+/*
+ * A wildcard pattern for matching raw directory entry names. An empty
+ * FileMask matches everything.
+ */
+struct FileMask {
+  std::vector<std::string> _Alternatives;
+  bool _MatchAll;
+  T_sp _Pattern; // for patterns that aren't bytes
+  FileMask() : _MatchAll(true), _Pattern(_Nil<T_O>()) {};
+  bool match(const std::string &name) const {
+    if (this->_MatchAll) return true;
+    if (this->_Pattern.notnilp()) {
+      String_sp strng = Str8Ns_O::create(name.c_str(), name.size());
+      return clasp_stringMatch(strng, 0, name.size(),
+                               this->_Pattern, 0, cl__length(this->_Pattern));
+    }
+    for (auto &alternative : this->_Alternatives) {
+      if (clasp_stringMatchBytes(name.c_str(), 0, name.size(),
+                                 alternative.c_str(), 0, alternative.size()))
+        return true;
+    }
+    return false;
   }
+};
+
+/*
+ * The mask for a directory component: NIL or :WILD match everything.
+ */
+static FileMask
+text_file_mask(T_sp pattern) {
+  FileMask mask;
+  if (pattern.nilp() || pattern == kw::_sym_wild) return mask;
+  mask._MatchAll = false;
+  std::string bytes;
+  if (pattern_bytes(pattern, bytes))
+    mask._Alternatives.push_back(bytes);
+  else
+    mask._Pattern = pattern;
+  return mask;
+}
+
+/*
+ * A cheap test that rejects directory entries that can't match the name
+ * and type of PATHNAME_MASK, so no pathname has to be made for them.
+ * Anything it passes still goes through PATHNAME-MATCH-P. An entry whose
+ * pathname has a type is always "name.type", so a string type T gives
+ * "N.T" (N the name pattern, or * if the name is wild). Otherwise a string
+ * name N gives "N" or "N.*".
+ */
+static FileMask
+pathname_file_mask(T_sp pathname_mask) {
+  FileMask mask;
+  if (pathname_mask.nilp()) return mask;
+  Pathname_sp pmask = cl__pathname(pathname_mask);
+  T_sp name = pmask->_Name;
+  T_sp type = pmask->_Type;
+  std::string name_bytes("*"), type_bytes;
+  bool name_string = cl__stringp(name);
+  bool type_string = cl__stringp(type);
+  if (name_string && !pattern_bytes(name, name_bytes)) return mask;
+  if (type_string && !pattern_bytes(type, type_bytes)) return mask;
+  if (type_string && (name_string || name == kw::_sym_wild)) {
+    mask._MatchAll = false;
+    mask._Alternatives.push_back(name_bytes + "." + type_bytes);
+  } else if (name_string) {
+    mask._MatchAll = false;
+    mask._Alternatives.push_back(name_bytes);
+    mask._Alternatives.push_back(name_bytes + ".*");
+  }
+  return mask;
+}
+
+#ifndef DT_UNKNOWN
+#define DT_UNKNOWN 0
+#endif
+
+/*
+ * A directory entry as the kernel reports it: its name and, if the file
+ * system knows it, its d_type (otherwise DT_UNKNOWN).
+ */
+struct DirectoryEntry {
+  std::string _Name;
+  unsigned char _Type;
+  DirectoryEntry(const char *name, unsigned char type) : _Name(name), _Type(type) {};
+};
+
+static inline bool
+dot_or_dot_dot(const char *text) {
+  return (text[0] == '.' &&
+          (text[1] == '\0' ||
+           (text[1] == '.' && text[2] == '\0')));
+}
+
+/*
+ * scan_directory() reads the entries of the directory PATH, except . and ..,
+ * into ENTRIES. On Linux it reads them straight from getdents64 in 64KB
+ * batches rather than one readdir call at a time. Returns false if the
+ * directory can't be opened.
+ */
+static bool
+scan_directory(const char *path, std::vector<DirectoryEntry> &entries) {
+#if defined(_TARGET_OS_LINUX) && defined(SYS_getdents64)
+  struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+  };
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return false;
+  std::vector<char> buffer(65536);
+  for (;;) {
+    long nread = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+    if (nread < 0 && errno == EINTR) continue;
+    if (nread <= 0) break;
+    for (long pos = 0; pos < nread;) {
+      struct linux_dirent64 *entry = reinterpret_cast<struct linux_dirent64 *>(&buffer[pos]);
+      pos += entry->d_reclen;
+      if (!dot_or_dot_dot(entry->d_name))
+        entries.emplace_back(entry->d_name, entry->d_type);
+    }
+  }
+  close(fd);
+  return true;
+#else
+  DIR *dir = opendir(path);
+  if (dir == NULL) return false;
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    if (dot_or_dot_dot(entry->d_name)) continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+    entries.emplace_back(entry->d_name, entry->d_type);
+#else
+    entries.emplace_back(entry->d_name, DT_UNKNOWN);
+#endif
+  }
+  closedir(dir);
+  return true;
+#endif
 }
 
 /*
@@ -1222,110 +1612,53 @@ string_match(const char *s, T_sp pattern) {
  * in the current working directory (as given by current_dir()). If ONLY_DIR is
  * true, the list is made of only the directories -- a propert which is checked
  * by following the symlinks.
+ *
+ * Entries are matched against the masks as raw names first, and the
+ * directory's d_type tells regular files and directories apart without a
+ * stat; only links and entries of unknown type go through file_truename.
+ * BASE_DIR is a truename, so a real file or directory in it is its own.
  */
 static T_sp
 list_directory(T_sp base_dir, T_sp text_mask, T_sp pathname_mask, int flags) {
   T_sp out = _Nil<T_O>();
   if (base_dir.nilp()) SIMPLE_ERROR(BF("%s is about to pass NIL to clasp_namestring") % __FUNCTION__);
   T_sp prefix = clasp_namestring(base_dir, CLASP_NAMESTRING_FORCE_BASE_STRING);
-  T_sp component, component_path, kind;
-  char *text;
-#if defined(HAVE_DIRENT_H)
-  DIR *dir;
-  struct dirent *entry;
-
-  clasp_disable_interrupts();
-  dir = opendir((char *)gc::As<String_sp>(prefix)->get_std_string().c_str());
-  if (dir == NULL) {
-    out = _Nil<T_O>();
-    goto OUTPUT;
-  }
-
-  while ((entry = readdir(dir))) {
-    text = entry->d_name;
-#else
-#ifdef CLASP_MS_WINDOWS_HOST
-  WIN32_FIND_DATA fd;
-  HANDLE hFind = NULL;
-  BOOL found = false;
-
-  clasp_disable_interrupts();
-  for (;;) {
-    if (hFind == NULL) {
-      T_sp aux = make_constant_base_string(".\\*");
-      T_sp mask = base_string_concatenate(2, prefix, aux);
-      hFind = FindFirstFile((char *)mask->c_str(), &fd);
-      if (hFind == INVALID_HANDLE_VALUE) {
-        out = _Nil<T_O>();
-        goto OUTPUT;
-      }
-      found = true;
-    } else {
-      found = FindNextFile(hFind, &fd);
-    }
-    if (!found)
-      break;
-    text = fd.cFileName;
-#else  /* sys/dir.h as in SYSV */
-  FILE *fp;
-  char iobuffer[BUFSIZ];
-  DIRECTORY dir;
-
+  std::string str_prefix = gc::As<String_sp>(prefix)->get_std_string();
+  std::vector<DirectoryEntry> entries;
   clasp_disable_interrupts();
-  fp = fopen((char *)prefix->c_str(), OPEN_R);
-  if (fp == NULL) {
-    out = _Nil<T_O>();
-    goto OUTPUT;
-  }
-  setbuf(fp, iobuffer);
-  for (;;) {
-    if (fread(&dir, sizeof(DIRECTORY), 1, fp) <= 0)
-      break;
-    if (dir.d_ino == 0)
-      continue;
-    text = dir.d_name;
-#endif /* !CLASP_MS_WINDOWS_HOST */
-#endif /* !HAVE_DIRENT_H */
-    if (text[0] == '.' &&
-        (text[1] == '\0' ||
-         (text[1] == '.' && text[2] == '\0')))
+  bool opened = scan_directory(str_prefix.c_str(), entries);
+  clasp_enable_interrupts();
+  if (!opened) return out;
+  FileMask text_filter = text_file_mask(text_mask);
+  FileMask pathname_filter = pathname_file_mask(pathname_mask);
+  for (auto &entry : entries) {
+    if (!text_filter.match(entry._Name))
       continue;
-    if (!string_match(text, text_mask))
+    if (!pathname_filter.match(entry._Name))
       continue;
-    component = SimpleBaseString_O::make(std::string(text));
-#if 1
-    stringstream concat;
-    String_sp str_prefix = coerce::stringDesignator(prefix);
-    concat << str_prefix->get_std_string();
-    String_sp str_component = coerce::stringDesignator(component);
-    concat << str_component->get_std_string();
     // TODO Support proper strings
-    component = SimpleBaseString_O::make(concat.str());
-#else
-    component = base_string_concatenate(LCC_PASS_ARGS2_ELLIPSIS(prefix.raw_(), component.raw_()));
-#endif
-    if (component.nilp()) SIMPLE_ERROR(BF("%s was about to pass nil to pathname") % __FUNCTION__);
-    component_path = cl__pathname(component);
+    std::string namestring = str_prefix + entry._Name;
+    T_sp component = SimpleBaseString_O::make(namestring);
+    T_sp component_path = cl__pathname(component);
     if (!pathname_mask.nilp()) {
       if (!cl__pathname_match_p(component, pathname_mask)) // should this not be inverted?
         continue;
     }
-    T_mv component_path_mv = file_truename(component_path, component, flags);
-    component_path = component_path_mv;
-    kind = component_path_mv.valueGet_(1);
+    T_sp kind;
+    if (entry._Type == DT_REG) {
+      kind = kw::_sym_file;
+      gc::As<Pathname_sp>(component_path)->_Version = kw::_sym_newest;
+    } else if (entry._Type == DT_DIR) {
+      kind = kw::_sym_directory;
+      component_path = cl__pathname(SimpleBaseString_O::make(namestring + DIR_SEPARATOR));
+      gc::As<Pathname_sp>(component_path)->_Version = _Nil<T_O>();
+    } else {
+      T_mv component_path_mv = file_truename(component_path, component, flags);
+      component_path = component_path_mv;
+      kind = component_path_mv.valueGet_(1);
+    }
     out = Cons_O::create(Cons_O::create(component_path, kind), out);
   }
-#ifdef HAVE_DIRENT_H
-  closedir(dir);
-#else
-#ifdef CLASP_MS_WINDOWS_HOST
-  FindClose(hFind);
-#else
-  fclose(fp);
-#endif /* !CLASP_MS_WINDOWS_HOST */
-#endif /* !HAVE_DIRENT_H */
-  clasp_enable_interrupts();
-OUTPUT:
   return cl__nreverse(out);
 }
 
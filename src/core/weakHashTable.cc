@@ -56,8 +56,47 @@ double WeakKeyHashTable_O::rehash_threshold() {
   return this->_HashTable._RehashThreshold;
 }
 
+T_sp WeakKeyHashTable_O::hashTableTest() const {
+  switch (this->_HashTable._Test) {
+  case gctools::WeakTestEq: return cl::_sym_eq;
+  case gctools::WeakTestEql: return cl::_sym_eql;
+  case gctools::WeakTestEqual: return cl::_sym_equal;
+  default: return cl::_sym_equalp;
+  }
+}
+
 T_sp WeakKeyHashTable_O::hash_table_test() {
-  return cl::_sym_eq;
+  return this->hashTableTest();
+}
+
+Symbol_sp WeakKeyHashTable_O::weakness() const {
+  switch (this->_HashTable._Weakness) {
+  case gctools::WeakKey: return kw::_sym_key;
+  case gctools::WeakValue: return kw::_sym_value;
+  case gctools::WeakKeyAndValue: return kw::_sym_key_and_value;
+  default: return kw::_sym_key_or_value;
+  }
+}
+
+SYMBOL_EXPORT_SC_(KeywordPkg, value);
+SYMBOL_EXPORT_SC_(KeywordPkg, key_and_value);
+SYMBOL_EXPORT_SC_(KeywordPkg, key_or_value);
+
+WeakKeyHashTable_sp WeakKeyHashTable_O::make(size_t sz, Number_sp rehashSize, double rehashThreshold,
+                                             Symbol_sp weakness, T_sp test) {
+  gctools::WeakTableKind kind;
+  if (weakness == kw::_sym_key) kind = gctools::WeakKey;
+  else if (weakness == kw::_sym_value) kind = gctools::WeakValue;
+  else if (weakness == kw::_sym_key_and_value) kind = gctools::WeakKeyAndValue;
+  else if (weakness == kw::_sym_key_or_value) SIMPLE_ERROR(BF("Hash table weakness :key-or-value is not supported"));
+  else SIMPLE_ERROR(BF("Unknown hash table weakness %s - must be one of :key, :value or :key-and-value") % _rep_(weakness));
+  gctools::WeakTableTest wtest;
+  if (test == cl::_sym_eq || test == cl::_sym_eq->symbolFunction()) wtest = gctools::WeakTestEq;
+  else if (test == cl::_sym_eql || test == cl::_sym_eql->symbolFunction()) wtest = gctools::WeakTestEql;
+  else if (test == cl::_sym_equal || test == cl::_sym_equal->symbolFunction()) wtest = gctools::WeakTestEqual;
+  else if (test == cl::_sym_equalp || test == cl::_sym_equalp->symbolFunction()) wtest = gctools::WeakTestEqualp;
+  else SIMPLE_ERROR(BF("Weak hash tables only support the tests eq, eql, equal and equalp - not %s") % _rep_(test));
+  return gctools::GC<WeakKeyHashTable_O>::allocate(sz, rehashSize, rehashThreshold, kind, wtest);
 }
 
 
@@ -132,7 +171,7 @@ T_sp WeakKeyHashTable_O::clrhash() {
 
 string WeakKeyHashTable_O::__repr__() const {
   stringstream ss;
-  ss << "#<" << this->className() << " :size " << this->_HashTable.tableSize() << ">";
+  ss << "#<" << this->className() << " :weakness " << _rep_(this->weakness()) << " :test " << _rep_(this->hashTableTest()) << " :size " << this->_HashTable.tableSize() << ">";
   return ss.str();
 }
 
@@ -186,7 +225,10 @@ CL_DEFUN void core__weak_splat(WeakKeyHashTable_sp ht, Fixnum_sp idx) {
   T_sp splatted;     // This will be NULL
   splatted.reset_(); // This will force it to be NULL
   TESTING();         // Test the NULL value
-  (*ht->_HashTable._Keys).set(unbox_fixnum(idx), WeakKeyHashTable_O::value_type(splatted));
+  // Drop the disappearing link first and then write the NULL the collector would have written
+  size_t i = unbox_fixnum(idx);
+  (*ht->_HashTable._Keys).set(i, WeakKeyHashTable_O::value_type(gctools::make_tagged_deleted<core::T_O*>()));
+  (*ht->_HashTable._Keys)[i] = WeakKeyHashTable_O::value_type(splatted);
 };
 CL_LAMBDA(ht &optional sz);
 CL_DECLARE();
@@ -199,9 +241,8 @@ CL_DEFUN void core__weak_rehash(WeakKeyHashTable_sp ht, T_sp sz) {
     newLength = unbox_fixnum(gc::As<Fixnum_sp>(sz));
     //	    newLength = unbox_fixnum(As<Fixnum_O>(sz));
   }
-  WeakKeyHashTable_O::value_type dummyKey;
   size_t dummyPos;
-  ht->_HashTable.rehash(dummyKey, dummyPos);
+  ht->_HashTable.rehash(_Unbound<T_O>(), dummyPos);
 };
 };
 
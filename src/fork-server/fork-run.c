@@ -0,0 +1,102 @@
+/*
+ * fork-run - run a request in a clasp fork server (see src/lisp/kernel/lsp/fork-server.lsp)
+ *
+ *   fork-run <socket-path> [request words...]
+ *
+ * Passes this process's stdin/stdout/stderr to the server together with the
+ * request words joined by spaces, then waits for the worker to exit and
+ * exits with the worker's exit status.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_REQUEST 65536
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <socket-path> [request words...]\n", argv[0]);
+    return 2;
+  }
+  char request[MAX_REQUEST];
+  size_t len = 0;
+  request[0] = '\0';
+  for (int i = 2; i < argc; ++i) {
+    size_t wlen = strlen(argv[i]);
+    if (len + wlen + 2 > MAX_REQUEST) {
+      fprintf(stderr, "%s: request is longer than %d bytes\n", argv[0], MAX_REQUEST);
+      return 2;
+    }
+    if (i > 2) request[len++] = ' ';
+    memcpy(request + len, argv[i], wlen);
+    len += wlen;
+  }
+  if (len == 0) request[len++] = '\n';  /* a message with no payload would look like EOF */
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "%s: socket path is too long\n", argv[0]);
+    return 2;
+  }
+  strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("connect");
+    return 2;
+  }
+
+  int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(fds))];
+  } control;
+  struct iovec iov = { request, len };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  ssize_t sent;
+  while ((sent = sendmsg(fd, &msg, 0)) < 0 && errno == EINTR) {}
+  if (sent < 0) {
+    perror("sendmsg");
+    return 2;
+  }
+
+  char reply[64];
+  size_t got = 0;
+  while (got < sizeof(reply) - 1) {
+    ssize_t n = read(fd, reply + got, sizeof(reply) - 1 - got);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    got += n;
+  }
+  reply[got] = '\0';
+  if (got == 0) {
+    fprintf(stderr, "%s: the fork server closed the connection without a status\n", argv[0]);
+    return 2;
+  }
+  int status = atoi(reply);
+  if (WIFEXITED(status)) return WEXITSTATUS(status);
+  if (WIFSIGNALED(status)) {
+    signal(WTERMSIG(status), SIG_DFL);
+    kill(getpid(), WTERMSIG(status));
+  }
+  return 1;
+}
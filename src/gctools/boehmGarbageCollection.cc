@@ -35,6 +35,12 @@ THE SOFTWARE.
 #include <clasp/gctools/boehmGarbageCollection.h>
 #include <clasp/core/debugger.h>
 #include <clasp/core/compiler.h>
+#include <clasp/gctools/telemetry.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 
 
@@ -65,6 +71,81 @@ void clasp_warn_proc(char *msg, GC_word arg) {
 }
 
 
+/*! Called by Boehm with the allocation lock held - it must not allocate */
+#if (GC_VERSION_MAJOR > 7) || ((GC_VERSION_MAJOR == 7) && (GC_VERSION_MINOR >= 6))
+void boehm_collection_event(GC_EventType event) {
+  if (!telemetry::event_enabled(telemetry::event_gc)) return;
+  if (event == GC_EVENT_START) telemetry::record_event(telemetry::event_gc,telemetry::phase_begin,GC_get_gc_no(),false);
+  else if (event == GC_EVENT_END) telemetry::record_event(telemetry::event_gc,telemetry::phase_end,GC_get_heap_size(),false);
+}
+#else
+void boehm_collection_start() {
+  if (!telemetry::event_enabled(telemetry::event_gc)) return;
+  telemetry::record_event(telemetry::event_gc,telemetry::phase_instant,GC_get_gc_no(),false);
+}
+#endif
+
+/*! The UNCOLLECTABLE data that Boehm passes to our finalizers.
+    Once the finalizer thread is running, objects whose Lisp finalizers are ready
+    are pushed onto global_finalizer_queue (a lock-free stack) through _Next and
+    _Object keeps them alive until the finalizer thread runs them in a batch.
+    _Finalizers must be the first field - it is read through a Tagged*.
+*/
+struct FinalizerNode {
+  gctools::Tagged  _Finalizers;
+  gctools::Tagged  _Object;
+  FinalizerNode*   _Next;
+  uint64_t         _QueuedNanoseconds;
+};
+
+std::atomic<FinalizerNode*> global_finalizer_queue(NULL);
+std::atomic<bool>           global_finalizer_thread_running(false);
+std::atomic<size_t>         global_finalizer_queue_depth(0);
+std::atomic<size_t>         global_finalizers_run(0);
+std::atomic<size_t>         global_finalizer_batches(0);
+std::atomic<uint64_t>       global_finalizer_total_latency(0);
+std::atomic<uint64_t>       global_finalizer_max_latency(0);
+sem_t                       global_finalizer_semaphore;
+// garbage-collect waits on these for the finalizer thread to finish a pass
+std::mutex                  global_finalizer_pass_mutex;
+std::condition_variable     global_finalizer_pass_condition;
+size_t                      global_finalizer_requests = 0;
+size_t                      global_finalizer_passes = 0;
+thread_local bool           my_thread_is_finalizer = false;
+extern std::atomic<bool>    global_finalizer_thread_started; // gcFunctions.cc
+
+static uint64_t finalizer_clock() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static FinalizerNode* allocate_finalizer_node() {
+  FinalizerNode* node = reinterpret_cast<FinalizerNode*>(ALIGNED_GC_MALLOC_UNCOLLECTABLE(sizeof(FinalizerNode)));
+  node->_Finalizers = 0;
+  node->_Object = 0;
+  node->_Next = NULL;
+  node->_QueuedNanoseconds = 0;
+  return node;
+}
+
+static void push_finalizer_node(FinalizerNode* node) {
+  FinalizerNode* head = global_finalizer_queue.load(std::memory_order_relaxed);
+  do {
+    node->_Next = head;
+  } while (!global_finalizer_queue.compare_exchange_weak(head,node,std::memory_order_release,std::memory_order_relaxed));
+}
+
+/*! Called by Boehm from GC_invoke_finalizers.
+    Return true if the finalizers of obj were queued for the finalizer thread,
+    false if they must be run right now. */
+static bool queue_finalizers(core::T_sp obj, void* data) {
+  if (!global_finalizer_thread_running.load(std::memory_order_acquire)) return false;
+  FinalizerNode* node = reinterpret_cast<FinalizerNode*>(data);
+  node->_Object = obj.tagged_();
+  node->_QueuedNanoseconds = finalizer_clock();
+  ++global_finalizer_queue_depth;
+  push_finalizer_node(node);
+  return true;
+}
 
 void run_finalizers(core::T_sp obj, void* data)
 {
@@ -88,13 +169,29 @@ void run_finalizers(core::T_sp obj, void* data)
       abort();
     }
 //    printf("%s:%d     calling finalizer %p with obj %p\n", __FILE__, __LINE__, func.raw_(), obj.raw_());
-    core::eval::funcall(func,obj);
+    // A finalizer that does a non-local exit out of itself must not keep the other
+    // finalizers, the rest of the batch or the finalizer thread from running.
+    // Anything else (process exit or abort, thread cancellation) is passed on.
+    bool unwound = false;
+    try {
+      core::eval::funcall(func,obj);
+    } catch (core::Unwind& e) {
+      unwound = true;
+    } catch (core::CatchThrow& e) {
+      unwound = true;
+    } catch (core::ReturnFrom& e) {
+      unwound = true;
+    } catch (core::DynamicGo& e) {
+      unwound = true;
+    }
+    if (unwound) SIMPLE_WARN(BF("The finalizer %s did a non-local exit - the remaining finalizers are run anyway") % _rep_(func));
   }
   // Now release the memory pointed to by data
   GC_FREE(data);
 }
 
-void boehm_general_finalizer_from_BoehmFinalizer(void* client, void* data)
+/*! Returns true if the Lisp finalizers were queued - the caller must not destroy the object yet */
+bool boehm_general_finalizer_from_BoehmFinalizer(void* client, void* data)
 {
 //  printf("%s:%d general_finalizer for %p\n", __FILE__, __LINE__, (void*)base);
   if ((uintptr_t)client&gctools::ptag_mask) {
@@ -103,8 +200,10 @@ void boehm_general_finalizer_from_BoehmFinalizer(void* client, void* data)
   }
   core::T_sp obj((gctools::Tagged)tag_general((core::T_O*)client));
   if (data!=NULL) {
+    if (queue_finalizers(obj,data)) return true;
     run_finalizers(obj,data);
   }
+  return false;
 }
 
 void boehm_general_finalizer(void* base, void* data)
@@ -117,7 +216,7 @@ void boehm_general_finalizer(void* base, void* data)
   }
   core::T_sp obj((gctools::Tagged)tag_general((core::T_O*)client));
   if (data!=NULL) {
-    run_finalizers(obj,data);
+    if (!queue_finalizers(obj,data)) run_finalizers(obj,data);
   } else {
 //    printf("%s:%d:%s  data was NULL and so could not run finalizers\n", __FILE__, __LINE__, __FUNCTION__ );
   }
@@ -130,12 +229,146 @@ void boehm_cons_finalizer(void* base, void* data)
     void* client = base; // no header on Cons_O
     core::Cons_sp obj((core::Cons_O*)client);
 //    printf("%s:%d boehm_cons_finalizer for tagged Cons -> %p  client -> %p\n", __FILE__, __LINE__, (void*)obj.tagged_(), client );
-    run_finalizers(obj,data);
+    if (!queue_finalizers(obj,data)) run_finalizers(obj,data);
   } else {
 //    printf("%s:%d:%s  data was NULL and so could not run finalizers\n", __FILE__, __LINE__, __FUNCTION__ );
   }
 }
 
+/*! Let Boehm queue up whatever is ready to be finalized and then run the
+    Lisp finalizers in the queue as one batch, oldest first.
+    Returns the number of objects whose finalizers were run. */
+size_t boehm_run_pending_finalizers()
+{
+  GC_invoke_finalizers();
+  FinalizerNode* batch = global_finalizer_queue.exchange(NULL,std::memory_order_acquire);
+  if (batch == NULL) return 0;
+  FinalizerNode* fifo = NULL;
+  while (batch) {
+    FinalizerNode* next = batch->_Next;
+    batch->_Next = fifo;
+    fifo = batch;
+    batch = next;
+  }
+  ++global_finalizer_batches;
+  size_t count = 0;
+  while (fifo) {
+    FinalizerNode* node = fifo;
+    fifo = node->_Next;
+    core::T_sp obj((gctools::Tagged)node->_Object);
+    uint64_t latency = finalizer_clock() - node->_QueuedNanoseconds;
+    global_finalizer_total_latency += latency;
+    uint64_t max_latency = global_finalizer_max_latency.load(std::memory_order_relaxed);
+    while (latency > max_latency && !global_finalizer_max_latency.compare_exchange_weak(max_latency,latency)) {};
+    --global_finalizer_queue_depth;
+    ++global_finalizers_run;
+    ++count;
+    try {
+      run_finalizers(obj,(void*)node);
+    } catch (...) {
+      // The finalizer thread is going away - drop this object, put back what is
+      // left of the batch for whoever runs finalizers next, and let the unwind continue
+      GC_FREE(node);
+      while (fifo) {
+        FinalizerNode* next = fifo->_Next;
+        push_finalizer_node(fifo);
+        fifo = next;
+      }
+      throw;
+    }
+  }
+  return count;
+}
+
+/*! Called by Boehm (without the allocation lock) when there are objects ready
+    to be finalized - it runs on whatever thread allocated, so just wake the finalizer thread. */
+void boehm_finalizer_notifier()
+{
+  sem_post(&global_finalizer_semaphore);
+}
+
+static void finish_finalizer_pass(size_t request) {
+  {
+    std::lock_guard<std::mutex> guard(global_finalizer_pass_mutex);
+    if (request > global_finalizer_passes) global_finalizer_passes = request;
+  }
+  global_finalizer_pass_condition.notify_all();
+}
+
+/*! If the finalizer thread unwinds, hand finalization back to Boehm and release any waiters.
+    Clearing global_finalizer_thread_started lets the next FINALIZE start a new thread. */
+struct FinalizerThreadExit {
+  ~FinalizerThreadExit() {
+    global_finalizer_thread_running = false;
+    global_finalizer_thread_started = false;
+    GC_set_finalize_on_demand(0);
+    size_t request;
+    {
+      std::lock_guard<std::mutex> guard(global_finalizer_pass_mutex);
+      request = global_finalizer_requests;
+    }
+    finish_finalizer_pass(request);
+  }
+};
+
+void boehm_finalizer_thread_loop()
+{
+  my_thread_is_finalizer = true;
+  FinalizerThreadExit thread_exit;
+  global_finalizer_thread_running = true;
+  GC_set_finalizer_notifier(boehm_finalizer_notifier);
+  GC_set_finalize_on_demand(1);
+  sem_post(&global_finalizer_semaphore); // pick up anything that became ready before we took over
+  while (true) {
+    while (sem_wait(&global_finalizer_semaphore) != 0 && errno == EINTR) {};
+    size_t request;
+    {
+      std::lock_guard<std::mutex> guard(global_finalizer_pass_mutex);
+      request = global_finalizer_requests;
+    }
+    boehm_run_pending_finalizers();
+    finish_finalizer_pass(request);
+  }
+}
+
+/*! The child of a fork has no finalizer thread - finalizers run on demand again
+    until FINALIZE starts a new one, and nobody waits on the old thread's passes. */
+void boehm_finalizer_atfork_child()
+{
+  global_finalizer_thread_running = false;
+  global_finalizer_thread_started = false;
+  my_thread_is_finalizer = false;
+  GC_set_finalize_on_demand(0);
+  sem_init(&global_finalizer_semaphore,0,0);
+  global_finalizer_requests = 0;
+  global_finalizer_passes = 0;
+}
+
+/*! Make sure everything that the last collection found has been finalized.
+    The finalizer thread does the work if it is running, otherwise the caller does. */
+void boehm_wait_for_finalizers()
+{
+  if (!global_finalizer_thread_running.load() || my_thread_is_finalizer) {
+    boehm_run_pending_finalizers();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(global_finalizer_pass_mutex);
+  size_t request = ++global_finalizer_requests;
+  sem_post(&global_finalizer_semaphore);
+  global_finalizer_pass_condition.wait(lock, [request]() { return global_finalizer_passes >= request; });
+}
+
+FinalizerStatistics boehm_finalizer_statistics()
+{
+  FinalizerStatistics stats;
+  stats._QueueDepth = global_finalizer_queue_depth.load();
+  stats._Finalized = global_finalizers_run.load();
+  stats._Batches = global_finalizer_batches.load();
+  stats._TotalLatencyNanoseconds = global_finalizer_total_latency.load();
+  stats._MaxLatencyNanoseconds = global_finalizer_max_latency.load();
+  return stats;
+}
+
 
 /*! Register a list of finalizers to run when object is finalized.
     This function can be called multiple times - it replaces any previous
@@ -163,8 +396,7 @@ void boehm_set_finalizer_list(gctools::Tagged object_tagged, gctools::Tagged fin
     GC_register_finalizer_no_order(base,(GC_finalization_proc)0, 0,&orig_finalizer,&data);
 //    printf("%s:%d base = %p orig_finalizer=%p  data=%p\n", __FILE__, __LINE__, base, (void*)orig_finalizer, (void*)data);
     if (data==NULL) {
-      gctools::Tagged* new_data = reinterpret_cast<gctools::Tagged*>(ALIGNED_GC_MALLOC_UNCOLLECTABLE(sizeof(core::Cons_O*)));
-      data = (void*)new_data;
+      data = (void*)allocate_finalizer_node();
 //      printf("%s:%d allocated uncollectable data=%p\n", __FILE__, __LINE__, (void*)data);
     }
     // Write the finalizers list into the UNCOLLECTABLE space
@@ -188,8 +420,7 @@ void boehm_set_finalizer_list(gctools::Tagged object_tagged, gctools::Tagged fin
     GC_register_finalizer_no_order(base,(GC_finalization_proc)0, 0,&orig_finalizer,&data);
 //    printf("%s:%d object -> %p base = %p orig_finalizer=%p  data=%p\n", __FILE__, __LINE__, object.raw_(), base, (void*)orig_finalizer, (void*)data);
     if (data==NULL) {
-      gctools::Tagged* new_data = reinterpret_cast<gctools::Tagged*>(ALIGNED_GC_MALLOC_UNCOLLECTABLE(sizeof(core::Cons_O*)));
-      data = (void*)new_data;
+      data = (void*)allocate_finalizer_node();
 //      printf("%s:%d allocated uncollectable data=%p\n", __FILE__, __LINE__, (void*)data);
     }
     // Write the finalizers list into the UNCOLLECTABLE space
@@ -292,6 +523,13 @@ int initializeBoehm(MainFunctionType startupFn, int argc, char *argv[], bool mpi
   GC_set_all_interior_pointers(1); // tagged pointers require this
                                    //printf("%s:%d Turning on interior pointers\n",__FILE__,__LINE__);
   GC_set_warn_proc(clasp_warn_proc);
+  sem_init(&global_finalizer_semaphore,0,0);
+  pthread_atfork(NULL,NULL,boehm_finalizer_atfork_child);
+#if (GC_VERSION_MAJOR > 7) || ((GC_VERSION_MAJOR == 7) && (GC_VERSION_MINOR >= 6))
+  GC_set_on_collection_event(boehm_collection_event);
+#else
+  GC_set_start_callback(boehm_collection_start);
+#endif
   //  GC_enable_incremental();
   GC_init();
   void* topOfStack;
@@ -20,6 +20,8 @@ int gcFunctions_after;
 #include <unistd.h>
 #include <sstream>
 #include <iomanip>
+#include <unordered_map>
+#include <cmath>
 
 #include <clasp/core/object.h>
 #include <clasp/core/bformat.h>
@@ -41,6 +43,7 @@ int gcFunctions_after;
 #include <clasp/llvmo/debugInfoExpose.h>
 #include <clasp/gctools/gc_interface.h>
 #include <clasp/gctools/threadlocal.h>
+#include <clasp/core/mpPackage.h>
 #include <clasp/core/wrappers.h>
 
 
@@ -770,6 +773,307 @@ CL_DEFUN core::T_mv cl__room(core::T_sp x) {
 };
 };
 
+namespace gctools {
+
+/*! Return a vector of stamp names indexed by unshifted stamp */
+std::vector<std::string> stamp_names_by_stamp() {
+  std::vector<std::string> stampNames;
+  stampNames.resize(gctools::global_NextUnshiftedStamp.load());
+  for ( auto it : global_unshifted_nowhere_stamp_name_map ) {
+    if (it.second>=stampNames.size()) stampNames.resize(it.second+1);
+    stampNames[it.second] = it.first;
+  }
+  return stampNames;
+}
+
+std::string stamp_name_or_unknown(const std::vector<std::string>& stampNames, size_t stamp) {
+  if (stamp<stampNames.size() && stampNames[stamp]!="") return stampNames[stamp];
+  stringstream ss;
+  ss << "UNKNOWN/" << stamp;
+  return ss.str();
+}
+
+struct HeapCensusEntry {
+  size_t _Instances;
+  size_t _Bytes;
+  HeapCensusEntry() : _Instances(0), _Bytes(0) {};
+};
+
+#ifdef USE_BOEHM
+extern "C" {
+void boehm_callback_heap_census(void* ptr, size_t sz, void* client_data) {
+  std::vector<HeapCensusEntry>* census = reinterpret_cast<std::vector<HeapCensusEntry>*>(client_data);
+  gctools::Header_s* h = reinterpret_cast<gctools::Header_s*>(ptr);
+  size_t stamp = (size_t)h->stamp_();
+  if (!valid_stamp((gctools::stamp_t)stamp)) {
+    // Conses have no header - use the same heuristic as boehm_callback_reachable_object
+    stamp = (sz==32) ? (size_t)(gctools::STAMP_core__Cons_O>>gctools::Header_s::wtag_width) : 0;
+  }
+  // The census vector is sized before the walk - we can't allocate while Boehm holds its lock
+  if (stamp>=census->size()) stamp = 0;
+  HeapCensusEntry& entry = (*census)[stamp];
+  ++entry._Instances;
+  entry._Bytes += sz;
+}
+
+void* boehm_heap_census_with_alloc_lock(void* client_data) {
+#if BOEHM_GC_ENUMERATE_REACHABLE_OBJECTS_INNER_AVAILABLE==1
+  GC_enumerate_reachable_objects_inner(boehm_callback_heap_census, client_data);
+#endif
+  return NULL;
+}
+};
+#endif
+
+CL_LAMBDA(&optional (collect t));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Walk the heap and return a list of (stamp-name instances bytes) for every stamp
+that has live objects, sorted by decreasing bytes.  If COLLECT is true a full collection is done
+first so that only reachable objects are counted. Works with both Boehm and MPS.)doc");
+CL_DEFUN core::T_sp gctools__heap_census(bool collect) {
+  std::vector<HeapCensusEntry> census;
+  census.resize(gctools::global_NextUnshiftedStamp.load()+1);
+#ifdef USE_BOEHM
+#if BOEHM_GC_ENUMERATE_REACHABLE_OBJECTS_INNER_AVAILABLE==1
+  if (collect) GC_gcollect();
+  GC_call_with_alloc_lock(boehm_heap_census_with_alloc_lock,(void*)&census);
+#else
+  SIMPLE_ERROR(BF("The boehm function GC_enumerate_reachable_objects_inner is not available"));
+#endif
+#endif
+#ifdef USE_MPS
+  if (collect) mps_arena_collect(global_arena);
+  mps_arena_park(global_arena);
+  vector<ReachableMPSObject> reachables;
+  for (int i = 0; i < census.size(); ++i) {
+    reachables.push_back(ReachableMPSObject(i));
+  }
+  mps_amc_apply(global_amc_pool, amc_apply_stepper, &reachables, 0);
+  mps_amc_apply(global_amcz_pool, amc_apply_stepper, &reachables, 0);
+  mps_arena_release(global_arena);
+  for (auto it : reachables) {
+    census[it.stamp]._Instances = it.instances;
+    census[it.stamp]._Bytes = it.totalMemory;
+  }
+#endif
+  std::vector<size_t> order;
+  for ( size_t stamp=0; stamp<census.size(); ++stamp ) {
+    if (census[stamp]._Instances>0) order.push_back(stamp);
+  }
+  sort(order.begin(),order.end(),[&census](size_t x, size_t y) {
+                                   return census[x]._Bytes < census[y]._Bytes;
+                                 });
+  std::vector<std::string> stampNames = stamp_names_by_stamp();
+  // Cons up the list in order of increasing bytes so it comes out sorted by decreasing bytes
+  core::List_sp result = _Nil<core::T_O>();
+  for ( auto stamp : order ) {
+    core::T_sp one = core::Cons_O::createList(core::SimpleBaseString_O::make(stamp_name_or_unknown(stampNames,stamp)),
+                                              core::make_fixnum(census[stamp]._Instances),
+                                              core::make_fixnum(census[stamp]._Bytes));
+    result = core::Cons_O::create(one,result);
+  }
+  return result;
+}
+
+};
+
+
+/* ------------------------------------------------------------
+ *
+ * Sampling allocation profiler
+ *
+ * Every thread counts down _AllocationSampleCountdown in registerAllocation.
+ * When it goes negative HitAllocationSampleThreshold records the stamp and
+ * a backtrace of the allocation and picks the next countdown from an
+ * exponential distribution with mean global_AllocationSampleInterval.
+ * This is the same sampling scheme that tcmalloc uses and the profile can
+ * be written in the legacy gperftools heap profile format that pprof reads.
+ */
+
+namespace gctools {
+
+#define ALLOCATION_SAMPLE_MAX_DEPTH 128
+
+struct AllocationSampleKey {
+  stamp_t            _Stamp;
+  std::vector<void*> _Frames;
+  bool operator==(const AllocationSampleKey& other) const {
+    return this->_Stamp == other._Stamp && this->_Frames == other._Frames;
+  }
+};
+
+struct AllocationSampleKeyHash {
+  size_t operator()(const AllocationSampleKey& key) const {
+    size_t hash = std::hash<size_t>()((size_t)key._Stamp);
+    for ( auto frame : key._Frames ) {
+      hash = hash*31 + std::hash<void*>()(frame);
+    }
+    return hash;
+  }
+};
+
+struct AllocationSampleCounts {
+  size_t _Count;
+  size_t _Bytes;
+  AllocationSampleCounts() : _Count(0), _Bytes(0) {};
+};
+
+typedef std::unordered_map<AllocationSampleKey,AllocationSampleCounts,AllocationSampleKeyHash> AllocationSampleMap;
+
+/*! Mean number of bytes between samples - zero means the profiler is off */
+std::atomic<size_t> global_AllocationSampleInterval(0);
+/*! The interval that the samples in global_AllocationSamples were collected with */
+std::atomic<size_t> global_AllocationSamplesInterval(0);
+std::atomic<size_t> global_AllocationSampleDepth(32);
+mp::Mutex           global_AllocationSamplesMutex(ALLOCSMP_NAMEWORD);
+AllocationSampleMap global_AllocationSamples;
+THREAD_LOCAL bool     my_thread_in_allocation_sample = false;
+THREAD_LOCAL uint64_t my_thread_allocation_sample_random = 0;
+
+/*! Return the number of bytes to allocate before taking the next sample.
+    Drawn from an exponential distribution so that every byte is equally
+    likely to be sampled regardless of the allocation pattern. */
+int64_t next_allocation_sample_countdown(size_t interval) {
+  uint64_t x = my_thread_allocation_sample_random;
+  if (x==0) x = (uint64_t)(uintptr_t)&x ^ (uint64_t)time(NULL) ^ 0x9E3779B97F4A7C15ULL;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  my_thread_allocation_sample_random = x;
+  // 53 random bits in (0,1]
+  double q = ((double)(x>>11)+1.0)/9007199254740992.0;
+  double next = -log(q)*(double)interval;
+  if (next<1.0) return 1;
+  if (next>(double)(INT64_MAX/2)) return INT64_MAX/2;
+  return (int64_t)next;
+}
+
+__attribute__((noinline)) void HitAllocationSampleThreshold(stamp_t stamp, size_t size) {
+  GlobalAllocationProfiler& profiler = my_thread_low_level->_Allocations;
+  size_t interval = global_AllocationSampleInterval.load(std::memory_order_relaxed);
+  if (interval==0 || my_thread_in_allocation_sample) {
+    profiler._AllocationSampleCountdown = (interval==0) ? ALLOCATION_SAMPLE_IDLE_BYTES : next_allocation_sample_countdown(interval);
+    return;
+  }
+  my_thread_in_allocation_sample = true;
+  size_t depth = global_AllocationSampleDepth.load(std::memory_order_relaxed);
+  void* frames[ALLOCATION_SAMPLE_MAX_DEPTH+2];
+  int nframes = backtrace(frames,depth+2);
+  AllocationSampleKey key;
+  key._Stamp = stamp;
+  // Skip this function and registerAllocation
+  for ( int i=2; i<nframes; ++i ) key._Frames.push_back(frames[i]);
+  {
+    WITH_READ_WRITE_LOCK(global_AllocationSamplesMutex);
+    AllocationSampleCounts& counts = global_AllocationSamples[key];
+    ++counts._Count;
+    counts._Bytes += size;
+  }
+  profiler._AllocationSampleCountdown = next_allocation_sample_countdown(interval);
+  my_thread_in_allocation_sample = false;
+}
+
+/*! Copy the samples out of the table so that we don't hold the lock
+    while allocating Lisp objects - that would sample and deadlock. */
+std::vector<std::pair<AllocationSampleKey,AllocationSampleCounts>> copy_allocation_samples() {
+  std::vector<std::pair<AllocationSampleKey,AllocationSampleCounts>> samples;
+  WITH_READ_WRITE_LOCK(global_AllocationSamplesMutex);
+  for ( auto it : global_AllocationSamples ) samples.push_back(it);
+  return samples;
+}
+
+CL_LAMBDA(&optional (interval 524288) (depth 32));
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Start the sampling allocation profiler. On average one sample is taken every
+INTERVAL bytes allocated and records the stamp of the object and DEPTH frames of backtrace.
+Previously collected samples are discarded.)doc");
+CL_DEFUN void gctools__start_allocation_sampling(size_t interval, size_t depth) {
+  if (interval==0) {
+    SIMPLE_ERROR(BF("The sampling interval must be > 0"));
+  }
+  if (depth>ALLOCATION_SAMPLE_MAX_DEPTH) depth = ALLOCATION_SAMPLE_MAX_DEPTH;
+  {
+    WITH_READ_WRITE_LOCK(global_AllocationSamplesMutex);
+    global_AllocationSamples.clear();
+  }
+  global_AllocationSamplesInterval = interval;
+  global_AllocationSampleDepth = depth;
+  global_AllocationSampleInterval = interval;
+  // Other threads pick up the new interval within ALLOCATION_SAMPLE_IDLE_BYTES
+  my_thread_low_level->_Allocations._AllocationSampleCountdown = next_allocation_sample_countdown(interval);
+}
+
+CL_DOCSTRING(R"doc(Stop the sampling allocation profiler. The samples are kept until the next start.)doc");
+CL_DEFUN void gctools__stop_allocation_sampling() {
+  global_AllocationSampleInterval = 0;
+}
+
+CL_DOCSTRING(R"doc(Return a list of (stamp-name samples bytes) from the sampling allocation profiler
+sorted by decreasing sampled bytes, and the interval they were sampled with as a second value.)doc");
+CL_DEFUN core::T_mv gctools__allocation_samples() {
+  auto samples = copy_allocation_samples();
+  std::map<stamp_t,AllocationSampleCounts> byStamp;
+  for ( auto it : samples ) {
+    AllocationSampleCounts& counts = byStamp[it.first._Stamp];
+    counts._Count += it.second._Count;
+    counts._Bytes += it.second._Bytes;
+  }
+  std::vector<std::pair<stamp_t,AllocationSampleCounts>> order(byStamp.begin(),byStamp.end());
+  sort(order.begin(),order.end(),[](const std::pair<stamp_t,AllocationSampleCounts>& x,
+                                    const std::pair<stamp_t,AllocationSampleCounts>& y) {
+                                   return x.second._Bytes < y.second._Bytes;
+                                 });
+  std::vector<std::string> stampNames = stamp_names_by_stamp();
+  core::List_sp result = _Nil<core::T_O>();
+  for ( auto it : order ) {
+    core::T_sp one = core::Cons_O::createList(core::SimpleBaseString_O::make(stamp_name_or_unknown(stampNames,it.first)),
+                                              core::make_fixnum(it.second._Count),
+                                              core::make_fixnum(it.second._Bytes));
+    result = core::Cons_O::create(one,result);
+  }
+  return Values(result,core::make_fixnum(global_AllocationSamplesInterval.load()));
+}
+
+CL_LAMBDA(filename);
+CL_DECLARE();
+CL_DOCSTRING(R"doc(Write the samples from the sampling allocation profiler to FILENAME in the
+legacy gperftools heap profile format that pprof reads.  The profile records the interval
+the samples were collected with, pprof uses it to scale the samples back to real allocations.)doc");
+CL_DEFUN void gctools__write_allocation_profile(const std::string& filename) {
+  size_t interval = global_AllocationSamplesInterval.load();
+  auto samples = copy_allocation_samples();
+  FILE* fout = fopen(filename.c_str(),"w");
+  if (!fout) {
+    SIMPLE_ERROR(BF("Could not open file %s - %s") % filename % strerror(errno));
+  }
+  size_t totalCount = 0;
+  size_t totalBytes = 0;
+  for ( auto it : samples ) {
+    totalCount += it.second._Count;
+    totalBytes += it.second._Bytes;
+  }
+  fprintf(fout,"heap profile: %6lu: %8lu [%6lu: %8lu] @ heap_v2/%lu\n",
+          totalCount, totalBytes, totalCount, totalBytes, interval);
+  for ( auto it : samples ) {
+    fprintf(fout,"%6lu: %8lu [%6lu: %8lu] @",
+            it.second._Count, it.second._Bytes, it.second._Count, it.second._Bytes);
+    for ( auto frame : it.first._Frames ) fprintf(fout," %p",frame);
+    fprintf(fout,"\n");
+  }
+  // pprof needs the memory map to symbolize the addresses
+  fprintf(fout,"\nMAPPED_LIBRARIES:\n");
+  FILE* maps = fopen("/proc/self/maps","r");
+  if (maps) {
+    char buffer[4096];
+    size_t nread;
+    while ((nread = fread(buffer,1,sizeof(buffer),maps))>0) fwrite(buffer,1,nread,fout);
+    fclose(maps);
+  }
+  fclose(fout);
+}
+
+};
+
 namespace gctools {
 #ifdef USE_MPS
 CL_DEFUN void gctools__save_lisp_and_die(const std::string& filename)
@@ -862,8 +1166,60 @@ CL_DEFUN void gctools__function_call_count_profiler(core::T_sp func) {
 #endif // DEBUG_FUNCTION_CALL_COUNTER
 
 namespace gctools {
+SYMBOL_SC_(GcToolsPkg, finalizer_thread);
+
+std::atomic<bool> global_finalizer_thread_started(false);
+
+CL_DOCSTRING("The body of the finalizer thread - it waits for objects to be ready for finalization and runs their finalizers in batches.");
+CL_DEFUN void gctools__finalizer_thread() {
+#ifdef USE_BOEHM
+  boehm_finalizer_thread_loop();
+#endif
+}
+
+CL_DOCSTRING("Start the thread that runs finalizers, if it isn't running already. Until it is started finalizers run on whatever thread triggers them. This is done by the first call to FINALIZE.");
+CL_DEFUN void gctools__start_finalizer_thread() {
+#ifdef USE_BOEHM
+  if (global_finalizer_thread_started.exchange(true)) return;
+  mp::Process_sp process = mp::Process_O::make_process(core::SimpleBaseString_O::make("finalizer"),
+                                                       _sym_finalizer_thread->symbolFunction(),
+                                                       _Nil<core::T_O>(),
+                                                       _Nil<core::T_O>(),
+                                                       DEFAULT_THREAD_STACK_SIZE);
+  _lisp->add_process(process);
+  process->start();
+#endif
+}
+
+CL_DOCSTRING("Run the finalizers of every object that is ready to be finalized in the calling thread. Return the number of objects finalized.");
+CL_DEFUN size_t gctools__run_pending_finalizers() {
+#ifdef USE_BOEHM
+  return boehm_run_pending_finalizers();
+#endif
+#ifdef USE_MPS
+  size_t finalizations;
+  processMpsMessages(finalizations);
+  return finalizations;
+#endif
+}
+
+CL_DOCSTRING("Return the number of objects waiting in the finalization queue, the number of objects finalized from it, the number of batches they were run in and the total and maximum nanoseconds that objects waited in the queue.");
+CL_DEFUN core::T_mv gctools__finalizer_statistics() {
+#ifdef USE_BOEHM
+  FinalizerStatistics stats = boehm_finalizer_statistics();
+  return Values(core::Integer_O::create(stats._QueueDepth),
+                core::Integer_O::create(stats._Finalized),
+                core::Integer_O::create(stats._Batches),
+                core::Integer_O::create(stats._TotalLatencyNanoseconds),
+                core::Integer_O::create(stats._MaxLatencyNanoseconds));
+#else
+  return Values(core::make_fixnum(0),core::make_fixnum(0),core::make_fixnum(0),core::make_fixnum(0),core::make_fixnum(0));
+#endif
+}
+
 /*! Call finalizer_callback with no arguments when object is finalized.*/
 CL_DEFUN void gctools__finalize(core::T_sp object, core::T_sp finalizer_callback) {
+  gctools__start_finalizer_thread();
   //printf("%s:%d making a finalizer for %p calling %p\n", __FILE__, __LINE__, (void*)object.tagged_(), (void*)finalizer_callback.tagged_());
   WITH_READ_WRITE_LOCK(_lisp->_Roots._FinalizersMutex);
   core::WeakKeyHashTable_sp ht = _lisp->_Roots._Finalizers;
@@ -963,8 +1319,8 @@ CL_DEFUN core::T_sp gctools__stack_depth() {
 CL_DEFUN void gctools__garbage_collect() {
 #ifdef USE_BOEHM
   GC_gcollect();
-//  write_bf_stream(BF("GC_invoke_finalizers\n"));
-  GC_invoke_finalizers();
+  // Finalizers run on the finalizer thread - wait for it to get through this collection
+  boehm_wait_for_finalizers();
 #endif
 //        printf("%s:%d Starting garbage collection of arena\n", __FILE__, __LINE__ );
 #ifdef USE_MPS
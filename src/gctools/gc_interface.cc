@@ -1188,6 +1188,7 @@ void dumpBoehmLayoutTables(FILE* fout) {
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _InternalSymbols);
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _ExternalSymbols);
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _Shadowing);
+  Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _InheritedSymbols);
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _Name);
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _Nicknames);
   Init__fixed_field(core::Package_O, 0, SMART_PTR_OFFSET, _LocalNicknames);
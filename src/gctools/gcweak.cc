@@ -36,6 +36,7 @@ THE SOFTWARE.
 #include <clasp/core/foundation.h>
 #include <clasp/gctools/gcweak.h>
 #include <clasp/core/object.h>
+#include <clasp/core/hashTable.h>
 #include <clasp/core/evaluator.h>
 #include <clasp/core/mpPackage.h>
 #ifdef USE_MPS
@@ -85,6 +86,15 @@ struct WeakKeyHashTableWriteLock {
 #define HT_UPGRADE_WRITE_LOCK(me)
 #endif
 
+static gctools::tagged_pointer<BucketsObjectType> allocate_buckets(bool weak, size_t length) {
+  if (weak) {
+    gctools::tagged_pointer<WeakBucketsObjectType> buckets = GCBucketAllocator<WeakBucketsObjectType>::allocate(length);
+    return gctools::tagged_pointer<BucketsObjectType>(&*buckets);
+  }
+  gctools::tagged_pointer<StrongBucketsObjectType> buckets = GCBucketAllocator<StrongBucketsObjectType>::allocate(length);
+  return gctools::tagged_pointer<BucketsObjectType>(&*buckets);
+}
+
 void WeakKeyHashTable::initialize() {
   int length = this->_Length;
   /* round up to next power of 2 */
@@ -93,8 +103,8 @@ void WeakKeyHashTable::initialize() {
   size_t l;
   for (l = 1; l < length; l *= 2)
     ;
-  this->_Keys = KeyBucketsAllocatorType::allocate(l);
-  this->_Values = ValueBucketsAllocatorType::allocate(l);
+  this->_Keys = allocate_buckets(this->weakKeysp(), l);
+  this->_Values = allocate_buckets(this->weakValuesp(), l);
   this->_Keys->dependent = this->_Values;
   //  GCTOOLS_ASSERT((reinterpret_cast<uintptr_t>(this->_Keys->dependent) & 0x3) == 0);
   this->_Values->dependent = this->_Keys;
@@ -108,61 +118,68 @@ void WeakKeyHashTable::setupThreadSafeHashTable() {
 #endif
 }
 
-uint WeakKeyHashTable::sxhashKey(const value_type &key) {
-  GCWEAK_LOG(BF("Calling lisp_hash for key: %p") % (void *)lisp_badge(key));
-  return core::lisp_hash(reinterpret_cast<uintptr_t>(lisp_badge(key)));
+// Addresses are hashed by their badge, which doesn't change when MPS moves the object.
+uint WeakKeyHashTable::sxhashKey(core::T_sp key) const {
+  if (this->_Test == WeakTestEq) {
+    GCWEAK_LOG(BF("Calling lisp_hash for key: %p") % (void *)lisp_badge(key));
+    return core::lisp_hash(reinterpret_cast<uintptr_t>(lisp_badge(key)));
+  }
+  core::HashGenerator hg;
+  switch (this->_Test) {
+  case WeakTestEql: core::HashTable_O::sxhash_eql(hg, key); break;
+  case WeakTestEqual: core::HashTable_O::sxhash_equal(hg, key); break;
+  default: core::HashTable_O::sxhash_equalp(hg, key); break;
+  }
+  return hg.rawhash();
 }
 
-/*! Return 0 if there is no more room in the sequence of entries for the key
-	  Return 1 if the element is found or an unbound or deleted entry is found.
-	  Return the entry index in (b)
-	*/
-size_t WeakKeyHashTable::find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, const value_type &key
-                        ,
-                        size_t &b
-#ifdef DEBUG_FIND
-                        ,
-                        bool debugFind, stringstream *reportP
-#endif
-                        ) {
+bool WeakKeyHashTable::keyTest(core::T_sp entryKey, core::T_sp searchKey) const {
+  switch (this->_Test) {
+  case WeakTestEq: return entryKey == searchKey;
+  case WeakTestEql: return core::cl__eql(entryKey, searchKey);
+  case WeakTestEqual: return core::cl__equal(entryKey, searchKey);
+  default: return core::cl__equalp(entryKey, searchKey);
+  }
+}
+
+bool WeakKeyHashTable::liveEntryp(const value_type& key, const value_type& value) {
+  if (!key.raw_() || key.unboundp() || key.deletedp()) return false;
+  // The value may have been collected out from under a weak value entry - a
+  // strong value bucket is never NULL because fixnum 0 is stored as no_key
+  if (!value.raw_()) return false;
+  return true;
+}
+
+void WeakKeyHashTable::deleteEntry(gctools::tagged_pointer<KeyBucketsType> keys, size_t idx) {
+  keys->set(idx, value_type(gctools::make_tagged_deleted<core::T_O*>()));
+  keys->dependent->set(idx, value_type(gctools::make_tagged_unbound<core::T_O*>()));
+  keys->setDeleted(keys->deleted()+1);
+}
+
+size_t WeakKeyHashTable::find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, core::T_sp key, size_t &b, bool cleanup) const {
   unsigned long i, h, probe;
   unsigned long l = keys->length() - 1;
   int result = 0;
-  h = WeakKeyHashTable::sxhashKey(key);
-
-#ifdef DEBUG_FIND
-  if (debugFind) {
-    *reportP << __FILE__ << ":" << __LINE__ << " starting find key = " << (void *)(key.raw_()) << " h = " << h << " l = " << l << std::endl;
-  }
-#endif
+  h = this->sxhashKey(key);
   probe = (h >> 8) | 1;
   h &= l;
   i = h;
   do {
-    value_type &k = (*keys)[i];
-#ifdef DEBUG_FIND
-    if (debugFind) {
-      *reportP << "  i = " << i << "   k = " << (void *)(k.raw_()) << std::endl;
-    }
-#endif
-    if (k.unboundp() || k == key) {
+    value_type k = (*keys)[i];
+    if (k.unboundp()) {
       b = i;
-#ifdef DEBUG_FIND
-      if (debugFind && k != key) {
-        *reportP << "find  returning 1 b= " << b << " k = " << k.raw_() << std::endl;
-      }
-#endif
       return 1;
     }
-#ifdef USE_BOEHM
-    // Handle splatting
-    if (!k.raw_()) {
-      auto deleted = value_type(gctools::make_tagged_deleted<core::T_O*>());
-      keys->set(i, deleted);
-      ValueBucketsType *values = dynamic_cast<ValueBucketsType *>(&*keys->dependent);
-      (*values)[i] = value_type(gctools::make_tagged_unbound<core::T_O*>());
+    if (!k.deletedp()) {
+      value_type v = (*keys->dependent)[i];
+      if (!liveEntryp(k, v)) {
+        // The weak side was collected - lazily turn it into a deleted entry
+        if (cleanup) deleteEntry(keys, i);
+      } else if (this->keyTest(weak_bucket_decode(k), key)) {
+        b = i;
+        return 1;
+      }
     }
-#endif
     if (result == 0 && (k.deletedp())) {
       b = i;
       result = 1;
@@ -171,64 +188,54 @@ size_t WeakKeyHashTable::find_no_lock(gctools::tagged_pointer<KeyBucketsType> ke
   } while (i != h);
   return result;
 }
-int WeakKeyHashTable::rehash_not_safe(const value_type &key, size_t &key_bucket) {
+
+int WeakKeyHashTable::rehash_not_safe(core::T_sp key, size_t &key_bucket) {
   HT_WRITE_LOCK(this);
   size_t newLength;
-  if (this->_RehashSize.fixnump()) {
-    newLength = this->_Keys->length() + this->_RehashSize.unsafe_fixnum();
+  size_t length = this->_Keys->length();
+  size_t live = this->_Keys->used() - this->_Keys->deleted();
+  if (live < (this->_RehashThreshold * length) / 2) {
+    // Mostly deleted and collected entries - rebuilding at the same size frees them up
+    newLength = length;
+  } else if (this->_RehashSize.fixnump()) {
+    newLength = length + this->_RehashSize.unsafe_fixnum();
   } else if (gc::IsA<core::Float_sp>(this->_RehashSize)) {
     double size = core::clasp_to_double(this->_RehashSize);
-    newLength = this->_Keys->length()*size;
+    newLength = length*size;
   } else {
     SIMPLE_ERROR(BF("Illegal rehash size %s") % _rep_(this->_RehashSize));
   }
   int result;
   GCWEAK_LOG(BF("entered rehash newLength = %d") % newLength );
-  size_t i, length;
-		// buckets_t new_keys, new_values;
   result = 0;
-  length = this->_Keys->length();
-  MyType newHashTable(newLength,this->_RehashSize,this->_RehashThreshold);
+  MyType newHashTable(newLength,this->_RehashSize,this->_RehashThreshold,this->_Weakness,this->_Test);
   newHashTable.initialize();
-		//new_keys = make_buckets(newLength, this->key_ap);
-		//new_values = make_buckets(newLength, this->value_ap);
-		//new_keys->dependent = new_values;
-		//new_values->dependent = new_keys;
-  for (i = 0; i < length; ++i) {
-    value_type& old_key = (*this->_Keys)[i];
-    if (!old_key.unboundp() && !old_key.deletedp() && old_key.raw_() ) {
+  for (size_t i = 0; i < length; ++i) {
+    // Load each bucket once - Boehm may clear a weak one between two reads
+    value_type k = (*this->_Keys)[i];
+    value_type v = (*this->_Values)[i];
+    if (liveEntryp(k, v)) {
+      core::T_sp old_key = weak_bucket_decode(k);
       size_t found;
       size_t b;
-      found = WeakKeyHashTable::find_no_lock(newHashTable._Keys, old_key, b);
+      found = newHashTable.find_no_lock(newHashTable._Keys, old_key, b, false);
       GCTOOLS_ASSERT(found);// assert(found);            /* new table shouldn't be full */
-      if ( !(*newHashTable._Keys)[b].unboundp() ) {
-        printf("%s:%d About to copy key: %12p   at index %zu    to newHashTable at index: %zu\n", __FILE__, __LINE__,
-               old_key.raw_(), i, b );
-        printf("Key = %s\n", core::lisp_rep(old_key).c_str());
-        printf("    original value@%p = %s\n", (*this->_Values)[i].raw_(), core::lisp_rep((*this->_Values)[i]).c_str());
-        printf("newHashTable value@%p = %s\n", (*newHashTable._Values)[b].raw_(), core::lisp_rep((*newHashTable._Values)[b]).c_str());
-        printf("--------- Original table\n");
-        printf("%s\n", this->dump("Original").c_str());
-        printf("--------- New table\n");
-        printf("%s\n", newHashTable.dump("Copy").c_str());
-      }
       GCTOOLS_ASSERT((*newHashTable._Keys)[b].unboundp()); /* shouldn't be in new table */
-      newHashTable._Keys->set(b,old_key);
-      (*newHashTable._Values)[b] = (*this->_Values)[i];
-      if (key && old_key == key ) {
+      newHashTable._Keys->set(b,k);
+      newHashTable._Values->set(b,v);
+      if (!key.unboundp() && this->keyTest(old_key, key)) {
         key_bucket = b;
         result = 1;
       }
-      (*newHashTable._Keys).setUsed((*newHashTable._Keys).used()+1); // TAG_COUNT(UNTAG_COUNT(new_keys->used) + 1);
+      (*newHashTable._Keys).setUsed((*newHashTable._Keys).used()+1);
     }
   }
   GCTOOLS_ASSERT( (*newHashTable._Keys).used() == (newHashTable.tableSize()) );
-		// assert(UNTAG_COUNT(new_keys->used) == table_size(tbl));
   this->swap(newHashTable);
   return result;
 }
 
-int WeakKeyHashTable::rehash( const value_type &key, size_t &key_bucket) {
+int WeakKeyHashTable::rehash( core::T_sp key, size_t &key_bucket) {
   int result;
   safeRun<void()>([&result, this, &key, &key_bucket]() -> void {
       result = this->rehash_not_safe(key,key_bucket);
@@ -244,78 +251,20 @@ int WeakKeyHashTable::trySet(core::T_sp tkey, core::T_sp value) {
   if (tkey == value) {
     value = gctools::make_tagged_sameAsKey<core::T_O>();
   }
-  value_type key(tkey);
-#ifdef DEBUG_TRYSET
-  stringstream report;
-  report << "About to trySet with the key " << tkey.raw_() << std::endl;
-  report << this->dump("trySet-incoming WeakKeyHashTable: ") << std::endl;
-  // Count the number of times the key is in the table
-  int alreadyThere = 0;
-  int firstOtherIndex = 0;
-  for (int i(0); i < (*this->_Keys).length(); ++i) {
-    if ((*this->_Keys)[i] == tkey) {
-      firstOtherIndex = i;
-      ++alreadyThere;
-    }
-  }
-#endif
-  size_t result = WeakKeyHashTable::find_no_lock(this->_Keys, key, b);
-  if ((!result || (*this->_Keys)[b] != key)) {
-    GCWEAK_LOG(BF("then case - Returned from find with result = %d     (*this->_Keys)[b=%d] = %p") % result % b % (*this->_Keys)[b].raw_());
-#ifdef DEBUG_TRYSET
-    if (alreadyThere) {
-      report << "Could not find the key @" << key.raw_() << std::endl;
-      if (!result) {
-        report << " because find return result = " << result << " - which means that the hash table was searched and the key was not found before the hash list was exhausted" << std::endl;
-      }
-      if ((*this->_Keys)[b] != key) {
-        report << " because find hit an empty (unbound or deleted) slot before it found the key" << std::endl;
-      }
-      report << " ...  about to check if mps_ld_isstale" << std::endl;
-    }
-#endif
-
-  } else {
-    GCWEAK_LOG(BF("else case - Returned from find with result = %d     (*this->_Keys)[b=%d] = %p") % result % b % (*this->_Keys)[b].raw_());
-    GCWEAK_LOG(BF("Calling mps_ld_add for key: %p") % (void *)key.raw_());
-  }
+  size_t result = this->find_no_lock(this->_Keys, tkey, b, true);
+  if (!result) return 0;
   if ((*this->_Keys)[b].unboundp()) {
     GCWEAK_LOG(BF("Writing key over unbound entry"));
-    this->_Keys->set(b, key);
+    this->_Keys->set(b, weak_bucket_encode(tkey));
     (*this->_Keys).setUsed((*this->_Keys).used() + 1);
-#ifdef DEBUG_GCWEAK
-    printf("%s:%d key was unboundp at %zu  used = %d\n", __FILE__, __LINE__, b, this->_Keys->used());
-#endif
   } else if ((*this->_Keys)[b].deletedp()) {
     GCWEAK_LOG(BF("Writing key over deleted entry"));
-    this->_Keys->set(b, key);
+    this->_Keys->set(b, weak_bucket_encode(tkey));
     GCTOOLS_ASSERT((*this->_Keys).deleted() > 0);
     (*this->_Keys).setDeleted((*this->_Keys).deleted() - 1);
-#ifdef DEBUG_GCWEAK
-    printf("%s:%d key was deletedp at %zu  deleted = %d\n", __FILE__, __LINE__, b, (*this->_Keys).deleted());
-#endif // DEBUG_GCWEAK
   }
   GCWEAK_LOG(BF("Setting value at b = %d") % b);
-  (*this->_Values).set(b, value_type(value));
-#ifdef DEBUG_TRYSET
-  // Count the number of times the key is in the table
-  int count = 0;
-  int otherIndex;
-  for (int i(0); i < (*this->_Keys).length(); ++i) {
-    if ((*this->_Keys)[i] == tkey) {
-      if (i != b) {
-        otherIndex = i;
-      }
-      ++count;
-    }
-  }
-  if (count > 1) {
-    printf("Found %d duplicate keys %p in hash table\n", count, tkey.raw_());
-    printf("Log of trySet action:\n%s\n", report.str().c_str());
-    printf("The new key is at %zu and another instance of the key is at %d\n", b, otherIndex);
-    printf("%s\n", this->dump("Final trySet table").c_str());
-  }
-#endif
+  this->_Values->set(b, weak_bucket_encode(value));
   GCWEAK_LOG(BF("Leaving trySet"));
   return 1;
 }
@@ -349,22 +298,22 @@ core::T_mv WeakKeyHashTable::gethash(core::T_sp tkey, core::T_sp defaultValue) {
   core::T_mv result_mv;
   safeRun<void()>([&result_mv, this, tkey, defaultValue]() -> void {
       HT_READ_LOCK(this);
-      value_type key(tkey);
       size_t pos;
-      size_t result = gctools::WeakKeyHashTable::find_no_lock(this->_Keys,key ,pos);
-      if (result) { // WeakKeyHashTable::find(this->_Keys,key,false,pos)) { //buckets_find(tbl, this->keys, key, NULL, &b)) {
-        value_type& k = (*this->_Keys)[pos];
-        GCWEAK_LOG(BF("gethash find successful pos = %d  k= %p k.unboundp()=%d k.base_ref().deletedp()=%d k.NULLp()=%d") % pos % k.raw_() % k.unboundp() % k.deletedp() % (bool)k );
-        if ( k.raw_() && !k.unboundp() && !k.deletedp() ) {
-          GCWEAK_LOG(BF("Returning success!"));
-          core::T_sp value = smart_ptr<core::T_O>((*this->_Values)[pos]);
-          if ( value.sameAsKeyP() ) {
-            value = smart_ptr<core::T_O>(k);
-          }
-          result_mv = Values(value,core::lisp_true());
-          return;
+      size_t result = this->find_no_lock(this->_Keys, tkey, pos, false);
+      if (!result) {
+        result_mv = Values(defaultValue,_Nil<core::T_O>());
+        return;
+      }
+      value_type k = (*this->_Keys)[pos];
+      value_type v = (*this->_Values)[pos];
+      if (liveEntryp(k, v)) {
+        GCWEAK_LOG(BF("Returning success!"));
+        core::T_sp value = weak_bucket_decode(v);
+        if ( value.sameAsKeyP() ) {
+          value = weak_bucket_decode(k);
         }
-        GCWEAK_LOG(BF("Falling through"));
+        result_mv = Values(value,core::lisp_true());
+        return;
       }
       result_mv = Values(defaultValue,_Nil<core::T_O>());
       return;
@@ -376,9 +325,8 @@ void WeakKeyHashTable::set(core::T_sp key, core::T_sp value) {
   safeRun<void()>([key, value, this]() -> void {
 		if (this->fullp_not_safe() || !this->trySet(key,value) ) {
 		    int res;
-		    value_type dummyKey;
 		    size_t dummyPos;
-		    this->rehash( dummyKey, dummyPos );
+		    this->rehash( _Unbound<core::T_O>(), dummyPos );
 		    res = this->trySet( key, value);
 		    GCTOOLS_ASSERT(res);
 		}
@@ -387,21 +335,22 @@ void WeakKeyHashTable::set(core::T_sp key, core::T_sp value) {
 
 #define HASH_TABLE_ITER(table_type,tablep, key, value) \
   gctools::tagged_pointer<table_type::KeyBucketsType> iter_Keys; \
-  gctools::tagged_pointer<table_type::ValueBucketsType> iter_Values; \
   core::T_sp key; \
   core::T_sp value; \
   {\
     HT_READ_LOCK(tablep);\
     iter_Keys = tablep->_Keys; \
-    iter_Values = tablep->_Values; \
   }\
   for (size_t it(0), itEnd(iter_Keys->length()); it < itEnd; ++it) {\
   { \
     HT_READ_LOCK(tablep);\
-    key = (*iter_Keys)[it]; \
-    value = (*iter_Values)[it]; \
+    table_type::value_type iter_key = (*iter_Keys)[it]; \
+    table_type::value_type iter_value = (*iter_Keys->dependent)[it]; \
+    if (!table_type::liveEntryp(iter_key, iter_value)) continue; \
+    key = weak_bucket_decode(iter_key); \
+    value = weak_bucket_decode(iter_value); \
+    if (value.sameAsKeyP()) value = key; \
   } \
-  if (key.raw_()&&!key.unboundp()&&!key.deletedp())
 
 #define HASH_TABLE_ITER_END }
 
@@ -430,26 +379,10 @@ bool WeakKeyHashTable::remhash(core::T_sp tkey) {
   safeRun<void()>([this, tkey, &bresult]() -> void {
       HT_WRITE_LOCK(this);
 		size_t b;
-		value_type key(tkey);
-		size_t result = gctools::WeakKeyHashTable::find_no_lock(this->_Keys, key, b);
-		if( ! result ||
-                    !((*this->_Keys)[b]).raw_() ||
-		    (*this->_Keys)[b].unboundp() ||
-		    (*this->_Keys)[b].deletedp() )
-		    {
-                      if(!this->rehash( key, b)) {
-                        bresult = false;
-                        return;
-                      }
-		    }
-		if( (*this->_Keys)[b].raw_() &&
-                    !(*this->_Keys)[b].unboundp() &&
-		    !(*this->_Keys)[b].deletedp() )
+		size_t result = this->find_no_lock(this->_Keys, tkey, b, true);
+		if( result && liveEntryp((*this->_Keys)[b], (*this->_Values)[b]) )
 		    {
-                      auto deleted = value_type(gctools::make_tagged_deleted<core::T_O*>());
-                      this->_Keys->set(b, deleted);
-                      (*this->_Keys).setDeleted((*this->_Keys).deleted()+1);
-                      (*this->_Values)[b] = value_type(gctools::make_tagged_unbound<core::T_O*>());
+                      deleteEntry(this->_Keys, b);
                       bresult = true;
                       return;
 		    }
@@ -463,8 +396,8 @@ void WeakKeyHashTable::clrhash() {
       HT_WRITE_LOCK(this);
 		size_t len = (*this->_Keys).length();
 		for ( size_t i(0); i<len; ++i ) {
-                  this->_Keys->set(i,value_type(gctools::make_tagged_deleted<core::T_O*>()));
-                  (*this->_Values)[i] = value_type(gctools::make_tagged_unbound<core::T_O*>());
+                  this->_Keys->set(i,value_type(gctools::make_tagged_unbound<core::T_O*>()));
+                  this->_Values->set(i,value_type(gctools::make_tagged_unbound<core::T_O*>()));
 		}
 		(*this->_Keys).setUsed(0);
 		(*this->_Keys).setDeleted(0);
@@ -475,14 +408,16 @@ void WeakKeyHashTable::clrhash() {
 CL_DEFUN core::Vector_sp weak_key_hash_table_pairs(const WeakKeyHashTable& ht) {
   size_t len = (*ht._Keys).length();
   core::ComplexVector_T_sp keyvalues = core::ComplexVector_T_O::make(len*2,_Nil<core::T_O>(),core::make_fixnum(0));
-  size_t idx(0);
   HT_READ_LOCK(&ht);
   for ( size_t i(0); i<len; ++i ) {
-    if ( (*ht._Keys)[i].raw_() &&
-         !(*ht._Keys)[i].unboundp() &&
-         !(*ht._Keys)[i].deletedp() ) {
-      keyvalues->vectorPushExtend((*ht._Keys)[i],16);
-      keyvalues->vectorPushExtend((*ht._Values)[i],16);
+    WeakKeyHashTable::value_type k = (*ht._Keys)[i];
+    WeakKeyHashTable::value_type v = (*ht._Values)[i];
+    if ( WeakKeyHashTable::liveEntryp(k, v) ) {
+      core::T_sp key = weak_bucket_decode(k);
+      core::T_sp value = weak_bucket_decode(v);
+      if (value.sameAsKeyP()) value = key;
+      keyvalues->vectorPushExtend(key,16);
+      keyvalues->vectorPushExtend(value,16);
     }
   }
   return keyvalues;
@@ -626,6 +626,8 @@ size_t processMpsMessages(size_t& finalizations) {
     assert(b); /* we just checked there was one */
     if (type == mps_message_type_gc_start()) {
       ++mGcStart;
+      // MPS reports collections through messages after the fact so only an instant is recorded
+      telemetry::event(telemetry::event_gc,telemetry::phase_instant,mps_message_clock(global_arena,message));
 #if 1
       if (getenv("CLASP_GC_MESSAGES")) {
         printf("%s:%d Message: mps_message_type_gc_start()\n", __FILE__, __LINE__);
@@ -1,334 +1,406 @@
+/*
+    File: telemetry.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+#include <time.h>
+#include <cinttypes>
+#include <unistd.h>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <pthread.h>
+#ifdef _TARGET_OS_LINUX
+#include <sys/syscall.h>
+#endif
 #include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/array.h>
 #include <clasp/core/pathname.h>
 #include <clasp/core/wrappers.h>
-#include <clasp/core/telemetry.h>
+#include <clasp/gctools/telemetry.h>
 
 namespace telemetry {
 
-void throw_if_invalid_global_telemetry_search() {
-  if (global_telemetry_search == NULL) {
-    SIMPLE_ERROR(BF("No global_telemetry_search has been defined - use telemetry-open"));
-  }
+std::atomic<bool> global_telemetry_on(false);
+std::atomic<bool> global_telemetry_enabled[event_max];
+
+/*! Every ring that was ever allocated - rings are reused, never freed */
+std::atomic<Ring*> global_rings(NULL);
+
+/*! Rings allocated when telemetry starts so that threads recording from
+    contexts that must not allocate (the collector) usually find one */
+#define TELEMETRY_PREALLOCATED_RINGS 16
+
+THREAD_LOCAL Ring* tl_ring;
+
+mp::Mutex global_telemetry_mutex(TELEMETR_NAMEWORD);
+std::vector<std::string> global_event_names;
+EventType global_next_event_type = event_first_user;
+std::atomic<bool> global_event_names_changed(false);
+
+FILE* global_telemetry_file = NULL;
+std::thread* global_telemetry_flusher = NULL;
+std::atomic<bool> global_telemetry_flusher_stop(false);
+size_t global_telemetry_flush_milliseconds = 100;
+std::atomic<size_t> global_telemetry_events_written(0);
+std::atomic<size_t> global_telemetry_events_dropped(0);
+
+static inline uint64_t telemetry_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
 }
 
-CL_LAMBDA(pathname);
-CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_open(core::T_sp tpathname) {
-  if (tpathname.nilp()) SIMPLE_ERROR(BF("%s was about to pass nil to pathname") % __FUNCTION__);
-  core::Pathname_sp pathname = core::cl__pathname(tpathname);
-  core::String_sp filename = core::cl__namestring(pathname);
-  global_telemetry_search = new Telemetry();
-  global_telemetry_search->open_read(filename->get_std_string().c_str());
-  if (global_telemetry_search->_File == NULL ) {
-    printf("Could not open file: %s\n", _rep_(pathname).c_str());
+static inline uint64_t telemetry_thread_id() {
+#if defined(_TARGET_OS_LINUX)
+  return (uint64_t)syscall(SYS_gettid);
+#else
+  return (uint64_t)pthread_self();
+#endif
+}
+
+static void initialize_event_names() {
+  if (global_event_names.size()==0) {
+    global_event_names.resize(event_max);
+    global_event_names[event_undefined] = "undefined";
+    global_event_names[event_gc] = "gc";
+    global_event_names[event_jit_compile] = "jit-compile";
+    global_event_names[event_lock_wait] = "lock-wait";
+    global_event_names[event_gf_miss] = "gf-dispatch-miss";
+    for ( EventType type = event_gc; type < event_first_user; ++type ) global_telemetry_enabled[type] = true;
   }
 }
-#define MAX_WORDS 16
 
-#define CANONICAL_POINTER(p) (p & (~0x7))
+static Ring* allocate_ring() {
+  Ring* ring = new Ring();
+  ring->_Head = 0;
+  ring->_Tail = 0;
+  ring->_Dropped = 0;
+  ring->_InUse = false;
+  ring->_ThreadId = 0;
+  Ring* head = global_rings.load();
+  do {
+    ring->_Next = head;
+  } while (!global_rings.compare_exchange_weak(head,ring));
+  return ring;
+}
 
-CL_LAMBDA(addresses);
-CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_search(core::List_sp addresses) {
-  throw_if_invalid_global_telemetry_search();
-  global_telemetry_search->seek0();
-  size_t prev, cur;
-  Telemetry::Header header;
-  std::vector<std::string> results;
-  std::vector<Word> tests;
-  for (auto it : addresses) {
-    core::T_sp address = oCar(it);
-    if (!address.fixnump()) {
-      SIMPLE_ERROR(BF("Inputs must all be fixnums"));
-    }
-    tests.push_back(address.unsafe_fixnum() & (~0x7));
-  }
-  Handle label;
-  Word data[MAX_WORDS];
-  while (1) {
-    bool read = global_telemetry_search->read_header(header);
-    if (!read)
-      break;
-    if (global_telemetry_search->process_header(header))
-      continue;
-    size_t num_read = global_telemetry_search->read_data(label, MAX_WORDS, data);
-    for (int i(0); i < num_read; ++i) {
-      for (auto it : tests) {
-        if (it == CANONICAL_POINTER(data[i])) {
-          std::string entry = global_telemetry_search->entry_as_string(label, num_read, data);
-          results.push_back(entry);
-        }
-      }
+/*! Claim a drained ring nobody owns, or allocate one if may_allocate */
+static Ring* claim_ring(bool may_allocate) {
+  for ( Ring* ring = global_rings.load(); ring; ring = ring->_Next ) {
+    if (ring->_InUse.load(std::memory_order_relaxed)) continue;
+    // Only reuse drained rings so events are never attributed to the wrong thread
+    if (ring->_Head.load(std::memory_order_acquire) != ring->_Tail.load(std::memory_order_acquire)) continue;
+    bool expected = false;
+    if (ring->_InUse.compare_exchange_strong(expected,true)) {
+      ring->_ThreadId = telemetry_thread_id();
+      return ring;
     }
   }
-  for (auto &it : results) {
-    printf("%s:%d  %s\n", __FILE__, __LINE__, it.c_str());
-  }
+  if (!may_allocate) return NULL;
+  Ring* ring = allocate_ring();
+  ring->_ThreadId = telemetry_thread_id();
+  ring->_InUse = true;
+  return ring;
 }
 
-CL_LAMBDA(label &optional (begin 0) end);
-CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_search_labels(core::List_sp labels) {
-  throw_if_invalid_global_telemetry_search();
-  global_telemetry_search->seek0();
-  size_t prev, cur;
-  Telemetry::Header header;
-  std::vector<std::string> results;
-  std::vector<Word> tests;
-  for (auto it : labels) {
-    core::T_sp address = oCar(it);
-    if (!address.fixnump()) {
-      SIMPLE_ERROR(BF("Inputs must all be fixnums"));
-    }
-    tests.push_back(address.unsafe_fixnum() & (~0x7));
+/*! Gives the ring back when the thread exits.  This is a pthread key destructor
+    rather than a thread_local destructor because registering one of those can call
+    malloc, and rings are also claimed from the collector.  The key's value is set
+    to the thread's tl_ring slot in register_thread, because the first
+    pthread_setspecific of a thread can allocate too. */
+pthread_key_t global_ring_release_key;
+std::once_flag global_ring_release_key_once;
+
+static void release_ring(void* vslot) {
+  Ring** slot = (Ring**)vslot;
+  if (Ring* ring = *slot) {
+    ring->_InUse.store(false,std::memory_order_release);
+    *slot = NULL;
   }
-  Handle label;
-  Word data[MAX_WORDS];
-  size_t index = 0, pos;
-  while (1) {
-    bool read = global_telemetry_search->read_header(header);
-    if (!read)
-      break;
-    if (global_telemetry_search->process_header(header))
-      continue;
-    size_t num_read = global_telemetry_search->read_data(label, MAX_WORDS, data);
-    for (int i(0); i < num_read; ++i) {
-      for (auto it : tests) {
-        if (it == label) {
-          std::string entry = global_telemetry_search->entry_as_string(label, num_read, data);
-          results.push_back(entry);
-        }
+}
+
+static void create_ring_release_key() {
+  std::call_once(global_ring_release_key_once,[]() {
+      if (pthread_key_create(&global_ring_release_key,release_ring) != 0) {
+        SIMPLE_ERROR(BF("Could not create the telemetry thread key"));
       }
-    }
+    });
+}
+
+void register_thread() {
+  create_ring_release_key();
+  pthread_setspecific(global_ring_release_key,&tl_ring);
+}
+
+void record_event(EventType type, EventPhase phase, uint64_t argument, bool may_allocate) {
+  Ring* ring = tl_ring;
+  if (__builtin_expect(ring==NULL,0)) {
+    ring = claim_ring(may_allocate);
+    if (!ring) return;
+    tl_ring = ring;
+    // A thread that never registered still gives its ring back - when it may allocate
+    if (may_allocate && !pthread_getspecific(global_ring_release_key)) register_thread();
   }
-  for (auto &it : results) {
-    printf("%s:%d  %s\n", __FILE__, __LINE__, it.c_str());
+  uint64_t head = ring->_Head.load(std::memory_order_relaxed);
+  if (head - ring->_Tail.load(std::memory_order_acquire) >= TELEMETRY_RING_SIZE) {
+    ring->_Dropped.fetch_add(1,std::memory_order_relaxed);
+    return;
   }
+  Event& event = ring->_Events[head & (TELEMETRY_RING_SIZE-1)];
+  event._Timestamp = telemetry_now();
+  event._Type = type;
+  event._Phase = phase;
+  event._Argument = argument;
+  ring->_Head.store(head+1,std::memory_order_release);
 }
 
-CL_LAMBDA(address);
-CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_follow(core::T_sp address) {
-  throw_if_invalid_global_telemetry_search();
-  global_telemetry_search->seek0();
-  size_t prev, cur;
-  Telemetry::Header header;
-  std::vector<std::string> results;
-  std::vector<Word> tests;
-  if (!address.fixnump()) {
-    SIMPLE_ERROR(BF("Input must be fixnum"));
+static void write_record(FILE* fout, RecordKind kind, size_t size) {
+  RecordHeader header;
+  header._Kind = kind;
+  header._Size = size;
+  fwrite(&header,sizeof(header),1,fout);
+}
+
+static void write_event_names(FILE* fout) {
+  for ( EventType type = event_gc; type < event_max; ++type ) {
+    const std::string& name = global_event_names[type];
+    if (name.size()==0) continue;
+    write_record(fout,record_event_name,sizeof(uint32_t)+name.size());
+    fwrite(&type,sizeof(type),1,fout);
+    fwrite(name.data(),1,name.size(),fout);
   }
-  tests.push_back(address.unsafe_fixnum() & (~0x7));
-  Handle label;
-  Word data[MAX_WORDS];
-  while (1) {
-    bool read = global_telemetry_search->read_header(header);
-    if (!read)
-      break;
-    if (global_telemetry_search->process_header(header))
-      continue;
-    size_t num_read = global_telemetry_search->read_data(label, MAX_WORDS, data);
-    for (auto it : tests) {
-      if (label == label_obj_fwd) {
-        if (it == CANONICAL_POINTER(data[0])) {
-          tests.push_back(data[1]);
-          goto SAVE_RESULT;
-        }
-      }
-      for (int i(0); i < num_read; ++i) {
-        if (it == CANONICAL_POINTER(data[i])) {
-          goto SAVE_RESULT;
-        }
-      }
-    }
-    continue;
-  SAVE_RESULT:
-    std::string entry = global_telemetry_search->entry_as_string(label, num_read, data);
-    results.push_back(entry);
+}
+
+static void drain_rings(FILE* fout) {
+  if (global_event_names_changed.exchange(false)) {
+    WITH_READ_WRITE_LOCK(global_telemetry_mutex);
+    write_event_names(fout);
   }
-  for (auto &it : results) {
-    printf("%s:%d  %s\n", __FILE__, __LINE__, it.c_str());
+  for ( Ring* ring = global_rings.load(); ring; ring = ring->_Next ) {
+    uint64_t head = ring->_Head.load(std::memory_order_acquire);
+    uint64_t tail = ring->_Tail.load(std::memory_order_relaxed);
+    uint64_t dropped = ring->_Dropped.exchange(0,std::memory_order_relaxed);
+    if (head==tail && dropped==0) continue;
+    size_t num = head-tail;
+    write_record(fout,record_events,2*sizeof(uint64_t)+num*sizeof(Event));
+    uint64_t thread_id = ring->_ThreadId.load();
+    fwrite(&thread_id,sizeof(thread_id),1,fout);
+    fwrite(&dropped,sizeof(dropped),1,fout);
+    size_t start = tail & (TELEMETRY_RING_SIZE-1);
+    size_t first = std::min(num,(size_t)(TELEMETRY_RING_SIZE-start));
+    fwrite(&ring->_Events[start],sizeof(Event),first,fout);
+    fwrite(&ring->_Events[0],sizeof(Event),num-first,fout);
+    ring->_Tail.store(head,std::memory_order_release);
+    global_telemetry_events_written += num;
+    global_telemetry_events_dropped += dropped;
   }
+  fflush(fout);
 }
 
-CL_LAMBDA();
-CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_labels() {
-  throw_if_invalid_global_telemetry_search();
-  for (int i(0); i < global_telemetry_search->_Labels.size(); ++i) {
-    printf("[%d] %s\n", i, global_telemetry_search->_Labels[i].c_str());
+static void telemetry_flusher() {
+  while (!global_telemetry_flusher_stop.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(global_telemetry_flush_milliseconds));
+    drain_rings(global_telemetry_file);
   }
 }
 
-CL_LAMBDA(&optional (begin 0) end);
+SYMBOL_EXPORT_SC_(KeywordPkg,begin);
+SYMBOL_EXPORT_SC_(KeywordPkg,end);
+SYMBOL_EXPORT_SC_(KeywordPkg,instant);
+
+CL_LAMBDA(pathname &optional (flush-milliseconds 100));
 CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN void core__telemetry_dump(core::T_sp begin, core::T_sp end) {
-  throw_if_invalid_global_telemetry_search();
-  if (!begin.fixnump()) {
-    SIMPLE_ERROR(BF("begin must be a FIXNUM"));
-  }
-  core::Fixnum fn_begin = begin.unsafe_fixnum();
-  core::Fixnum fn_end;
-  if (end.nilp()) {
-    fn_end = gctools::most_positive_uint;
-  } else if (end.fixnump()) {
-    fn_end = end.unsafe_fixnum();
-  } else {
-    SIMPLE_ERROR(BF("Illegal value for end"));
-  }
-  global_telemetry_search->seek0();
-  size_t cur;
-  Telemetry::Header header;
-  Handle label;
-  Word data[MAX_WORDS];
-  while (1) {
-    bool read = global_telemetry_search->read_header(header);
-    if (!read)
-      break;
-    if (global_telemetry_search->process_header(header))
-      continue;
-    size_t num_read = global_telemetry_search->read_data(label, MAX_WORDS, data);
-    if (global_telemetry_search->_Index < fn_begin)
-      continue;
-    if (global_telemetry_search->_Index > fn_end)
-      break;
-    std::string entry = global_telemetry_search->entry_as_string(label, num_read, data);
-    printf("%s\n", entry.c_str());
-    if ((global_telemetry_search->_Index % 1000000) == 0 ) {
-      gctools::poll_signals();
-      printf("%s:%d Searching record index %" PRu " at file offset %lu\n", __FILE__, __LINE__, global_telemetry_search->_Index, global_telemetry_search->_ThisRecordPos);
-    }
+CL_DOCSTRING(R"(Start recording telemetry events into the file at pathname.
+A background thread drains the per-thread event rings every flush-milliseconds.)");
+CL_DEFUN void core__telemetry_start(core::T_sp tpathname, size_t flush_milliseconds) {
+  if (tpathname.nilp()) SIMPLE_ERROR(BF("%s was about to pass nil to pathname") % __FUNCTION__);
+  if (flush_milliseconds==0) SIMPLE_ERROR(BF("flush-milliseconds must be positive"));
+  core::String_sp filename = core::cl__namestring(core::cl__pathname(tpathname));
+  WITH_READ_WRITE_LOCK(global_telemetry_mutex);
+  if (global_telemetry_file) SIMPLE_ERROR(BF("Telemetry is already being recorded"));
+  initialize_event_names();
+  FILE* fout = fopen(filename->get_std_string().c_str(),"wb");
+  if (!fout) SIMPLE_ERROR(BF("Could not open telemetry file %s: %s") % filename->get_std_string() % strerror(errno));
+  FileHeader header;
+  header._Magic = TELEMETRY_MAGIC;
+  header._Version = TELEMETRY_VERSION;
+  header._ProcessId = getpid();
+  fwrite(&header,sizeof(header),1,fout);
+  write_event_names(fout);
+  size_t rings = 0;
+  for ( Ring* ring = global_rings.load(); ring; ring = ring->_Next ) ++rings;
+  for ( ; rings < TELEMETRY_PREALLOCATED_RINGS; ++rings ) allocate_ring();
+  global_telemetry_file = fout;
+  global_telemetry_events_written = 0;
+  global_telemetry_events_dropped = 0;
+  global_telemetry_flush_milliseconds = flush_milliseconds;
+  global_telemetry_flusher_stop = false;
+  global_telemetry_flusher = new std::thread(telemetry_flusher);
+  global_telemetry_on = true;
+}
+
+CL_DOCSTRING("Stop recording telemetry and return (values events-written events-dropped).");
+CL_DEFUN core::T_mv core__telemetry_stop() {
+  std::thread* flusher;
+  {
+    WITH_READ_WRITE_LOCK(global_telemetry_mutex);
+    if (!global_telemetry_file) return Values(core::make_fixnum(0),core::make_fixnum(0));
+    global_telemetry_on = false;
+    global_telemetry_flusher_stop = true;
+    flusher = global_telemetry_flusher;
+    global_telemetry_flusher = NULL;
   }
+  flusher->join();
+  delete flusher;
+  drain_rings(global_telemetry_file);
+  fclose(global_telemetry_file);
+  global_telemetry_file = NULL;
+  return Values(core::make_fixnum(global_telemetry_events_written.load()),
+                core::make_fixnum(global_telemetry_events_dropped.load()));
 }
 
-CL_LAMBDA();
+CL_LAMBDA(name);
 CL_DECLARE();
-CL_DOCSTRING("");
-CL_DEFUN size_t core__telemetry_count() {
-  throw_if_invalid_global_telemetry_search();
-  global_telemetry_search->seek0();
-  size_t prev, cur;
-  Telemetry::Header header;
-  Handle label;
-  Word data[MAX_WORDS];
-  while (1) {
-    bool read = global_telemetry_search->read_header(header);
-    if (!read) break;
-    if (global_telemetry_search->process_header(header)) continue;
-    size_t num_read = global_telemetry_search->read_data(label, MAX_WORDS, data);
-    if ((global_telemetry_search->_Index % 1000000) == 0 ) {
-      gctools::poll_signals();
-      printf("%s:%d Searching record index %" PRu " at file offset %lu\n", __FILE__, __LINE__, global_telemetry_search->_Index, global_telemetry_search->_ThisRecordPos);
-    }
+CL_DOCSTRING("Return the telemetry event type for name (a string), defining it if necessary.");
+CL_DEFUN size_t core__telemetry_define_event(core::String_sp name) {
+  std::string sname = name->get_std_string();
+  WITH_READ_WRITE_LOCK(global_telemetry_mutex);
+  initialize_event_names();
+  for ( EventType type = event_gc; type < global_next_event_type; ++type ) {
+    if (global_event_names[type] == sname) return type;
+  }
+  if (global_next_event_type >= event_max) {
+    SIMPLE_ERROR(BF("Only %d telemetry event types can be defined") % (event_max-event_first_user));
   }
-  return global_telemetry_search->_Index;
+  EventType type = global_next_event_type++;
+  global_event_names[type] = sname;
+  global_telemetry_enabled[type] = true;
+  global_event_names_changed = true;
+  return type;
 }
 
-char *global_clasp_telemetry_file;
+CL_LAMBDA(type enabled);
+CL_DECLARE();
+CL_DOCSTRING("Enable or disable recording of telemetry events of type.");
+CL_DEFUN void core__telemetry_enable_event(size_t type, bool enabled) {
+  if (type==event_undefined || type >= event_max) SIMPLE_ERROR(BF("%d is not a telemetry event type") % type);
+  global_telemetry_enabled[type] = enabled;
+}
 
+CL_LAMBDA(type);
+CL_DECLARE();
+CL_DOCSTRING("Return true if telemetry is being recorded and events of type are enabled.");
+CL_DEFUN bool core__telemetry_event_enabled_p(size_t type) {
+  return type < event_max && event_enabled(type);
+}
 
-void Telemetry::dump_entry_varargs(Handle label, size_t num, ... )
-{
-  Word data[8];
-  va_list arguments;
-  va_start(arguments,num);
-  for ( int x = 0; x<num; ++x ) {
-    data[x] = va_arg(arguments,Word);
-  }
-  va_end(arguments);
-  std::string msg = this->entry_as_string(label,num,data);
-  printf("%s\n", msg.c_str());
+CL_LAMBDA(type phase &optional (argument 0));
+CL_DECLARE();
+CL_DOCSTRING("Record a telemetry event of type - phase is one of :begin, :end or :instant.");
+CL_DEFUN void core__telemetry_event(size_t type, core::Symbol_sp phase, size_t argument) {
+  if (type==event_undefined || type >= event_max) SIMPLE_ERROR(BF("%d is not a telemetry event type") % type);
+  if (!event_enabled(type)) return;
+  EventPhase ephase;
+  if (phase == kw::_sym_begin) ephase = phase_begin;
+  else if (phase == kw::_sym_end) ephase = phase_end;
+  else if (phase == kw::_sym_instant) ephase = phase_instant;
+  else SIMPLE_ERROR(BF("The telemetry event phase must be :begin, :end or :instant - it was %s") % _rep_(phase));
+  record_event(type,ephase,argument,true);
 }
 
-std::string Telemetry::entry_as_string(Handle label, size_t num_read, Word data[]) {
-  std::string slabel = global_telemetry_search->_Labels[label];
-  char buffer[1024];
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-security"
-  switch (num_read) {
-  case 0:
-    sprintf(buffer, slabel.c_str());
-    break;
-  case 1:
-    sprintf(buffer, slabel.c_str(), data[0]);
-    break;
-  case 2:
-    sprintf(buffer, slabel.c_str(), data[0], data[1]);
-    break;
-  case 3:
-    sprintf(buffer, slabel.c_str(), data[0], data[1], data[2]);
-    break;
-  case 4:
-    sprintf(buffer, slabel.c_str(), data[0], data[1], data[2], data[3]);
-    break;
-  case 5:
-    sprintf(buffer, slabel.c_str(), data[0], data[1], data[2], data[3], data[4]);
-    break;
-  case 6:
-    sprintf(buffer, slabel.c_str(), data[0], data[1], data[2], data[3], data[4], data[5]);
-    break;
-  case 7:
-    sprintf(buffer, slabel.c_str(), data[0], data[1], data[2], data[3], data[4], data[5], data[6]);
-    break;
-  default:
-    sprintf(buffer, "Add support for %zu arguments", num_read);
+static std::string json_escape(const std::string& name) {
+  std::string escaped;
+  for ( auto c : name ) {
+    if (c=='"' || c=='\\') escaped.push_back('\\');
+    if ((unsigned char)c < ' ') continue;
+    escaped.push_back(c);
   }
-#pragma clang diagnostic pop
-  stringstream ss;
-  ss << "[" << this->_Index << "] fp: " << std::hex << this->_ThisRecordPos << " : " << buffer;
-  return ss.str();
+  return escaped;
 }
 
-void Telemetry::initialize() {
-  this->intern("telemetry undefined label", label_undefined);
-  this->intern("mps_allocation base @%p client@%p client_end@%p kind: %" PRu "", label_allocation);
-  this->intern("obj_pad base@%p size: %" PRu "", label_obj_pad);
-  this->intern("obj_scan_start client@%p limit@%p", label_obj_scan_start);
-  this->intern("obj_scan client@%p after_client@%p kind: %" PRu "", label_obj_scan);
-  this->intern("obj_isfwd == TRUE client@%p base@%p forward@%p", label_obj_isfwd_true);
-  this->intern("obj_isfwd == FALSE client@%p base@%p", label_obj_isfwd_false);
-  this->intern("obj_skip in-client@%p  out-client@%p size=%" PRu "", label_obj_skip);
-  this->intern("obj_fwd old-client@%p new-client@%p", label_obj_fwd);
-  this->intern("obj_finalize addr@%p", label_obj_finalize);
-  this->intern("root_scan_start", label_root_scan_start);
-  this->intern("root_scan_stop", label_root_scan_stop);
-  this->intern("smart_ptr_fix ptr@%p value before@%p after@%p", label_smart_ptr_fix);
-  this->intern("tagged_pointer_fix ptr@%p value before@%p after@%p", label_tagged_pointer_fix);
-  this->intern("Message address: %p value: %" PRu "", label_msg);
-  this->intern("label_stack_frame_scan_start base@%p limit@%p", label_stack_frame_scan_start);
-  this->intern("label_stack_frame_scan base@%p base_end@%p type=%" PRu "", label_stack_frame_scan);
-  this->intern("label_stack_frame_skip base@%p base_end@%p size: %" PRu "", label_stack_frame_skip);
-  this->intern("label_stack_frame_pad  base@%p size: %" PRu "", label_stack_frame_pad);
-  this->intern("label_stack_push_prepare ap@%p ap->init@%p ap->alloc@%p ap->limit@%p ap->_frameptr@%p ap->_enabled:%" PRu " ap->_lwpoppending:%lu", label_stack_push_prepare);
-  this->intern("label_stack_push ap@%p frame@%p depth:%" PRu "", label_stack_push);
-  this->intern("label_stack_allocate alloc@%p size: %" PRu "", label_stack_allocate);
-  this->intern("label_stack_pop ap@%p frame@%p", label_stack_pop);
-  this->intern("obj_deallocate_unmanaged_instance addr@%p", label_obj_deallocate_unmanaged_instance);
-  this->intern("cons_mps_allocation base @%p client@%p client_end@%p kind: %" PRu "", label_cons_allocation);
-    this->intern("cons_pad base@%p size: %" PRu "", label_cons_pad);
-  this->intern("cons_scan_start client@%p limit@%p", label_cons_scan_start);
-  this->intern("cons_scan client@%p after_client@%p kind: %" PRu "", label_cons_scan);
-  this->intern("cons_isfwd == TRUE client@%p base@%p forward@%p", label_cons_isfwd_true);
-  this->intern("cons_isfwd == FALSE client@%p base@%p", label_cons_isfwd_false);
-  this->intern("cons_skip in-client@%p  out-client@%p size=%" PRu "", label_cons_skip);
-  this->intern("cons_fwd old-client@%p new-client@%p", label_cons_fwd);
-
-};
-
-void initialize_telemetry_functions() {
+CL_LAMBDA(input output);
+CL_DECLARE();
+CL_DOCSTRING(R"(Convert the telemetry file input into Chrome trace-event JSON in the file output.
+Returns the number of events converted.)");
+CL_DEFUN size_t core__telemetry_to_chrome_json(core::T_sp input, core::T_sp output) {
+  std::string inname = gc::As<core::String_sp>(core::cl__namestring(input))->get_std_string();
+  std::string outname = gc::As<core::String_sp>(core::cl__namestring(output))->get_std_string();
+  FILE* fin = fopen(inname.c_str(),"rb");
+  if (!fin) SIMPLE_ERROR(BF("Could not open telemetry file %s: %s") % inname % strerror(errno));
+  FileHeader header;
+  if (fread(&header,sizeof(header),1,fin)!=1 || header._Magic != TELEMETRY_MAGIC || header._Version != TELEMETRY_VERSION) {
+    fclose(fin);
+    SIMPLE_ERROR(BF("%s is not a telemetry file") % inname);
+  }
+  FILE* fout = fopen(outname.c_str(),"w");
+  if (!fout) {
+    fclose(fin);
+    SIMPLE_ERROR(BF("Could not open %s for writing: %s") % outname % strerror(errno));
+  }
+  std::vector<std::string> names(event_max);
+  size_t events = 0;
+  fprintf(fout,"{\"traceEvents\":[\n");
+  RecordHeader record;
+  while (fread(&record,sizeof(record),1,fin)==1) {
+    std::string buffer(record._Size,'\0');
+    if (fread((void*)buffer.data(),1,record._Size,fin)!=record._Size) break;
+    if (record._Kind == record_event_name && record._Size >= sizeof(uint32_t)) {
+      uint32_t type;
+      memcpy(&type,buffer.data(),sizeof(type));
+      if (type < event_max) names[type] = json_escape(buffer.substr(sizeof(uint32_t)));
+    } else if (record._Kind == record_events && record._Size >= 2*sizeof(uint64_t)) {
+      uint64_t thread_id, dropped;
+      memcpy(&thread_id,buffer.data(),sizeof(thread_id));
+      memcpy(&dropped,buffer.data()+sizeof(uint64_t),sizeof(dropped));
+      size_t num = (record._Size-2*sizeof(uint64_t))/sizeof(Event);
+      const Event* cur = (const Event*)(buffer.data()+2*sizeof(uint64_t));
+      uint64_t last_timestamp = 0;
+      for ( size_t idx=0; idx<num; ++idx ) {
+        Event event;
+        memcpy(&event,cur+idx,sizeof(event));
+        last_timestamp = event._Timestamp;
+        const std::string& name = (event._Type<event_max && names[event._Type].size()) ? names[event._Type] : names[event_undefined];
+        fprintf(fout,"%s{\"name\":\"%s\",\"cat\":\"clasp\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03" PRIu64 ",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64 "%s,\"args\":{\"argument\":%" PRIu64 "}}\n",
+                (events ? "," : ""), name.size() ? name.c_str() : "undefined", (char)event._Phase,
+                event._Timestamp/1000, event._Timestamp%1000, header._ProcessId, thread_id,
+                (event._Phase==phase_instant) ? ",\"s\":\"t\"" : "", event._Argument);
+        ++events;
+      }
+      if (dropped) {
+        fprintf(fout,"%s{\"name\":\"dropped\",\"cat\":\"clasp\",\"ph\":\"C\",\"ts\":%" PRIu64 ".%03" PRIu64 ",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64 ",\"args\":{\"dropped\":%" PRIu64 "}}\n",
+                (events ? "," : ""), last_timestamp/1000, last_timestamp%1000, header._ProcessId, thread_id, dropped);
+        ++events;
+      }
+    }
+  }
+  fprintf(fout,"]}\n");
+  fclose(fout);
+  fclose(fin);
+  return events;
 }
-};
 
-extern "C" {
-void global_telemetry_flush() {
-#ifdef DEBUG_TELEMETRY
-  telemetry::global_telemetry_search->flush();
-#endif
-};
 };
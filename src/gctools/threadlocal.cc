@@ -8,6 +8,7 @@
 #include <execinfo.h>
 #include <clasp/core/foundation.h>
 #include <clasp/gctools/threadlocal.h>
+#include <clasp/gctools/telemetry.h>
 #include <clasp/core/lisp.h>
 #include <clasp/core/mpPackage.h>
 #include <clasp/core/array.h>
@@ -202,6 +203,7 @@ void ThreadLocalState::initialize_thread(mp::Process_sp process, bool initialize
 //  printf("%s:%d Initialize all ThreadLocalState things this->%p\n",__FILE__, __LINE__, (void*)this);
   this->_Process = process;
   process->_ThreadInfo = this;
+  telemetry::register_thread();
   this->_BFormatStringOutputStream = gc::As<StringOutputStream_sp>(clasp_make_string_output_stream());
 #ifdef CLASP_UNICODE
   this->_WriteToStringOutputStream = gc::As<StringOutputStream_sp>(clasp_make_string_output_stream(STRING_OUTPUT_STREAM_DEFAULT_SIZE,1));
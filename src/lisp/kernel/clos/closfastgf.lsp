@@ -651,6 +651,8 @@ Return true iff a new entry was added; so for example it will return false if an
          (when (maybe-update-instances arguments)
            (return-from dispatch-miss (apply generic-function arguments)))
          ;; OK, real miss.
+         (when (core:telemetry-event-enabled-p core:+telemetry-event-gf-miss+)
+           (core:telemetry-event core:+telemetry-event-gf-miss+ :instant))
          #+debug-fastgf
          (progn
            (gf-log "----{---- A dispatch-miss occurred[(1- (core:next-number))->%s]  -> %s  %N" (1- (core:next-number)) (clos::generic-function-name generic-function))
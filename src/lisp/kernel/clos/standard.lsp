@@ -216,6 +216,8 @@
   ;; instances will have a different stamp from their class, which is how the system
   ;; determines obsolesence (in MAYBE-UPDATE-INSTANCES).
   (core:class-new-stamp class)
+  ;; Slot location caches may have seen the new locations with the old stamp.
+  (invalidate-slot-location-caches)
   ;; Now this removes the class from all generic function fast paths. This ensures that
   ;; if a generic function is specialized where an obsolete instance is, it will go to
   ;; the slow path, which will call MAYBE-UPDATE-INSTANCES.
@@ -150,7 +150,9 @@
 	  (dolist (slotd all-slots)
 	    (setf (gethash (slot-definition-name slotd) locations)
 		  (slot-definition-location slotd))))
-	(setf location-table locations))))
+	(setf location-table locations)
+        (invalidate-slot-location-caches)
+        locations)))
 
 ;;;
 ;;; STANDARD-CLASS INTERFACE
@@ -313,6 +315,111 @@ consequences are not defined."
 		(slot-missing class self slot-name 'SETF value))))))
   value)
 
+;;;
+;;; SLOT LOCATION CACHES
+;;;
+;;; SLOT-VALUE with a constant slot name gets a cache of its own at the
+;;; call site (see the compiler macro and setf expander below). The cache
+;;; remembers the stamp of the last instance it saw and where that instance
+;;; keeps the slot, so the next access to an instance with the same stamp
+;;; reads its rack directly instead of looking in the class's location table.
+;;; Only instance slots of classes with a location table are cached, so
+;;; SLOT-VALUE-USING-CLASS methods are never bypassed.
+;;;
+;;; A stamp identifies one layout of one class, but a class's locations are
+;;; recomputed before its old instances get a new stamp, so a cache entry
+;;; also records *SLOT-LOCATION-CACHE-EPOCH*, which is incremented whenever
+;;; a class's slots are finalized or its instances are made obsolete.
+;;; An entry is an immutable vector #(stamp location epoch) that is
+;;; replaced as a whole, so a thread never sees half of one.
+;;; A miss updates an obsolete instance to its class's new layout first,
+;;; as a generic function call would.
+;;;
+
+(defvar *slot-location-cache-epoch* 0)
+
+(defun invalidate-slot-location-caches ()
+  (setf *slot-location-cache-epoch*
+        (logand (1+ *slot-location-cache-epoch*) most-positive-fixnum)))
+
+(defun make-slot-location-cache () (list nil))
+
+(declaim (inline cached-slot-location))
+(defun cached-slot-location (object cache)
+  (let ((entry (car cache)))
+    (and entry
+         (eq (svref entry 0) (core:instance-stamp object))
+         (eq (svref entry 2) *slot-location-cache-epoch*)
+         (svref entry 1))))
+
+(defun fill-slot-location-cache (object slot-name cache)
+  (when (core:instancep object)
+    (with-early-accessors (+standard-class-slots+)
+      (let* ((epoch *slot-location-cache-epoch*)
+             (class (class-of object))
+             (location-table (class-location-table class)))
+        (when location-table
+          (let ((stamp (core:instance-stamp object))
+                (location (gethash slot-name location-table nil)))
+            ;; Obsolete instances are left to SLOT-VALUE.
+            (when (and (core:fixnump location)
+                       (= stamp (core:class-stamp-for-instances class)))
+              (setf (car cache) (vector stamp location epoch)))))))))
+
+(defun update-obsolete-instance (object)
+  ;; MAYBE-UPDATE-INSTANCE is defined later, in closfastgf.
+  (when (and (core:instancep object)
+             (/= (core:instance-stamp object)
+                 (core:class-stamp-for-instances (class-of object)))
+             (fboundp 'maybe-update-instance))
+    (maybe-update-instance object)))
+
+(defun cached-slot-value (object slot-name cache)
+  (let ((location (cached-slot-location object cache)))
+    (if location
+        (let ((value (core:rack-ref (core:instance-rack object) location)))
+          (if (si:sl-boundp value)
+              value
+              (slot-value object slot-name)))
+        (progn
+          (update-obsolete-instance object)
+          (fill-slot-location-cache object slot-name cache)
+          (slot-value object slot-name)))))
+
+(defun cached-setf-slot-value (value object slot-name cache)
+  (let ((location (cached-slot-location object cache)))
+    (if location
+        (setf (core:rack-ref (core:instance-rack object) location) value)
+        (progn
+          (update-obsolete-instance object)
+          (fill-slot-location-cache object slot-name cache)
+          (setf (slot-value object slot-name) value)))))
+
+(defun constant-slot-name-p (form env)
+  (and (constantp form env)
+       (symbolp (ext:constant-form-value form env))))
+
+(define-compiler-macro slot-value (&whole form object slot-name &environment env)
+  (if (constant-slot-name-p slot-name env)
+      `(cached-slot-value ,object ',(ext:constant-form-value slot-name env)
+                          (load-time-value (make-slot-location-cache)))
+      form))
+
+(define-setf-expander slot-value (&environment env object slot-name)
+  (let ((object-temp (gensym "OBJECT"))
+        (name-temp (gensym "SLOT-NAME"))
+        (store (gensym "STORE")))
+    (if (constant-slot-name-p slot-name env)
+        (let ((name (ext:constant-form-value slot-name env)))
+          (values (list object-temp) (list object) (list store)
+                  `(cached-setf-slot-value ,store ,object-temp ',name
+                                           (load-time-value (make-slot-location-cache)))
+                  `(cached-slot-value ,object-temp ',name
+                                      (load-time-value (make-slot-location-cache)))))
+        (values (list object-temp name-temp) (list object slot-name) (list store)
+                `(funcall #'(setf slot-value) ,store ,object-temp ,name-temp)
+                `(slot-value ,object-temp ,name-temp)))))
+
 ;;; FIXME: (cas slot-value) would be a better name.
 #+threads
 (defun cas-slot-value (old new object slot-name)
@@ -24,7 +24,8 @@
   form-counter ; Counts from zero
   module
   (serious-condition nil) (warnings nil) (other-conditions nil)
-  current-source-pos-info startup-function-name form-output-path)
+  current-source-pos-info startup-function-name form-output-path
+  (cache-key nil) (cached nil))
 
 
 (defun compile-from-module (job &key
@@ -154,6 +155,283 @@
     (cfp-log "Leaving thread ~a~%" (mp:process-name mp:*current-process*))))
 
 
+;;; Compile-file cache
+;;;
+;;; When *compile-file-cache-directory* is set, the object file of every top level
+;;; form is saved in that directory under a key that is the SHA1 of everything
+;;; that went into compiling it:
+;;;   - the source text of the form and a fingerprint of the form as read,
+;;;   - a fingerprint of every macro expansion done while converting it to an AST,
+;;;     so changing a macro recompiles the forms that use it,
+;;;   - the package, readtable case, compiler version, optimization settings,
+;;;     the form counter (it names the startup function in the object file) and
+;;;     the source position of the form (see *compile-file-cache-source-positions*),
+;;;   - a digest of every earlier top level form that can change the compile time
+;;;     environment in ways that are not seen in macro expansions (declaim, defvar,
+;;;     defconstant, defstruct, inline defuns, in-package etc),
+;;;   - the values of constants and the layouts of structures from other files that
+;;;     the form refers to.  Forms that refer to inline functions, types or ftypes
+;;;     defined in other files are not cached because those definitions have no
+;;;     stable printed representation.
+;;; Every form is still read and converted to an AST in order, so compile time side
+;;; effects happen as usual, only the expensive AST->LLVM-IR->object steps are
+;;; skipped for forms whose key is found in the cache.
+;;; Forms that signal any condition while compiling are never cached so that their
+;;; warnings are reported again the next time the file is compiled.
+
+(defvar *compile-file-cache-directory*
+  (let ((dir (ext:getenv "CLASP_COMPILE_FILE_CACHE")))
+    (when (and dir (> (length dir) 0))
+      (pathname (if (char= (char dir (1- (length dir))) #\/) dir (concatenate 'string dir "/")))))
+  "When non-NIL compile-file-parallel saves and reuses the object file of each
+top level form in this directory.  Set from the CLASP_COMPILE_FILE_CACHE environment variable.")
+
+(defvar *compile-file-cache-source-positions* t
+  "When T the source position of a form is part of its compile-file cache key,
+so a form is recompiled when lines are added or removed above it and its debug
+information is always exact.  When NIL cached forms are reused after they move
+within the file, at the cost of stale line numbers in their debug information.")
+
+(defvar *cfp-cache-system-packages* (remove (find-package "COMMON-LISP-USER") (list-all-packages))
+  "Global definitions of the symbols in these packages are part of the
+implementation and covered by the lisp-implementation-id in every cache key.")
+
+(defstruct (cfp-cache (:type vector) :named)
+  directory source-octets
+  (environment-digest "")
+  (local-names (make-hash-table :test #'equal))
+  (hits 0) (misses 0))
+
+(defun cfp-cache-octets (part)
+  "Return PART as a simple vector of octets for the digest."
+  (cond ((not (stringp part)) part)
+        ((core:base-string-p part) (core:base-string-to-octets part))
+        ((every (lambda (ch) (< (char-code ch) 256)) part)
+         (core:character-string-that-fits-in-base-string-to-octets part))
+        ;; The source octets are part of every key so any unambiguous
+        ;; encoding of the wider characters will do
+        (t (core:base-string-to-octets
+            (coerce (format nil "~{~x~^,~}" (map 'list #'char-code part)) 'base-string)))))
+
+(defun cfp-cache-digest (&rest parts)
+  (core:digest-sha1 (loop for part in parts
+                          for octets = (cfp-cache-octets part)
+                          when (> (length octets) 0)
+                            collect octets)))
+
+(defun cfp-cache-fingerprint (objects positions)
+  "Return a string that describes OBJECTS and does not depend on the names that
+gensym gives to uninterned symbols.  Return NIL if some object has no stable
+printed representation (the form then cannot be cached)."
+  (let ((seen (make-hash-table :test #'eq))
+        (next-label 0))
+    (with-output-to-string (stream)
+      (with-standard-io-syntax
+        (labels ((labelled (object)
+                   ;; Write a reference if OBJECT was already seen - otherwise label it
+                   (let ((label (gethash object seen)))
+                     (cond (label (format stream "#~d#" label) t)
+                           (t (setf (gethash object seen) (incf next-label)) nil))))
+                 (fingerprint (object)
+                   (typecase object
+                     (symbol
+                      (let ((package (symbol-package object)))
+                        (cond (package
+                               (prin1 (package-name package) stream)
+                               (write-string "::" stream)
+                               (prin1 (symbol-name object) stream))
+                              ((labelled object))
+                              (t (format stream "#:~s" (string-right-trim "0123456789" (symbol-name object)))))))
+                     (cons
+                      (unless (labelled object)
+                        (write-char #\( stream)
+                        (loop for tail = object then next
+                              for next = (cdr tail)
+                              do (fingerprint (car tail))
+                                 (cond ((null next) (return))
+                                       ((and (consp next) (not (gethash next seen)))
+                                        (setf (gethash next seen) (incf next-label))
+                                        (write-char #\space stream))
+                                       (t (write-string " . " stream)
+                                          (fingerprint next)
+                                          (return))))
+                        (write-char #\) stream)))
+                     ((or number character string bit-vector pathname)
+                      (prin1 object stream))
+                     (array
+                      (unless (labelled object)
+                        (format stream "#A~s~s(" (array-element-type object) (array-dimensions object))
+                        (dotimes (index (array-total-size object))
+                          (fingerprint (row-major-aref object index))
+                          (write-char #\space stream))
+                        (write-char #\) stream)))
+                     (core:source-pos-info
+                      (if positions
+                          (format stream "#<spi ~d ~d>"
+                                  (core:source-pos-info-lineno object)
+                                  (core:source-pos-info-column object))
+                          (write-string "#<spi>" stream)))
+                     (t (return-from cfp-cache-fingerprint nil)))
+                   (write-char #\space stream)))
+          (mapc #'fingerprint objects))))))
+
+(defun cfp-cache-local-form-p (form)
+  "Return T if the compile time side effects of FORM only matter to later forms
+through macro expansions - changing such a form does not invalidate the forms after it."
+  (and (consp form)
+       (case (car form)
+         ((defun) (not (and (consp (cdr form))
+                            (core:declared-global-inline-p (cadr form)))))
+         ((defmethod defmacro) t)
+         (otherwise nil))))
+
+(defun cfp-cache-note-local-definitions (cache objects)
+  "Remember the names that the defining forms in OBJECTS give a global compile
+time definition.  The environment digest covers names defined in this file."
+  (let ((names (cfp-cache-local-names cache))
+        (seen (make-hash-table :test #'eq)))
+    (labels ((note (name) (setf (gethash name names) t))
+             (walk (object)
+               (when (and (consp object) (not (gethash object seen)))
+                 (setf (gethash object seen) t)
+                 (when (consp (cdr object))
+                   (let ((name (cadr object)))
+                     (case (car object)
+                       ((defconstant deftype) (note name))
+                       ((defstruct) (note (if (consp name) (car name) name)))
+                       ((proclaim)
+                        (when (and (consp name) (eq (car name) 'quote) (consp (cadr name)))
+                          (let ((spec (cadr name)))
+                            (case (car spec)
+                              ((inline notinline) (mapc #'note (cdr spec)))
+                              ((ftype type) (when (consp (cdr spec)) (mapc #'note (cddr spec)))))))))))
+                 (walk (car object))
+                 (walk (cdr object)))))
+      (mapc #'walk objects))))
+
+(defun cfp-cache-global-definitions (cache objects)
+  "Return a string that describes the global definitions from other files that
+the names in OBJECTS refer to - constant values and structure layouts.  Return
+NIL if a name refers to an inline function, a type or an ftype from another file,
+those cannot be described and the form is not cached."
+  (let ((seen (make-hash-table :test #'eq))
+        (local-names (cfp-cache-local-names cache))
+        (descriptions nil))
+    (labels ((describe-definition (name kind definition)
+               (let ((fingerprint (cfp-cache-fingerprint (list name kind definition) nil)))
+                 (unless fingerprint (return-from cfp-cache-global-definitions nil))
+                 (push fingerprint descriptions)))
+             (check (name)
+               (let ((symbol (if (consp name) (cadr name) name)))
+                 (unless (or (gethash name local-names)
+                             (member (symbol-package symbol) *cfp-cache-system-packages*))
+                   (when (core:declared-global-inline-p name)
+                     (return-from cfp-cache-global-definitions nil))
+                   #+cclasp
+                   (when (nth-value 1 (gethash name clasp-cleavir::*ftypes*))
+                     (return-from cfp-cache-global-definitions nil))
+                   (when (symbolp name)
+                     (when (ext:type-expander name)
+                       (return-from cfp-cache-global-definitions nil))
+                     (when (and (constantp name) (boundp name))
+                       (describe-definition name :constant (symbol-value name)))
+                     (when (core::structure-type name)
+                       (describe-definition name :structure
+                                            (list (core::structure-type name)
+                                                  (core::structure-slot-descriptions name))))))))
+             (walk (object)
+               (cond ((symbolp object)
+                      (when (and object (not (gethash object seen)))
+                        (setf (gethash object seen) t)
+                        (check object)))
+                     ((and (consp object) (not (gethash object seen)))
+                      (setf (gethash object seen) t)
+                      (when (and (eq (car object) 'setf) (consp (cdr object))
+                                 (symbolp (cadr object)) (null (cddr object)))
+                        (check object))
+                      (walk (car object))
+                      (walk (cdr object))))))
+      (mapc #'walk objects)
+      (format nil "~{~a~}" (sort descriptions #'string<)))))
+
+(defun make-compile-file-cache (source-sin)
+  (when *compile-file-cache-directory*
+    (let ((directory (translate-logical-pathname *compile-file-cache-directory*)))
+      (ensure-directories-exist directory)
+      (make-cfp-cache
+       :directory directory
+       :source-octets (with-open-file (in (pathname source-sin) :element-type '(unsigned-byte 8))
+                        (let ((octets (make-array (file-length in) :element-type '(unsigned-byte 8))))
+                          (read-sequence octets in)
+                          octets))))))
+
+(defun cfp-cache-key (cache form expansions start end form-counter source-pos-info
+                      &key optimize optimize-level)
+  "Return the cache key of a top level form or NIL if it cannot be cached and
+update the environment digest of CACHE."
+  (cfp-cache-note-local-definitions cache (cons form expansions))
+  (let* ((positions *compile-file-cache-source-positions*)
+         (fingerprint (cfp-cache-fingerprint (cons form (reverse expansions)) positions))
+         (definitions (cfp-cache-global-definitions cache (cons form expansions)))
+         (octets (cfp-cache-source-octets cache)))
+    (when (and fingerprint definitions start end (<= start end (length octets)))
+      (let ((key (cfp-cache-digest
+                  (format nil "~a|~a|~a|~a|~a|~a|~a|~d|~a|~a"
+                          (lisp-implementation-version)
+                          (core:lisp-implementation-id)
+                          optimize optimize-level
+                          (package-name *package*)
+                          (readtable-case *readtable*)
+                          (namestring *compile-file-source-debug-pathname*)
+                          form-counter
+                          (if positions
+                              (format nil "~d:~d:~d"
+                                      (core:source-pos-info-filepos source-pos-info)
+                                      (core:source-pos-info-lineno source-pos-info)
+                                      (core:source-pos-info-column source-pos-info))
+                              "")
+                          (cfp-cache-environment-digest cache))
+                  (subseq octets start end)
+                  fingerprint
+                  definitions)))
+        (unless (cfp-cache-local-form-p form)
+          (setf (cfp-cache-environment-digest cache)
+                (cfp-cache-digest (cfp-cache-environment-digest cache)
+                                  (subseq octets start end)
+                                  fingerprint)))
+        key))))
+
+(defun cfp-cache-pathname (cache key &optional (type "o"))
+  (make-pathname :name key :type type :defaults (cfp-cache-directory cache)))
+
+(defun cfp-cache-lookup (cache key)
+  "Return the cached object file for KEY as an octet vector or NIL."
+  (let ((path (probe-file (cfp-cache-pathname cache key))))
+    (when path
+      (ignore-errors
+       (with-open-file (in path :element-type '(unsigned-byte 8))
+         (let ((octets (make-array (file-length in) :element-type '(unsigned-byte 8))))
+           (when (= (read-sequence octets in) (length octets))
+             octets)))))))
+
+(defun cfp-cache-save (cache job)
+  "Save the object file of JOB if it compiled without any conditions.
+The file is written under a temporary name and renamed so readers never see a partial file."
+  (let ((object (ast-job-output-object job)))
+    (when (and (ast-job-cache-key job)
+               (not (ast-job-cached job))
+               (null (ast-job-serious-condition job))
+               (null (ast-job-warnings job))
+               (null (ast-job-other-conditions job))
+               (typep object '(simple-array (unsigned-byte 8) (*))))
+      (let ((temp (cfp-cache-pathname cache (format nil "~a-~d" (ast-job-cache-key job) (core:getpid)) "tmp")))
+        (ignore-errors
+         (with-open-file (out temp :direction :output :element-type '(unsigned-byte 8)
+                                   :if-exists :supersede)
+           (write-sequence object out))
+         (rename-file temp (cfp-cache-pathname cache (ast-job-cache-key job)) :if-exists :supersede))))))
+
+
 (defun cclasp-loop2 (source-sin
                      environment
                      &key
@@ -186,6 +464,8 @@ multithreaded performance that we should explore."
         #+cclasp(core:*use-cleavir-compiler* t)
         #+cclasp(eclector.reader:*client* clasp-cleavir::*cst-client*)
         #+cclasp(eclector.readtable:*readtable* cl:*readtable*)
+        (cache (when (and (eq intermediate-output-type :in-memory-object) (not ast-only))
+                 (make-compile-file-cache source-sin)))
         ast-jobs)
     (cfp-log "Starting the pool of threads~%")
     (finish-output)
@@ -223,7 +503,9 @@ multithreaded performance that we should explore."
              ;; Required to update the source pos info. FIXME!?
              (peek-char t source-sin nil)
              ;; FIXME: if :environment is provided we should probably use a different read somehow
-             (let* ((current-source-pos-info (compile-file-source-pos-info source-sin))
+             (let* ((form-start (when cache (file-position source-sin)))
+                    (expansions nil)
+                    (current-source-pos-info (compile-file-source-pos-info source-sin))
                     (core:*current-source-pos-info* current-source-pos-info)
                     (form-output-path
                       (make-pathname
@@ -231,13 +513,29 @@ multithreaded performance that we should explore."
                        :defaults output-path))
                     (cst (eclector.concrete-syntax-tree:cst-read source-sin nil eof-value))
                     (_ (when (eq cst eof-value) (return nil)))
+                    (form-end (when cache (file-position source-sin)))
                     (form (cst:raw cst))
                     (pre-ast
-                      (if cmp::*debug-compile-file*
-                          (clasp-cleavir::compiler-time
-                           (clasp-cleavir-translate-bir::cst->ast cst))
-                          (clasp-cleavir-translate-bir::cst->ast cst)))
-                    (ast (clasp-cleavir-translate-bir::wrap-ast pre-ast)))
+                      (let ((*macroexpand-hook*
+                              (if cache
+                                  ;; Record the expansions - they are part of the cache key
+                                  (let ((hook *macroexpand-hook*))
+                                    (lambda (expander macro-form env)
+                                      (let ((expansion (funcall hook expander macro-form env)))
+                                        (push expansion expansions)
+                                        expansion)))
+                                  *macroexpand-hook*)))
+                        (if cmp::*debug-compile-file*
+                            (clasp-cleavir::compiler-time
+                             (clasp-cleavir-translate-bir::cst->ast cst))
+                            (clasp-cleavir-translate-bir::cst->ast cst))))
+                    (ast (clasp-cleavir-translate-bir::wrap-ast pre-ast))
+                    (cache-key (when cache
+                                 (cfp-cache-key cache form expansions form-start form-end
+                                                form-counter current-source-pos-info
+                                                :optimize optimize
+                                                :optimize-level optimize-level)))
+                    (cached-object (when cache-key (cfp-cache-lookup cache cache-key))))
                (declare (ignore _))
                (let ((ast-job (make-ast-job :ast ast
                                             :environment environment
@@ -251,14 +549,21 @@ multithreaded performance that we should explore."
                                                              (t
                                                               (error "Handle intermediate-output-type ~a" intermediate-output-type)))
                                             :form-index form-index
-                                            :form-counter form-counter)))
-                 (when compile-from-module
+                                            :form-counter form-counter
+                                            :cache-key cache-key)))
+                 (cond (cached-object
+                        (setf (ast-job-output-object ast-job) cached-object
+                              (ast-job-cached ast-job) t)
+                        (incf (cfp-cache-hits cache)))
+                       (cache (incf (cfp-cache-misses cache))))
+                 (when (and compile-from-module (not cached-object))
                    (let ((module (ast-job-to-module ast-job :optimize optimize :optimize-level optimize-level)))
                      (setf (ast-job-module ast-job) module)))
                  (when *compile-print* (cmp::describe-form form))
                  (unless ast-only
                    (push ast-job ast-jobs)
-                   (core:atomic-enqueue ast-queue ast-job))
+                   (unless cached-object
+                     (core:atomic-enqueue ast-queue ast-job)))
                  #+(or)
                  (compile-from-ast ast-job
                                    :optimize optimize
@@ -292,6 +597,14 @@ multithreaded performance that we should explore."
           ;; if you want to debug problems, it would probably be easier to
           ;; use the serial compiler and debug them as they appear.
           (signal (ast-job-serious-condition job)))))
+    (when cache
+      (dolist (job ast-jobs)
+        (cfp-cache-save cache job))
+      (when *compile-verbose*
+        (bformat t "; Reused %d of %d forms from the compile-file cache %s%N"
+                 (cfp-cache-hits cache)
+                 (+ (cfp-cache-hits cache) (cfp-cache-misses cache))
+                 (namestring (cfp-cache-directory cache)))))
     ;; Now print the names of the startup ctor functions
     ;;     Next we need to compile a new module that declares these ctor functions and puts them in a ctor list
     ;;      then it should add this new module to the result list so it can be linked with the others.
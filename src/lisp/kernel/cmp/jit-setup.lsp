@@ -781,7 +781,11 @@ The passed module is modified as a side-effect."
 (defparameter *dump-compile-module* nil)
 (progn
   (export '(jit-add-module-return-function jit-add-module-return-dispatch-function jit-remove-module))
-  (defparameter *jit-lock* (mp:make-recursive-mutex 'jit-lock))
+  ;;; No global lock is taken around add-irmodule and the startup lookup.
+  ;;; Every thread compiles into its own cmp:*thread-safe-context*, the ORC
+  ;;; ExecutionSession is thread safe and materializes a module on the thread
+  ;;; that looks up its (unique) startup function, and the registries that
+  ;;; NotifyLoaded feeds (symbol info, stackmaps, gdb) have their own locks.
   (defun jit-add-module-return-function (original-module main-fn startup-fn shutdown-fn literals-list
                                          &key output-path)
     ;; Link the builtins into the module and optimize them
@@ -807,9 +811,6 @@ The passed module is modified as a side-effect."
                          (core:bformat t "startup-name |%s|%N" startup-name)
                          (core:bformat t "Done dump module%N")
                          ))
-                   (mp:get-lock *jit-lock*)
                    (llvm-sys:add-irmodule jit-engine (llvm-sys:get-main-jitdylib jit-engine) module cmp:*thread-safe-context*)
                    (llvm-sys:jit-finalize-repl-function jit-engine startup-name shutdown-name literals-list))
-              (progn
-                (gctools:thread-local-cleanup)
-                (mp:giveup-lock *jit-lock*))))))))
+              (gctools:thread-local-cleanup)))))))
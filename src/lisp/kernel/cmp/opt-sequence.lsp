@@ -37,6 +37,61 @@
                  (return ,%elt)))))
         whole)))
 
+;;;
+;;; FIND, POSITION, COUNT with an EQL test
+;;;
+
+;;; Parse the keyword arguments of a FIND, POSITION or COUNT call.  If they
+;;; are only :START, :END, :FROM-END and an EQL :TEST, each at most once,
+;;; return T, bindings that evaluate them in order, and the forms for
+;;; start, end and from-end.
+(defun eql-sequence-args (sequence-args env)
+  (let ((bindings nil) (seen nil) (start 0) (end nil) (from-end nil))
+    (loop
+      (when (null sequence-args)
+        (return (values t (nreverse bindings) start end from-end)))
+      (let ((keyword (pop sequence-args)))
+        (when (or (null sequence-args)
+                  (not (member keyword '(:start :end :from-end :test)))
+                  (member keyword seen))
+          (return nil))
+        (push keyword seen)
+        (let ((form (pop sequence-args))
+              (var (gensym (symbol-name keyword))))
+          (if (eq keyword :test)
+              (unless (or (equal form '(function eql))
+                          (and (constantp form env)
+                               (eq (ext:constant-form-value form env) 'eql)))
+                (return nil))
+              (push (list var form) bindings))
+          (case keyword
+            (:start (setf start var))
+            (:end (setf end var))
+            (:from-end (setf from-end var))))))))
+
+(defun expand-eql-sequence-call (whole function item sequence sequence-args env)
+  (multiple-value-bind (eqlp bindings start end from-end)
+      (eql-sequence-args sequence-args env)
+    (if eqlp
+        (let ((%item (gensym "ITEM")) (%sequence (gensym "SEQUENCE")))
+          `(let* ((,%item ,item)
+                  (,%sequence ,sequence)
+                  ,@bindings)
+             (,function ,%item ,%sequence ,start ,end ,from-end)))
+        whole)))
+
+(define-compiler-macro find (&whole whole item sequence &rest sequence-args
+                                    &environment env)
+  (expand-eql-sequence-call whole 'core::find-eql item sequence sequence-args env))
+
+(define-compiler-macro position (&whole whole item sequence &rest sequence-args
+                                        &environment env)
+  (expand-eql-sequence-call whole 'core::position-eql item sequence sequence-args env))
+
+(define-compiler-macro count (&whole whole item sequence &rest sequence-args
+                                     &environment env)
+  (expand-eql-sequence-call whole 'core::count-eql item sequence sequence-args env))
+
 ;;;
 ;;; MAKE-SEQUENCE
 ;;;
@@ -210,7 +210,7 @@ Returns the specified bit in SIMPLE-BIT-ARRAY."
          (check-array-dims-match result array1)
          result)))
 
-(defmacro def-bit-array-function (name simple-name logop doc)
+(defmacro def-bit-array-function (name boole-op doc)
   `(defun ,name (bit-array1 bit-array2 &optional opt-arg)
      ,doc
      (let ((result (pick-result-array opt-arg bit-array1))
@@ -219,61 +219,57 @@ Returns the specified bit in SIMPLE-BIT-ARRAY."
        (with-array-data ((b1 bit-array1) b1o)
          (with-array-data ((b2 bit-array2) b2o)
            (with-array-data ((r result) ro)
-             (if (and (zerop b1o) (zerop b2o) (zerop ro))
-                 (,simple-name b1 b2 r length)
-                 (dotimes (i length)
-                   (setf (sbit r (+ i ro))
-                         (logand #b1 ; get the low bit only
-                                 (,logop (sbit b1 (+ i b1o)) (sbit b2 (+ i b2o))))))))))
+             ;; Works a word at a time whatever the displaced offsets are
+             (core:sbv-bit-array-op ,boole-op b1 b1o b2 b2o r ro length))))
        result)))
 
 ;; FIXME: Docstring is redundant, but we don't have FORMAT or CONCATENATE yet.
-(def-bit-array-function bit-and core:sbv-bit-and logand
+(def-bit-array-function bit-and boole-and
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise AND of BIT-ARRAY1 and BIT-ARRAY2.  Puts the results
 into a new bit-array if RESULT is NIL, into BIT-ARRAY1 if RESULT is T, or into
 RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-ior core:sbv-bit-ior logior
+(def-bit-array-function bit-ior boole-ior
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise INCLUSIVE OR of BIT-ARRAY1 and BIT-ARRAY2.  Puts the
 results into a new bit-array if RESULT is NIL, into BIT-ARRAY1 if RESULT is T,
 or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-xor core:sbv-bit-xor logxor
+(def-bit-array-function bit-xor boole-xor
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise EXCLUSIVE OR of BIT-ARRAY1 and BIT-ARRAY2.  Puts the
 results into a new bit-array if RESULT is NIL, into BIT-ARRAY1 if RESULT is T,
 or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-eqv core:sbv-bit-eqv logeqv
+(def-bit-array-function bit-eqv boole-eqv
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise EQUIVALENCE of BIT-ARRAY1 and BIT-ARRAY2.  Puts the
 results into a new bit-array if RESULT is NIL, into BIT-ARRAY1 if RESULT is T,
 or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-nand core:sbv-bit-nand lognand
+(def-bit-array-function bit-nand boole-nand
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise NOT of {the element-wise AND of BIT-ARRAY1 and BIT-
 ARRAY2}.  Puts the results into a new bit-array if RESULT is NIL, into BIT-
 ARRAY1 if RESULT is T, or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-nor core:sbv-bit-nor lognor
+(def-bit-array-function bit-nor boole-nor
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise NOT of {the element-wise INCLUSIVE OR of BIT-ARRAY1
 and BIT-ARRAY2}.  Puts the results into a new bit-array if RESULT is NIL, into
 BIT-ARRAY1 if RESULT is T, or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-andc1 core:sbv-bit-andc1 logandc1
+(def-bit-array-function bit-andc1 boole-andc1
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise AND of {the element-wise NOT of BIT-ARRAY1} and BIT-
 ARRAY2.  Puts the results into a new bit-array if RESULT is NIL, into BIT-
 ARRAY1 if RESULT is T, or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-andc2 core:sbv-bit-andc2 logandc2
+(def-bit-array-function bit-andc2 boole-andc2
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise AND of BIT-ARRAY1 and {the element-wise NOT of BIT-
 ARRAY2}.  Puts the results into a new bit-array if RESULT is NIL, into BIT-
 ARRAY1 if RESULT is T, or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-orc1 core:sbv-bit-orc1 logorc1
+(def-bit-array-function bit-orc1 boole-orc1
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise INCLUSIVE OR of {the element-wise NOT of BIT-ARRAY1}
 and BIT-ARRAY2.  Puts the results into a new bit-array if RESULT is NIL, into
 BIT-ARRAY1 if RESULT is T, or into RESULT if RESULT is a bit-array.")
-(def-bit-array-function bit-orc2 core:sbv-bit-orc2 logorc2
+(def-bit-array-function bit-orc2 boole-orc2
   "Args: (bit-array1 bit-array2 &optional (result nil))
 Returns the element-wise INCLUSIVE OR of BIT-ARRAY1 and {the element-wise NOT
 of BIT-ARRAY2}.  Puts the results into a new bit-array if RESULT is NIL, into
@@ -288,11 +284,7 @@ RESULT is a bit-array."
         (length (array-total-size bit-array)))
     (with-array-data ((b bit-array) bo)
       (with-array-data ((r result) ro)
-        (if (and (zerop bo) (zerop ro))
-            (core:sbv-bit-not b r length)
-            (dotimes (i length)
-              (setf (sbit r (+ i ro))
-                    (logand #b1 (lognot (sbit b (+ i bo)))))))))
+        (core:sbv-bit-array-op boole-c1 b bo b bo r ro length)))
     result))
 
 (defun vector-pop (vector)
@@ -5,6 +5,11 @@
 (eval-when (:load-toplevel)
   (cl:in-package :cl-user)
   (let ((core:*use-interpreter-for-eval* nil))
+    ;; The JIT enables its object cache from CLASP_JIT_OBJECT_CACHE before WARN exists
+    (let ((directory (ext:getenv "CLASP_JIT_OBJECT_CACHE")))
+      (when (and directory
+                 (null (llvm-sys:jit-object-cache-statistics llvm-sys:*jit-engine*)))
+        (warn "Could not create the jit object cache directory ~a - the cache is disabled" directory)))
     (core:process-extension-loads)
     (core:maybe-load-clasprc)
     (core:process-command-line-load-eval-sequence)
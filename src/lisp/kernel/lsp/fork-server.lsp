@@ -0,0 +1,71 @@
+;;;
+;;; A fork server keeps a fully loaded image resident and forks a worker
+;;; for every request.  The workers share the loaded heap and the JIT'd code
+;;; with the server copy-on-write.
+;;;
+;;; Clients connect to a Unix domain socket and pass their stdin, stdout and
+;;; stderr along with a request string (see src/fork-server/fork-run.c).
+;;; When the worker exits its wait status is written back to the client.
+;;;
+
+(in-package :ext)
+
+(defvar *fork-server-child-hooks* nil
+  "A list of functions of no arguments that are called in every fork server worker
+before the request is handled.  Only the thread that called fork survives in the worker,
+so any threads that the request needs must be started again from here.")
+
+(defun fork-server-worker (handler request)
+  (let ((status 1))
+    (unwind-protect
+         (handler-case
+             (progn
+               (mapc #'funcall *fork-server-child-hooks*)
+               (let ((result (funcall handler request)))
+                 (setf status (if (integerp result) result 0))))
+           (serious-condition (condition)
+             (format *error-output* "~&Fork server worker failed: ~a~%" condition)))
+      ;; Flush only our own streams and leave with _exit, exit() would run the
+      ;; server's atexit handlers and flush the stdio buffers inherited from it
+      (ignore-errors (finish-output *standard-output*))
+      (ignore-errors (finish-output *error-output*))
+      (core:c_UNDERSCORE_exit status))))
+
+(defun reap-fork-server-workers (workers)
+  (loop
+    (multiple-value-bind (pid status)
+        (core:waitpid :pid -1 :nohang t)
+      (when (<= pid 0) (return))
+      (let ((connection-fd (gethash pid workers)))
+        (when connection-fd
+          (remhash pid workers)
+          (core:fork-server-report-status connection-fd status))))))
+
+(defun fork-server (socket-path handler &key (poll-milliseconds 200) max-requests)
+  "Listen on the Unix domain socket SOCKET-PATH and fork a worker for each request.
+The worker's standard input and output are those of the client and HANDLER is called
+with the request string.  If HANDLER returns an integer it becomes the exit status
+of the worker, otherwise the worker exits with 0.  If MAX-REQUESTS is given the server
+returns once it has forked that many workers and they have all exited, otherwise it
+does not return."
+  (let ((listen-fd (core:fork-server-listen (namestring socket-path)))
+        (workers (make-hash-table))
+        (served 0))
+    (unwind-protect
+         (loop
+           (if (and max-requests (>= served max-requests))
+               (if (zerop (hash-table-count workers))
+                   (return)
+                   (sleep (/ poll-milliseconds 1000)))
+               (multiple-value-bind (connection-fd request stdin-fd stdout-fd stderr-fd)
+                   (core:fork-server-accept listen-fd poll-milliseconds)
+                 (when connection-fd
+                   (let ((pid (core:fork-server-fork listen-fd connection-fd stdin-fd stdout-fd stderr-fd)))
+                     (if (zerop pid)
+                         (fork-server-worker handler request)
+                         (setf (gethash pid workers) connection-fd
+                               served (1+ served)))))))
+           (reap-fork-server-workers workers))
+      (core:fork-server-close listen-fd (namestring socket-path)))))
+
+(export '(*fork-server-child-hooks* fork-server))
@@ -504,6 +504,93 @@
      (formatter-aux destination control-string format-arguments)
      nil)))
 
+;;;; Control string cache
+;;;
+;;; A control string that isn't a constant when FORMAT is compiled used to be
+;;; tokenized on every call.  Such strings are cached here with their
+;;; directives, keyed by EQUAL on a copy - the caller may modify its string
+;;; afterwards, so an EQ key could go stale.  Once a string has been used
+;;; *FORMAT-CACHE-COMPILE-THRESHOLD* times it is compiled with %FORMATTER,
+;;; the same way FORMATTER compiles a constant one.  At most
+;;; *FORMAT-CACHE-SIZE* strings are kept and the least recently used one is
+;;; evicted to make room.
+
+(defparameter *format-cache-size* 256)
+(defparameter *format-cache-compile-threshold* 8)
+(defvar *format-cache* (make-hash-table :test #'equal :thread-safe t))
+(defvar *format-cache-lock* (mp:make-lock :name 'format-cache))
+(defvar *format-cache-clock* 0)
+(defvar *compiling-format-control* nil)
+
+(defstruct (format-cache-entry
+            :named (:type vector)
+            (:constructor make-format-cache-entry (control directives)))
+  ;; Our copy of the control string
+  control
+  directives
+  ;; NIL until compiled, then the function, or :FAILED
+  (function nil)
+  (uses 0 :type fixnum)
+  (last-use 0 :type fixnum))
+
+(defun format-cache-insert (string entry)
+  (mp:get-lock *format-cache-lock*)
+  (unwind-protect
+       (progn
+         (when (>= (hash-table-count *format-cache*) *format-cache-size*)
+           (let ((oldest nil)
+                 (oldest-use most-positive-fixnum))
+             (maphash (lambda (key old)
+                        (when (< (format-cache-entry-last-use old) oldest-use)
+                          (setf oldest key
+                                oldest-use (format-cache-entry-last-use old))))
+                      *format-cache*)
+             (remhash oldest *format-cache*)))
+         (setf (gethash string *format-cache*) entry))
+    (mp:giveup-lock *format-cache-lock*)))
+
+(defun cached-format-control (string)
+  "Return the cache entry for the simple control STRING, tokenizing it if it isn't cached."
+  (let ((entry (gethash string *format-cache*)))
+    (unless entry
+      (let ((copy (copy-seq string)))
+        (setf entry (make-format-cache-entry copy (tokenize-control-string copy)))
+        (format-cache-insert copy entry)))
+    (setf (format-cache-entry-last-use entry) (incf *format-cache-clock*))
+    (incf (format-cache-entry-uses entry))
+    entry))
+
+(defun cached-format-function (entry)
+  "Return the compiled formatter for the cache ENTRY, or NIL if it shouldn't be used yet."
+  (let ((function (format-cache-entry-function entry)))
+    (cond ((functionp function) function)
+          ((or function
+               *compiling-format-control*
+               (< (format-cache-entry-uses entry) *format-cache-compile-threshold*)
+               (member :clasp-min *features*))
+           nil)
+          (t
+           ;; Don't let other callers start compiling it too
+           (setf (format-cache-entry-function entry) :failed)
+           ;; HANDLER-BIND isn't defined until CLOS is, so bind the
+           ;; handlers by hand: muffle warnings and give up on errors.
+           (let ((compiled
+                   (catch 'format-cache-compile
+                     (let ((*compiling-format-control* t)
+                           (*handler-clusters*
+                             (cons (list (cons (lambda (c) (typep c 'warning))
+                                               (lambda (c) (muffle-warning c)))
+                                         (cons (lambda (c) (typep c 'error))
+                                               (lambda (c)
+                                                 (declare (ignore c))
+                                                 (throw 'format-cache-compile nil))))
+                                   *handler-clusters*)))
+                       (declare (special *handler-clusters*))
+                       (values (compile nil (%formatter (format-cache-entry-control entry))))))))
+             (when compiled
+               (setf (format-cache-entry-function entry) compiled))
+             compiled)))))
+
 (defun formatter-aux (stream string-or-fun orig-args &optional (args orig-args))
   (if (functionp string-or-fun)
       (apply string-or-fun stream args)
@@ -515,10 +602,16 @@
 			  (coerce string-or-fun 'simple-string))))
 	       (*output-layout-mode* nil)
 	       (*default-format-error-control-string* string)
-	       (*logical-block-popper* nil))
+	       (*logical-block-popper* nil)
+               (entry (cached-format-control string))
+               ;; Nested control strings (~?) see the outer arguments
+               (function (and (eq args orig-args)
+                              (cached-format-function entry))))
 	  (fmt-log "line 498")
-	  (interpret-directive-list stream (tokenize-control-string string)
-				    orig-args args)))))
+          (if function
+              (apply function stream args)
+              (interpret-directive-list stream (format-cache-entry-directives entry)
+                                        orig-args args))))))
 
 (defun interpret-directive-list (stream directives orig-args args)
   (fmt-log "interpret-directive-list directives: " directives " orig-args: " orig-args " args: " args)
@@ -19,37 +19,70 @@
        (funcall ,key ,element)
      ,element))
 
+;;; Above this many elements the set and duplicate removal functions
+;;; use a hash table instead of comparing every pair of elements,
+;;; when the test is one that hash tables support.
+(defconstant +hash-set-threshold+ 32)
+
+(defun hash-set-test (test test-not)
+  "Return the hash table test equivalent to the TEST and TEST-NOT arguments
+of a sequence function, or NIL if there is none."
+  (cond (test-not nil)
+        ((null test) 'eql)
+        ((or (eq test 'eql) (eq test #'eql)) 'eql)
+        ((or (eq test 'eq) (eq test #'eq)) 'eq)
+        ((or (eq test 'equal) (eq test #'equal)) 'equal)
+        ((or (eq test 'equalp) (eq test #'equalp)) 'equalp)))
+
+(defun member1-table (list1 list2 test test-not key)
+  "When both lists are long and TEST is a hash table test, return a hash table
+of the keys of LIST2 to look the elements of LIST1 up in, otherwise NIL."
+  (let ((hash-test (hash-set-test test test-not)))
+    (when (and hash-test
+               (nthcdr +hash-set-threshold+ list2)
+               (nthcdr 8 list1))
+      (let ((table (make-hash-table :test hash-test :size (length list2))))
+        (dolist (elt list2 table)
+          (setf (gethash (apply-key key elt) table) t))))))
+
+(defmacro member1-or-gethash (item table list2 test test-not key)
+  `(if ,table
+       (values (gethash (apply-key ,key ,item) ,table))
+       (member1 ,item ,list2 ,test ,test-not ,key)))
+
 
 (defun union (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns, as a list, the union of elements in LIST1 and in LIST2."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last list2))
-       (or first list2))
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (progn (rplacd last (cons (car x) nil))
-		 (setq last (cdr last)))
-	  (progn (setq first (cons (car x) nil))
-		 (setq last first))))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last list2))
+         (or first list2))
+      (unless (member1-or-gethash (car x) table list2 test test-not key)
+        (if last
+  	  (progn (rplacd last (cons (car x) nil))
+  		 (setq last (cdr last)))
+  	  (progn (setq first (cons (car x) nil))
+  		 (setq last first)))))))
 
 (defun nunion (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive UNION.  Both LIST1 and LIST2 may be destroyed."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last list2))
-       (or first list2))
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last list2))
+         (or first list2))
+      (unless (member1-or-gethash (car x) table list2 test test-not key)
+        (if last
+  	  (rplacd last x)
+  	  (setq first x))
+        (setq last x)))))
 
 (defun adjoin (item list &key key (test #'eql) test-not)
   "Add ITEM to LIST unless it is already a member."
@@ -66,52 +99,56 @@ Destructive UNION.  Both LIST1 and LIST2 may be destroyed."
 Returns a list consisting of those objects that are elements of both LIST1 and
 LIST2."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (ans))
-      ((null x)
-       (nreverse ans)) ; optional nreverse: not required by CLtL
-    (when (member1 (car x) list2 test test-not key)
-        (push (car x) ans))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (ans))
+        ((null x)
+         (nreverse ans)) ; optional nreverse: not required by CLtL
+      (when (member1-or-gethash (car x) table list2 test test-not key)
+          (push (car x) ans)))))
 
 (defun nintersection (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive INTERSECTION.  Only LIST1 may be destroyed."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last nil))
-       first)
-    (when (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last nil))
+         first)
+      (when (member1-or-gethash (car x) table list2 test test-not key)
+        (if last
+  	  (rplacd last x)
+  	  (setq first x))
+        (setq last x)))))
 
 (defun set-difference (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Returns, as a list, those elements of LIST1 that are not elements of LIST2."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (ans))
-      ((null x) (nreverse ans))
-    (unless (member1 (car x) list2 test test-not key)
-      (push (car x) ans))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (ans))
+        ((null x) (nreverse ans))
+      (unless (member1-or-gethash (car x) table list2 test test-not key)
+        (push (car x) ans)))))
 
 (defun nset-difference (list1 list2 &key test test-not key)
   "Args: (list1 list2 &key (key #'identity) (test #'eql) test-not)
 Destructive SET-DIFFERENCE.  Only LIST1 may be destroyed."
   (declare (optimize safety))
-  (do ((x list1 (cdr x))
-       (first) (last))
-      ((null x)
-       (when last (rplacd last nil))
-       first)
-    (unless (member1 (car x) list2 test test-not key)
-      (if last
-	  (rplacd last x)
-	  (setq first x))
-      (setq last x))))
+  (let ((table (member1-table list1 list2 test test-not key)))
+    (do ((x list1 (cdr x))
+         (first) (last))
+        ((null x)
+         (when last (rplacd last nil))
+         first)
+      (unless (member1-or-gethash (car x) table list2 test test-not key)
+        (if last
+  	  (rplacd last x)
+  	  (setq first x))
+        (setq last x)))))
 
 (defun swap-args (f)
   (and f #'(lambda (x y) (funcall f y x))))
@@ -409,8 +409,38 @@
 	  :start start :end end :from-end from-end :count count
 	  :test-not #'unsafe-funcall1 :key key))
 
+;;; FIND, POSITION, COUNT, MISMATCH and SEARCH hand simple specialized
+;;; vectors (base and character strings, (unsigned-byte 8), double-float and
+;;; bit vectors) to the kernels in sequence.cc when there is no key and the
+;;; test agrees with EQL.  The kernels return a second value of NIL for
+;;; vectors they don't handle.
+(defun eql-kernel-test-p (test test-not key item sequence)
+  (and (null key) (null test-not)
+       (or (null test) (eq test 'eql) (eq test #'eql)
+           ;; EQ agrees with EQL on immediates
+           (and (or (eq test 'eq) (eq test #'eq))
+                (or (characterp item) (fixnump item)))
+           (and (or (eq test 'char=) (eq test #'char=))
+                (characterp item))
+           (and (or (eq test '=) (eq test #'=))
+                (fixnump item)
+                (or (typep sequence '(simple-array (unsigned-byte 8) (*)))
+                    (simple-bit-vector-p sequence))))))
+
+(defun eql-kernel-test2-p (test test-not key sequence1 sequence2)
+  (and (null key) (null test-not)
+       (or (null test) (eq test 'eql) (eq test #'eql)
+           (and (or (eq test 'char=) (eq test #'char=))
+                (stringp sequence1) (stringp sequence2)))))
+
 (defun count (item sequence
               &key test test-not from-end (start 0) end key)
+  (when (and (vectorp sequence)
+             (eql-kernel-test-p test test-not key item sequence))
+    (with-start-end (start end sequence)
+      (multiple-value-bind (counter handled)
+          (core:vector-count-eql item sequence start end)
+        (when handled (return-from count counter)))))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence l)
@@ -517,6 +547,13 @@
 
 
 (defun find (item sequence &key test test-not (start 0) end from-end key)
+  (when (and (vectorp sequence)
+             (eql-kernel-test-p test test-not key item sequence))
+    (with-start-end (start end sequence)
+      (multiple-value-bind (index handled)
+          (core:vector-position-eql item sequence start end from-end)
+        (when handled
+          (return-from find (and index (aref sequence index)))))))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence)
@@ -539,6 +576,12 @@
 
 
 (defun position (item sequence &key test test-not from-end (start 0) end key)
+  (when (and (vectorp sequence)
+             (eql-kernel-test-p test test-not key item sequence))
+    (with-start-end (start end sequence)
+      (multiple-value-bind (index handled)
+          (core:vector-position-eql item sequence start end from-end)
+        (when handled (return-from position index)))))
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0)))
     (with-start-end (start end sequence)
@@ -560,6 +603,89 @@
             :from-end from-end :start start :end end
             :test-not #'unsafe-funcall1 :key key))
 
+;;; Entry points for calls to FIND, POSITION and COUNT with no key and an
+;;; EQL test, see cmp/opt-sequence.lsp.  These skip the keyword parsing:
+;;; lists are scanned here directly and vectors go to the vector kernels.
+(defun list-position-eql (item list start end from-end)
+  (declare (fixnum start end))
+  (let ((index nil) (element nil))
+    (do ((i start (1+ i))
+         (list (nthcdr start list) (cdr list)))
+        ((>= i end))
+      (declare (fixnum i))
+      (when (eql item (car list))
+        (setf index i element (car list))
+        (unless from-end (return))))
+    (values index element)))
+
+(defun find-eql (item sequence start end from-end)
+  (with-start-end (start end sequence)
+    (if (listp sequence)
+        (nth-value 1 (list-position-eql item sequence start end from-end))
+        (multiple-value-bind (index handled)
+            (core:vector-position-eql item sequence start end from-end)
+          (if handled
+              (and index (aref sequence index))
+              (locally (declare (notinline find))
+                (find item sequence :start start :end end :from-end from-end)))))))
+
+(defun position-eql (item sequence start end from-end)
+  (with-start-end (start end sequence)
+    (if (listp sequence)
+        (values (list-position-eql item sequence start end from-end))
+        (multiple-value-bind (index handled)
+            (core:vector-position-eql item sequence start end from-end)
+          (if handled
+              index
+              (locally (declare (notinline position))
+                (position item sequence :start start :end end :from-end from-end)))))))
+
+(defun count-eql (item sequence start end from-end)
+  (with-start-end (start end sequence)
+    (if (listp sequence)
+        (let ((counter 0))
+          (declare (fixnum counter))
+          (do ((i start (1+ i))
+               (list (nthcdr start sequence) (cdr list)))
+              ((>= i end) counter)
+            (declare (fixnum i))
+            (when (eql item (car list)) (incf counter))))
+        (multiple-value-bind (counter handled)
+            (core:vector-count-eql item sequence start end)
+          (if handled
+              counter
+              (locally (declare (notinline count))
+                (count item sequence :start start :end end :from-end from-end)))))))
+
+;;; Duplicate removal for the tests that hash tables support.
+;;; KEYS is a simple-vector of the keys of the elements in the subsequence;
+;;; the result has a 1 for every element that is kept.  When FROM-END the
+;;; first occurrence of each key is kept, otherwise the last one.
+(defun duplicates-keep-mask (keys hash-test from-end)
+  (declare (simple-vector keys))
+  (let* ((count (length keys))
+         (mask (make-array count :element-type 'bit :initial-element 0))
+         (seen (make-hash-table :test hash-test :size count)))
+    (flet ((visit (index)
+             (let ((k (svref keys index)))
+               (unless (nth-value 1 (gethash k seen))
+                 (setf (gethash k seen) t
+                       (sbit mask index) 1)))))
+      (if from-end
+          (dotimes (index count) (visit index))
+          (do ((index (1- count) (1- index)))
+              ((minusp index))
+            (visit index))))
+    mask))
+
+(defun list-duplicates-keep-mask (list count key hash-test from-end)
+  (declare (function key))
+  (let ((keys (make-array count)))
+    (dotimes (index count)
+      (setf (svref keys index) (funcall key (car (the cons list)))
+            list (cdr (the cons list))))
+    (duplicates-keep-mask keys hash-test from-end)))
+
 (defun remove-duplicates-list (sequence start end from-end test test-not key)
   (with-tests (test test-not key)
     (declare (optimize (speed 3) (safety 0) (debug 0) (space 0)))
@@ -570,6 +696,14 @@
                 sequence (cdr (the cons sequence))
                 start (1- start)
                 end (1- end)))
+        (let ((hash-test (hash-set-test test test-not)))
+          (when (and hash-test (> end +hash-set-threshold+))
+            (let ((mask (list-duplicates-keep-mask sequence end key hash-test from-end)))
+              (dotimes (index end)
+                (when (= (sbit mask index) 1)
+                  (push (car (the cons sequence)) output))
+                (setf sequence (cdr (the cons sequence))))
+              (return-from remove-duplicates-list (nreconc output sequence)))))
         (let ((start sequence)
               (end (nthcdr (- end start) sequence)))
           ;; When from-end, keep the first occurrence of each duplicate
@@ -633,6 +767,16 @@ Returns a copy of SEQUENCE without duplicated elements."
                 sequence (cdr (the cons sequence))
                 start (1- start)
                 end (1- end)))
+        (let ((hash-test (hash-set-test test test-not)))
+          (when (and hash-test (> end +hash-set-threshold+))
+            (let ((mask (list-duplicates-keep-mask sequence end key hash-test from-end)))
+              (dotimes (index end)
+                (if (= (sbit mask index) 1)
+                    (setf sequence (cdr (the cons sequence))
+                          splice (cdr (the cons splice)))
+                    (setf sequence (cdr (the cons sequence))
+                          (cdr splice) sequence)))
+              (return-from delete-duplicates-list (cdr (the cons output))))))
         (let ((start splice)
               (end (nthcdr (- end start) sequence)))
           (flet ((already-in-list-p (start current end from-end)
@@ -666,6 +810,26 @@ Returns a copy of SEQUENCE without duplicated elements."
     (with-start-end (start end in length)
       (when (and out (not (eq out in)))
         (copy-subarray out 0 in 0 start))
+      (let ((hash-test (hash-set-test test test-not)))
+        (when (and hash-test (> (- end start) +hash-set-threshold+))
+          (let ((keys (make-array (- end start))))
+            (do ((index start (1+ index)))
+                ((= index end))
+              (declare (fixnum index))
+              (setf (svref keys (- index start)) (key (aref in index))))
+            (let ((mask (duplicates-keep-mask keys hash-test from-end))
+                  (jndex start))
+              (declare (fixnum jndex))
+              (do ((index start (1+ index)))
+                  ((= index end))
+                (declare (fixnum index))
+                (when (= (sbit mask (- index start)) 1)
+                  (when out
+                    (setf (aref (the vector out) jndex)
+                          (aref (the vector in) index)))
+                  (setf jndex (1+ jndex))))
+              (when out (copy-subarray out jndex in end length))
+              (return-from filter-duplicates-vector (+ jndex (- length end)))))))
       (flet ((already-in-vector-p (sequence start current end from-end)
                (declare (vector sequence)
                         (fixnum start current end))
@@ -735,6 +899,12 @@ the sense of TEST.  Otherwise, returns the index of SEQUENCE1 to the first
 element that does not match."
   (with-start-end (start1 end1 sequence1)
    (with-start-end (start2 end2 sequence2)
+    (when (and (vectorp sequence1) (vectorp sequence2)
+               (eql-kernel-test2-p test test-not key sequence1 sequence2))
+      (multiple-value-bind (index handled)
+          (core:vector-mismatch-eql sequence1 start1 end1
+                                    sequence2 start2 end2 from-end)
+        (when handled (return-from mismatch index))))
     (with-tests (test test-not key)
       (if (not from-end)
 	  (do ((i1 start1 (1+ i1))
@@ -769,6 +939,12 @@ Returns the index to the first element of the subsequence if such a
 subsequence is found.  Returns NIL otherwise."
   (with-start-end (start1 end1 sequence1)
     (with-start-end (start2 end2 sequence2)
+      (when (and (vectorp sequence1) (vectorp sequence2)
+                 (eql-kernel-test2-p test test-not key sequence1 sequence2))
+        (multiple-value-bind (index handled)
+            (core:vector-search-eql sequence1 start1 end1
+                                    sequence2 start2 end2 from-end)
+          (when handled (return-from search index))))
       (cond
         ((and (stringp sequence1) (stringp sequence2)
               (not from-end) (not test) (not test-not) (not key))
@@ -113,3 +113,34 @@
 
 
                    
+
+(test fill-specialized-bulk
+      (let ((doubles (make-array 100 :element-type 'double-float :initial-element 0d0))
+            (nibbles (make-array 37 :element-type '(unsigned-byte 4) :initial-element 0))
+            (bits (make-array 150 :element-type 'bit :initial-element 0)))
+        (fill doubles 2.5d0 :start 10 :end 90)
+        (fill nibbles 9 :start 3 :end 35)
+        (fill bits 1 :start 5 :end 140)
+        (and (= (count 2.5d0 doubles) 80) (= (aref doubles 9) 0d0) (= (aref doubles 90) 0d0)
+             (= (count 9 nibbles) 32) (= (aref nibbles 2) 0) (= (aref nibbles 35) 0)
+             (= (count 1 bits) 135) (= (sbit bits 4) 0) (= (sbit bits 140) 0))))
+
+(test replace-specialized-overlapping
+      (let ((bytes (make-array 20 :element-type '(unsigned-byte 8)
+                                  :initial-contents (loop for i below 20 collect i)))
+            (bits (make-array 200 :element-type 'bit
+                                  :initial-contents (loop for i below 200 collect (if (zerop (mod i 3)) 1 0)))))
+        (replace bytes bytes :start1 5 :start2 0 :end2 10)
+        (replace bits bits :start1 7 :start2 3 :end2 150)
+        (and (equalp bytes #(0 1 2 3 4 0 1 2 3 4 5 6 7 8 9 15 16 17 18 19))
+             (loop for i from 7 below 154
+                   always (= (sbit bits i) (if (zerop (mod (- i 4) 3)) 1 0)))
+             (loop for i below 7 always (= (sbit bits i) (if (zerop (mod i 3)) 1 0))))))
+
+(test replace-displaced-specialized
+      (let* ((base (make-array 10 :element-type 'double-float :initial-element 1d0))
+             (displaced (make-array 4 :element-type 'double-float
+                                      :displaced-to base :displaced-index-offset 3)))
+        (replace displaced (make-array 4 :element-type 'double-float :initial-element 7d0))
+        (and (= (count 7d0 base) 4) (= (aref base 3) 7d0) (= (aref base 6) 7d0)
+             (= (aref base 7) 1d0))))
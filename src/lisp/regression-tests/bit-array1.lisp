@@ -154,3 +154,23 @@
 
 
 
+
+(test bit-ops-displaced-unaligned
+      (let* ((base1 (make-array 300 :element-type 'bit
+                                    :initial-contents (loop for i below 300 collect (mod i 2))))
+             (base2 (make-array 300 :element-type 'bit
+                                    :initial-contents (loop for i below 300 collect (if (zerop (mod i 3)) 1 0))))
+             (v1 (make-array 200 :element-type 'bit :displaced-to base1 :displaced-index-offset 13))
+             (v2 (make-array 200 :element-type 'bit :displaced-to base2 :displaced-index-offset 70))
+             (result (bit-xor v1 v2)))
+        (loop for i below 200
+              always (= (sbit result i)
+                        (logxor (mod (+ i 13) 2) (if (zerop (mod (+ i 70) 3)) 1 0))))))
+
+(test bit-ops-in-place-keeps-neighbours
+      (let* ((base (make-array 130 :element-type 'bit :initial-element 1))
+             (window (make-array 10 :element-type 'bit :displaced-to base :displaced-index-offset 60)))
+        (bit-not window t)
+        (and (= (count 0 base) 10)
+             (= (position 0 base) 60)
+             (= (sbit base 70) 1))))
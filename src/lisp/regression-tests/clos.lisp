@@ -128,3 +128,23 @@
  
 
 
+
+;;; SLOT-VALUE with a constant slot name caches the slot's location; the
+;;; cache must notice when the class is redefined and the slot moves.
+(defclass slot-cache-class () ((b :initarg :b)))
+(test slot-value-cache-redefinition
+      (let ((get-b (compile nil '(lambda (o) (slot-value o 'b))))
+            (set-b (compile nil '(lambda (o v) (setf (slot-value o 'b) v))))
+            (old (make-instance 'slot-cache-class :b 1)))
+        (funcall set-b old 2)
+        (and (= (funcall get-b old) 2)
+             (progn
+               (eval '(defclass slot-cache-class () ((a :initform 0) (b :initarg :b))))
+               (let ((new (make-instance 'slot-cache-class :b 3)))
+                 (funcall set-b new 4)
+                 (and (= (funcall get-b new) 4)
+                      (= (slot-value new 'a) 0)
+                      ;; The old instance keeps its value and gets the new slot
+                      (= (funcall get-b old) 2)
+                      (slot-exists-p old 'a)
+                      (= (slot-value old 'a) 0)))))))
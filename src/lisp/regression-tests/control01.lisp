@@ -134,3 +134,17 @@
         (let ((c (cons nil nil)))
           (setf (macro-place-pre c) t)
           (cdr c))))
+
+;;; Values move straight from the values buffer into the callee's arguments.
+(test multiple-value-call-many-values
+      (equal (multiple-value-call #'list
+               (values 1 2 3 4 5 6 7)
+               (values)
+               (values-list '(8 9 10 11 12)))
+             '(1 2 3 4 5 6 7 8 9 10 11 12)))
+
+(test apply-vector
+      (and (= (core:apply-vector #'+ #(1 2 3 4 5 6 7 8)) 36)
+           (equal (core:apply-vector #'list #(a b c d e) 1 4) '(b c d))))
+
+(test-expect-error values-list-dotted (values-list '(1 2 . 3)) :type type-error)
@@ -233,3 +233,14 @@
          nil)))
 
 ;;; TODO: Visibility tests?
+
+;;; Raw return addresses can be captured and symbolized later
+(test backtrace-return-addresses
+      (let ((addresses nil))
+        (function-to-show-up-in-backtrace
+         (lambda () (setf addresses (core:backtrace-return-addresses)))
+         nil)
+        (let ((symbols (core:symbolize-return-addresses addresses)))
+          (and (= (length symbols) (length addresses))
+               ;; at least one of them is a lisp frame
+               (some (lambda (symbol) (and symbol (fifth symbol))) symbols)))))
@@ -70,3 +70,20 @@
   (gctools:garbage-collect))
 (format t "*count* --> ~a - it should be 0~%" *count*)
 (test finalizers-general-remove (= *count* 0) :description "Check if list of general finalizers were discarded")
+
+;;; ------------------------------------------------------------
+;;;
+;;; Finalizers run on the finalizer thread rather than the thread
+;;; that triggered the collection
+(defvar *finalizer-process* nil)
+(bar 6)
+(gctools:finalize *a* #'(lambda (a)(declare (ignore a)) (setq *finalizer-process* mp:*current-process*)))
+(setq *a* nil)
+(dotimes (i 10)
+  (gctools:garbage-collect))
+#-use-mps
+(test finalizers-off-thread
+      (and *finalizer-process*
+           (not (eq *finalizer-process* mp:*current-process*))
+           (zerop (gctools:finalizer-statistics)))
+      :description "Check that finalizers ran on the finalizer thread and the queue is empty")
@@ -107,6 +107,55 @@
                          (remhash :key (make-hash-table :test #'eq  :weakness :key))
                          t))
 
+(test weak-value-equal
+      (let ((ht (make-hash-table :test #'equal :weakness :value)))
+        (dotimes (i 100) (setf (gethash (format nil "k~a" i) ht) (list i)))
+        (and (eq (hash-table-weakness ht) :value)
+             (equal (gethash "k42" ht) '(42))
+             (remhash "k42" ht)
+             (null (gethash "k42" ht))
+             (= (hash-table-count ht) 99))))
+
+(test weak-key-and-value-fixnum-zero
+      (let ((ht (make-hash-table :test #'eql :weakness :key-and-value))
+            (key (list :a)))
+        (setf (gethash key ht) 0
+              (gethash 0 ht) key)
+        (and (eq (hash-table-weakness ht) :key-and-value)
+             (eql (gethash key ht) 0)
+             (eq (gethash 0 ht) key)
+             (= (hash-table-count ht) 2))))
+
+(test-expect-error weak-unknown-weakness
+                   (make-hash-table :weakness :sometimes))
+
+(test-expect-error weak-key-or-value
+                   (make-hash-table :weakness :key-or-value))
+
+(test-expect-error weak-hash-function
+                   (make-hash-table :test #'equal :weakness :key :hash-function #'sxhash))
+
+;;; Entries whose weak side is only referenced by the table go away after a collection
+(defun fill-weak-table (ht key-fn value-fn)
+  (dotimes (i 1000 ht)
+    (setf (gethash (funcall key-fn i) ht) (funcall value-fn i))))
+
+(test weak-value-equal-collected
+      (let ((ht (fill-weak-table (make-hash-table :test #'equal :weakness :value)
+                                 (lambda (i) (format nil "k~a" i))
+                                 #'list)))
+        (gctools:garbage-collect)
+        (gctools:garbage-collect)
+        (< (hash-table-count ht) 1000)))
+
+(test weak-key-and-value-collected
+      (let ((ht (fill-weak-table (make-hash-table :test #'eql :weakness :key-and-value)
+                                 #'list
+                                 #'identity)))
+        (gctools:garbage-collect)
+        (gctools:garbage-collect)
+        (< (hash-table-count ht) 1000)))
+
 (test hash-table-classes
       (let ((sub (clos:class-direct-subclasses (first (clos:class-direct-superclasses (find-class 'hash-table))))))
         (and (= 2 (length sub))
@@ -195,3 +244,33 @@
         (make-hash-table :size 128 :test #'eq :weakness :key)
         (gctools:garbage-collect)
         t))
+
+;;; Keys should mostly be found in or right after the bucket their hash selects
+(defun probe-histogram-ok (test keys)
+  (let ((table (make-hash-table :test test)))
+    (dolist (key keys) (setf (gethash key table) t))
+    (let* ((histogram (core:hash-table-probe-histogram table))
+           (total (reduce #'+ histogram))
+           (probes (loop for count across histogram
+                         for distance from 0
+                         sum (* count distance))))
+      (and (= total (hash-table-count table))
+           (< (/ probes total) 2)
+           (< (length histogram) 64)))))
+
+(test hash-table-probe-histogram-fixnum
+      (probe-histogram-ok 'eql (loop for i below 10000 collect (* i 8))))
+
+(test hash-table-probe-histogram-symbol
+      (probe-histogram-ok 'eq (loop for i below 10000 collect (make-symbol (format nil "S~d" i)))))
+
+(test hash-table-probe-histogram-string
+      (probe-histogram-ok 'equal (loop for i below 10000 collect (format nil "key-~d" i))))
+
+(test hash-table-probe-histogram-list
+      (probe-histogram-ok 'equal (loop for i below 1000 collect (list 'a i))))
+
+(test sxhash-string-element-types
+      (= (sxhash (coerce "hash me please, twenty chars" 'base-string))
+         (sxhash (make-array 28 :element-type 'character
+                                :initial-contents "hash me please, twenty chars"))))
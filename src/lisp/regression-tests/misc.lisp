@@ -234,3 +234,118 @@
                                       (format t "Ignoring everything~%"))))))
         (error (e)
           (values nil e))))
+
+;; User defined telemetry events are flushed to the trace and converted to Chrome JSON
+(test telemetry-user-events
+      (let ((trace (format nil "/tmp/clasp-telemetry-~a.trace" (core:getpid)))
+            (json (format nil "/tmp/clasp-telemetry-~a.json" (core:getpid)))
+            (type (core:telemetry-define-event "regression-test")))
+        (core:telemetry-start trace 10)
+        (dotimes (i 10)
+          (core:telemetry-event type :begin i)
+          (core:telemetry-event type :end))
+        (core:telemetry-stop)
+        (prog1 (>= (core:telemetry-to-chrome-json trace json) 20)
+          (delete-file trace)
+          (delete-file json))))
+
+;; Runtime compiled objects are written to the jit object cache
+(test jit-object-cache
+      (let ((directory (format nil "/tmp/clasp-jit-cache-~a/" (core:getpid)))
+            (jit llvm-sys:*jit-engine*))
+        (multiple-value-bind (previous-directory previous-hits previous-misses)
+            (llvm-sys:jit-object-cache-statistics jit)
+          (declare (ignore previous-hits))
+          (llvm-sys:jit-object-cache-enable jit directory)
+          (unwind-protect
+               (and (= (funcall (compile nil '(lambda (x) (1+ x))) 1) 2)
+                    (multiple-value-bind (dir hits misses)
+                        (llvm-sys:jit-object-cache-statistics jit)
+                      (declare (ignore dir hits))
+                      (> misses previous-misses))
+                    (not (null (directory (merge-pathnames "*.o" directory)))))
+            (llvm-sys:jit-object-cache-disable jit)
+            (mapc #'delete-file (directory (merge-pathnames "*.o" directory)))
+            (when previous-directory
+              (llvm-sys:jit-object-cache-enable jit previous-directory))))))
+
+;; Functions in lazily jitted modules are compiled when they are first called
+(test jit-lazy-compile
+      (let* ((llvm-sys:*jit-lazy* t)
+             (f (compile nil '(lambda (n)
+                               (flet ((never (x) (list x x))
+                                      (twice (x) (* 2 x)))
+                                 (declare (notinline never twice))
+                                 (if (< n 0) (never n) (twice n))))))
+             (compiled (llvm-sys:jit-lazy-compile-count)))
+        ;; Each function is compiled when it is first called and only then
+        (and (= (funcall f 21) 42)
+             (> (llvm-sys:jit-lazy-compile-count) compiled)
+             (let ((compiled (llvm-sys:jit-lazy-compile-count)))
+               (and (= (funcall f 21) 42)
+                    (= (llvm-sys:jit-lazy-compile-count) compiled)
+                    (equal (funcall f -1) '(-1 -1))
+                    (> (llvm-sys:jit-lazy-compile-count) compiled))))))
+
+;; compile-file-parallel reuses the objects of unchanged top level forms
+(test compile-file-cache
+      (let* ((cmp::*compile-file-cache-directory*
+               (pathname (format nil "/tmp/clasp-compile-file-cache-~a/" (core:getpid))))
+             (source (format nil "/tmp/clasp-compile-file-cache-~a.lisp" (core:getpid)))
+             (objects (merge-pathnames "*.o" cmp::*compile-file-cache-directory*)))
+        (flet ((compile-and-load (b)
+                 (with-open-file (out source :direction :output :if-exists :supersede)
+                   (format out "(defun compile-file-cache-a () 1)~%(defun compile-file-cache-b () ~d)~%" b))
+                 (load (cmp::compile-file-parallel source :verbose nil))
+                 (+ (funcall 'compile-file-cache-a) (funcall 'compile-file-cache-b))))
+          (unwind-protect
+               (and (= (compile-and-load 2) 3)
+                    (= (length (directory objects)) 2)
+                    (= (compile-and-load 2) 3)
+                    (= (length (directory objects)) 2)
+                    ;; Only the changed form is compiled again
+                    (= (compile-and-load 5) 6)
+                    (= (length (directory objects)) 3))
+            (mapc #'delete-file (directory objects))
+            (mapc #'delete-file (directory (make-pathname :type :wild :defaults source)))))))
+
+;; Forms that inline a function from another file are not cached
+(test compile-file-cache-foreign-inline
+      (let* ((cmp::*compile-file-cache-directory*
+               (pathname (format nil "/tmp/clasp-compile-file-cache-inline-~a/" (core:getpid))))
+             (source (format nil "/tmp/clasp-compile-file-cache-inline-~a.lisp" (core:getpid)))
+             (objects (merge-pathnames "*.o" cmp::*compile-file-cache-directory*)))
+        (eval '(progn (declaim (inline compile-file-cache-inlined))
+                (defun compile-file-cache-inlined () 3)))
+        (with-open-file (out source :direction :output :if-exists :supersede)
+          (format out "(defun compile-file-cache-c () (compile-file-cache-inlined))~%(defun compile-file-cache-d () 4)~%"))
+        (unwind-protect
+             (progn
+               (load (cmp::compile-file-parallel source :verbose nil))
+               (and (= (funcall 'compile-file-cache-c) 3)
+                    (= (length (directory objects)) 1)))
+          (mapc #'delete-file (directory objects))
+          (mapc #'delete-file (directory (make-pathname :type :wild :defaults source))))))
+
+;; Fasos linked together load every object file of each input faso
+(test link-faso-files
+      (let* ((base (format nil "/tmp/clasp-link-faso-~a" (core:getpid)))
+             (sources (loop for index below 2
+                            collect (format nil "~a-~d.lisp" base index)))
+             (linked (format nil "~a.faso" base)))
+        (unwind-protect
+             (progn
+               (loop for source in sources
+                     for index from 0
+                     do (with-open-file (out source :direction :output :if-exists :supersede)
+                          (format out "(defun link-faso-files-~d () ~d)~%(defvar *link-faso-files-~d* ~d)~%"
+                                  index index index index)))
+               (core:link-faso-files linked
+                                     (loop for source in sources
+                                           collect (compile-file source :output-type :faso
+                                                                        :verbose nil)))
+               (load linked)
+               (equal (list (funcall 'link-faso-files-0) (funcall 'link-faso-files-1)
+                            (symbol-value '*link-faso-files-0*) (symbol-value '*link-faso-files-1*))
+                      '(0 1 0 1)))
+          (mapc #'delete-file (directory (format nil "~a*.*" base))))))
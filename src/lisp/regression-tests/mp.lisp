@@ -237,3 +237,24 @@
             (nthreads 7))
         (spam-processes nthreads (lambda () (mp:atomic-push nil (car place))))
         (equal (car place) (make-list nthreads))))
+
+;;; Compiling in several threads at once exercises the JIT without a global lock
+(test concurrent-compile
+      (let ((nthreads 7))
+        (equal (spam-processes
+                nthreads
+                (lambda ()
+                  (loop for i below 10
+                        for f = (compile nil `(lambda (x) (+ x ,i)))
+                        sum (funcall f 1))))
+               (make-list nthreads :initial-element 55))))
+
+;; A new process's random state is split off when it is made, so the
+;; numbers drawn by both threads only depend on the seed
+(test process-random-state-reproducible
+      (flet ((draw ()
+               (let* ((*random-state* (core:seed-random-state 7))
+                      (process (mp:process-run-function nil (lambda () (random 1000000))))
+                      (parent (random 1000000)))
+                 (list parent (mp:process-join process)))))
+        (equal (draw) (draw))))
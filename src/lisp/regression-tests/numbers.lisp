@@ -612,6 +612,26 @@
         (and (floatp result)
              (not (ext:float-nan-p result)))))
              
+;;; One and two limb bignums take an inline path, check the limb boundaries
+(test small-bignum-arithmetic
+      (let ((a (1- (expt 2 64)))
+            (b (+ (expt 2 127) 5)))
+        (and (= (* a a) #xfffffffffffffffe0000000000000001)
+             (= (+ b b) #x10000000000000000000000000000000a)
+             (= (- b (1- (expt 2 128))) #x-7ffffffffffffffffffffffffffffffa)
+             (= (* a b) #x7fffffffffffffff8000000000000004fffffffffffffffb)
+             (= (- (+ a 1) a) 1)
+             (eql (- (* a 2) a) a)
+             (core:fixnump (- (+ most-positive-fixnum 1) 1))
+             (= (ash b -70) 144115188075855872)
+             (= (ash (- b) -3) -21267647932558653966460912964485513217)
+             (= (ash (- b) -200) -1)
+             (= (ash a 64) (* a (expt 2 64)))
+             (= (logand (- b) (+ (expt 2 100) 7)) #x10000000000000000000000003)
+             (= (logior (- (expt 2 126)) (+ (expt 2 64) 1)) #x-3ffffffffffffffeffffffffffffffff)
+             (< (- b) (- a) a b)
+             (> b (1- b) a))))
+
 ;;; cannot be run yet, because of https://github.com/clasp-developers/clasp/issues/961        
 #+(or)
 (progn
@@ -733,3 +753,29 @@
               unless (equal x y)
               do (format t "Diff ~a with ~a~2%" x y)))
         (values no-error-p)))
+
+;;; Random states made from the same seed, or copied, produce the same
+;;; numbers; a split-off state produces different ones.
+(test random-state-seed-reproducible
+      (flet ((draw (state)
+               (list (random 1000 state) (random (expt 2 100) state)
+                     (random 1.0d0 state) (random 1.0f0 state))))
+        (let* ((a (core:seed-random-state 42))
+               (b (core:seed-random-state 42))
+               (c (make-random-state a))
+               (first (draw a)))
+          (and (equal first (draw b))
+               (equal first (draw c))
+               (not (equal (draw (core:random-state-split a))
+                           (draw a)))))))
+
+(test-expect-error random-state-set-unparsable
+                   (core:random-state-set (make-random-state) "not a random state"))
+
+(test random-fill-bounds
+      (let ((fixnums (make-array 1000 :element-type 'fixnum))
+            (doubles (make-array 1000 :element-type 'double-float)))
+        (core:random-fill fixnums 7 (core:seed-random-state 1))
+        (core:random-fill doubles 2d0 (core:seed-random-state 1))
+        (and (every (lambda (x) (<= 0 x 6)) fixnums)
+             (every (lambda (x) (and (<= 0d0 x) (< x 2d0))) doubles))))
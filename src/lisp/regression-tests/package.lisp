@@ -147,3 +147,18 @@
            (ext:package-remove-nickname package-desig :inexistant-nickname)))
    :type package-error)
 
+
+;; Inherited symbols are cached per package - the cache must follow
+;; export, unexport and use-package
+(let* ((used (make-package (symbol-name (gensym)) :use nil))
+       (user (make-package (symbol-name (gensym)) :use (list used)))
+       (foo (intern "FOO" used)))
+  (export foo used)
+  (test inherited-symbol-cache
+        (and (equal (multiple-value-list (find-symbol "FOO" user)) (list foo :inherited))
+             (progn (unexport foo used) (null (find-symbol "FOO" user)))
+             (progn (export foo used) (eq (find-symbol "FOO" user) foo))
+             (progn (unuse-package used user) (null (find-symbol "FOO" user)))
+             (progn (use-package used user) (eq (find-symbol "FOO" user) foo))))
+  (delete-package user)
+  (delete-package used))
@@ -69,3 +69,74 @@
        nil)))
 
 
+
+;; SIGPROF samples are taken while we burn CPU and written as folded stacks
+(test cpu-sampling-folded
+      (let ((filename (format nil "/tmp/clasp-cpu-profile-~a.folded" (core:getpid))))
+        (core:start-cpu-sampling 1000)
+        (let ((start (get-internal-run-time))
+              (sum 0))
+          (loop while (< (- (get-internal-run-time) start)
+                         (floor internal-time-units-per-second 4))
+                do (dotimes (i 1000) (incf sum i))))
+        (core:stop-cpu-sampling)
+        (prog1 (plusp (core:write-cpu-profile filename :folded))
+          (delete-file filename))))
+
+;; DIRECTORY tells files from subdirectories by the directory entry type
+(test directory-files-and-subdirectories
+      (let* ((base (format nil "/tmp/clasp-directory-~a/" (core:getpid)))
+             (subdirectory (concatenate 'string base "sub/"))
+             (files (list (concatenate 'string base "a.lisp")
+                          (concatenate 'string base "b.lisp")
+                          (concatenate 'string base "c.txt")
+                          (concatenate 'string subdirectory "d.lisp"))))
+        (ensure-directories-exist subdirectory)
+        (unwind-protect
+             (progn
+               (dolist (file files)
+                 (with-open-file (out file :direction :output :if-exists :supersede)
+                   (write-line file out)))
+               (flet ((names (pattern)
+                        (sort (mapcar #'namestring (directory (concatenate 'string base pattern)))
+                              #'string<)))
+                 (and (equal (names "*.lisp")
+                             (list (first files) (second files)))
+                      (equal (names "a.*") (list (first files)))
+                      (equal (names "*/") (list subdirectory))
+                      (equal (names "**/*.lisp")
+                             (list (first files) (second files) (fourth files))))))
+          (mapc #'delete-file files)
+          (core:rmdir subdirectory)
+          (core:rmdir base))))
+
+;; A fork server worker's exit status goes back to the client
+(test fork-server-exit-status
+      (let* ((socket-path (format nil "/tmp/clasp-fork-server-~a.sock" (core:getpid)))
+             (server (nth-value 1 (core:fork))))
+        (when (zerop server)
+          (ext:fork-server socket-path (lambda (request) (parse-integer request))
+                           :poll-milliseconds 20 :max-requests 1)
+          (core:c_UNDERSCORE_exit 0))
+        (let ((status (loop repeat 500
+                            for status = (ignore-errors (core:fork-server-request socket-path "7"))
+                            when status return status
+                            do (sleep 0.01))))
+          (core:waitpid :pid server)
+          (and status
+               (core:wifexited status)
+               (= (core:wexitstatus status) 7)))))
+
+;; A forked child has no finalizer thread - collecting and finalizing there must not wait for one
+(test fork-child-finalizers
+      (progn
+        (gctools:finalize (list :parent) (lambda (object) (declare (ignore object))))
+        (let ((child (nth-value 1 (core:fork))))
+          (when (zerop child)
+            (gctools:finalize (list :child) (lambda (object) (declare (ignore object))))
+            (gctools:garbage-collect)
+            (gctools:garbage-collect)
+            (core:c_UNDERSCORE_exit 3))
+          (let ((status (nth-value 1 (core:waitpid :pid child))))
+            (and (core:wifexited status)
+                 (= (core:wexitstatus status) 3))))))
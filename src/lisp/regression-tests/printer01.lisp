@@ -590,3 +590,11 @@ wrong
 
 
 
+
+;;; A control string built at runtime is cached, and compiled once it has
+;;; been used often enough; the output mustn't change.
+(test format-cached-control-string
+      (let ((control (copy-seq "~a:~{~d~^,~}~@[ ~a~]")))
+        (loop repeat (* 2 core::*format-cache-compile-threshold*)
+              always (string= (format nil control 'x '(1 2 3) "end")
+                              "X:1,2,3 end"))))
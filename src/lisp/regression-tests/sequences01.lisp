@@ -525,3 +525,87 @@
       (let ()
         (declare (inline make-sequence))
       (make-sequence '(array char (*)) 0)))
+
+;; Long sequences take the hash table path - the kept elements and their order must not change
+(test remove-duplicates-hashed-list
+      (let ((list (loop for i below 200 collect (mod i 7))))
+        ;; Without :from-end the last occurrence of each element is kept
+        (and (equal (remove-duplicates list) '(4 5 6 0 1 2 3))
+             (equal (remove-duplicates list :from-end t) '(0 1 2 3 4 5 6))
+             (equal (remove-duplicates (append '(a b) list) :start 2 :end 52)
+                    (append '(a b) (remove-duplicates (subseq list 0 50)) (nthcdr 50 list))))))
+
+(test remove-duplicates-hashed-keep-position
+      (let ((list (loop for i below 100 collect (cons (mod i 10) i))))
+        (and (equal (mapcar #'cdr (remove-duplicates list :key #'car :test #'eql))
+                    '(90 91 92 93 94 95 96 97 98 99))
+             (equal (mapcar #'cdr (remove-duplicates list :key #'car :from-end t))
+                    '(0 1 2 3 4 5 6 7 8 9)))))
+
+(test delete-duplicates-hashed-vector
+      (let ((vector (make-array 100 :fill-pointer 100
+                                    :initial-contents (loop for i below 100 collect (format nil "~a" (mod i 5))))))
+        (equalp (delete-duplicates vector :test #'equal :from-end t) #("0" "1" "2" "3" "4"))))
+
+(test set-difference-hashed
+      (let ((list1 (loop for i below 100 collect i))
+            (list2 (loop for i from 50 below 150 collect i)))
+        (and (equal (set-difference list1 list2) (loop for i below 50 collect i))
+             (equal (intersection list1 list2) (loop for i from 50 below 100 collect i))
+             (= (length (union list1 list2)) 150))))
+
+(test position-kernels-specialized-vectors
+      (let ((bytes (make-array 300 :element-type '(unsigned-byte 8)
+                                   :initial-contents (loop for i below 300 collect (mod i 256))))
+            (bits (make-array 200 :element-type 'bit :initial-element 0))
+            (doubles (make-array 10 :element-type 'double-float :initial-element 0d0)))
+        (setf (sbit bits 70) 1 (sbit bits 130) 1
+              (aref doubles 3) -0d0)
+        (and (= (position 5 bytes) 5)
+             (= (position 5 bytes :from-end t) 261)
+             (= (position 5 bytes :start 6 :end 262) 261)
+             (null (position 256 bytes))
+             (null (position #\a bytes))
+             (= (position #\c (coerce "abcabc" 'base-string) :from-end t) 5)
+             (= (position (code-char 955) (coerce (list #\a (code-char 955)) 'string)) 1)
+             (= (position 1 bits) 70)
+             (= (position 1 bits :from-end t) 130)
+             (null (position 1 bits :start 71 :end 130))
+             (= (position 0 bits :start 70) 71)
+             (= (position -0d0 doubles) 3)
+             (= (position 0 bytes :test #'=) 0)
+             (eql (find 5 bytes :start 10) 5))))
+
+(test count-kernels-specialized-vectors
+      (let ((bits (make-array 1000 :element-type 'bit :initial-element 0))
+            (string (coerce "mississippi" 'base-string)))
+        (loop for i from 3 below 1000 by 7 do (setf (sbit bits i) 1))
+        (and (= (count 1 bits) 143)
+             (= (count 0 bits) 857)
+             (= (count 1 bits :start 4 :end 67) 9)
+             (= (count #\s string) 4)
+             (= (count #\s string :test #'char=) 4)
+             (= (count 1.0d0 (make-array 4 :element-type 'double-float :initial-element 1d0)) 4))))
+
+(test search-mismatch-kernels-specialized-vectors
+      (let ((text (coerce "the cat sat on the mat" 'base-string))
+            (bytes1 (make-array 100 :element-type '(unsigned-byte 8) :initial-element 7))
+            (bytes2 (make-array 100 :element-type '(unsigned-byte 8) :initial-element 7)))
+        (setf (aref bytes2 77) 8)
+        (and (= (search (coerce "the" 'base-string) text) 0)
+             (= (search (coerce "the" 'base-string) text :from-end t) 15)
+             (= (search (coerce "at" 'base-string) text :start2 6 :end2 11) 9)
+             (null (search (coerce "dog" 'base-string) text))
+             (= (mismatch bytes1 bytes2) 77)
+             (= (mismatch bytes1 bytes2 :from-end t) 78)
+             (null (mismatch bytes1 bytes1))
+             (= (mismatch bytes1 bytes2 :end1 50) 50))))
+
+;; Compiled calls with an EQL test go to core::find-eql and friends, which scan lists directly
+(test find-position-count-eql-lists
+      (let ((f (compile nil '(lambda (list)
+                              (list (find 3 list) (find 9 list)
+                                    (position 3 list) (position 3 list :from-end t)
+                                    (position 3 list :start 2 :end 3)
+                                    (count 3 list) (count 3 list :start 2))))))
+        (equal (funcall f (list 1 3 2 3 4)) '(3 nil 1 3 nil 2 1))))
@@ -18,3 +18,43 @@
 (test stamp-of-derivable
       (= (core:instance-stamp (make-instance 'ast-tooling:match-callback))
          (core:class-stamp-for-instances (find-class 'ast-tooling:match-callback))))
+
+;; The heap census reports live objects per stamp name on both collectors
+(test heap-census-conses
+      (let ((census (gctools:heap-census)))
+        (and (consp census)
+             (every (lambda (entry) (and (stringp (first entry))
+                                         (plusp (second entry))
+                                         (plusp (third entry))))
+                    census))))
+
+;; The sampling allocation profiler sees the conses we allocate
+(test allocation-sampling-conses
+      (progn
+        (gctools:start-allocation-sampling 4096)
+        (let ((keep nil))
+          (dotimes (i 100000) (push i keep))
+          (gctools:stop-allocation-sampling)
+          (plusp (length keep)))
+        (plusp (length (gctools:allocation-samples)))))
+
+;; The profile records the interval the samples were taken with, even after
+;; sampling has stopped, and pprof's memory map
+(test allocation-profile-contents
+      (let ((filename (format nil "/tmp/clasp-allocation-profile-~a.heap" (core:getpid))))
+        (gctools:start-allocation-sampling 4096)
+        (let ((keep nil))
+          (dotimes (i 100000) (push i keep))
+          (gctools:stop-allocation-sampling)
+          (plusp (length keep)))
+        (gctools:write-allocation-profile filename)
+        (unwind-protect
+             (with-open-file (in filename)
+               (let ((header (read-line in))
+                     (lines (loop for line = (read-line in nil nil)
+                                  while line collect line)))
+                 (and (eql (search "heap profile:" header) 0)
+                      (search "@ heap_v2/4096" header)
+                      (member "MAPPED_LIBRARIES:" lines :test #'string=)
+                      (= (nth-value 1 (gctools:allocation-samples)) 4096))))
+          (delete-file filename))))
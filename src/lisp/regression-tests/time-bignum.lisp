@@ -0,0 +1,25 @@
+;;; Arithmetic just past fixnum range - the one and two limb bignums
+;;; that checksums, hashes and counters produce.
+;;; Compare (time-small-bignum) with (time-large-bignum), which does the
+;;; same operations on bignums too large for the inline path.
+
+(defun bignum-mix (n seed bits)
+  (let ((h seed)
+        (mask (1- (ash 1 bits))))
+    (dotimes (i n h)
+      (setf h (logand (+ (* h 31) i) mask)
+            h (logxor h (ash h -17))))))
+
+(defun small-bignum-count (n)
+  (let ((sum (expt 2 64))
+        (big (expt 2 100)))
+    (dotimes (i n sum)
+      (setf sum (- (+ sum big) (1- big)))
+      (when (< sum big) (setf sum (- sum i))))))
+
+(defun time-small-bignum (&optional (n 1000000))
+  (time (bignum-mix n (1+ most-positive-fixnum) 120))
+  (time (small-bignum-count n)))
+
+(defun time-large-bignum (&optional (n 1000000))
+  (time (bignum-mix n (expt 2 300) 400)))
@@ -0,0 +1,9 @@
+;;; Listing directories - (time-directory) lists the kernel sources with a
+;;; wild type, a fixed type and recursively, the way ASDF and the build
+;;; system search it for files.
+
+(defun time-directory (&optional (n 20) (root "sys:kernel;"))
+  (let ((root (translate-logical-pathname root)))
+    (time (dotimes (i n) (directory (merge-pathnames "*.*" root))))
+    (time (dotimes (i n) (directory (merge-pathnames "**/*.lisp" root))))
+    (time (dotimes (i n) (directory (merge-pathnames "**/" root))))))
@@ -0,0 +1,19 @@
+;;; FORMAT with a control string that isn't a constant at compile time,
+;;; as in logging and error reporting code.  Compare (time-format-runtime)
+;;; with (time-format-constant), which FORMAT compiles up front.
+
+(defparameter *format-control* "~a ~d: ~{~a~^, ~} (~,2f)~%")
+
+(defun format-runtime (control n)
+  (dotimes (i n)
+    (format nil control 'item i '(a b c) 1.5)))
+
+(defun format-constant (n)
+  (dotimes (i n)
+    (format nil "~a ~d: ~{~a~^, ~} (~,2f)~%" 'item i '(a b c) 1.5)))
+
+(defun time-format-runtime (&optional (n 100000))
+  (time (format-runtime (copy-seq *format-control*) n)))
+
+(defun time-format-constant (&optional (n 100000))
+  (time (format-constant n)))
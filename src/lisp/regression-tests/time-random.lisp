@@ -0,0 +1,20 @@
+;;; Throughput of RANDOM.  (time-random) draws numbers one at a time,
+;;; (time-random-fill) fills specialized vectors in bulk.
+
+(defun random-sum (n limit state)
+  (let ((sum 0))
+    (dotimes (i n sum)
+      (incf sum (random limit state)))))
+
+(defun time-random (&optional (n 1000000))
+  (let ((state (core:seed-random-state 1)))
+    (time (random-sum n 1000 state))
+    (time (random-sum n 1d0 state))
+    (time (random-sum n (expt 2 100) state))))
+
+(defun time-random-fill (&optional (n 1000000))
+  (let ((state (core:seed-random-state 1))
+        (fixnums (make-array n :element-type 'fixnum))
+        (doubles (make-array n :element-type 'double-float)))
+    (time (core:random-fill fixnums 1000 state))
+    (time (core:random-fill doubles 1d0 state))))
@@ -0,0 +1,21 @@
+;;; Reading code is mostly symbol lookup - in the current package, then in
+;;; the packages it uses.  (time-reader) reads the same forms through
+;;; CL-USER, which inherits most of them from COMMON-LISP.
+
+(defparameter *reader-forms*
+  "(defun foo (x &optional (y 1) &key z) (declare (ignore z))
+     (let ((a (car x)) (b (cdr x)))
+       (when (and (consp a) (listp b))
+         (loop for e in b collect (list* e y (length a))))))
+   (defmacro bar (&body body) `(progn ,@body (values)))
+   (multiple-value-bind (q r) (floor 10 3) (format t \"~a ~a\" q r))")
+
+(defun read-all-forms (string)
+  (with-input-from-string (s string)
+    (loop for form = (read s nil s)
+          until (eq form s)
+          count t)))
+
+(defun time-reader (&optional (n 20000))
+  (let ((*package* (find-package "COMMON-LISP-USER")))
+    (time (dotimes (i n) (read-all-forms *reader-forms*)))))
@@ -0,0 +1,25 @@
+;;; SLOT-VALUE with a constant slot name, as in WITH-SLOTS and generated
+;;; serializer code.  Compare (time-slot-value) with (time-slot-accessor),
+;;; which does the same through the slots' accessors.
+
+(defclass slot-point ()
+  ((x :initarg :x :accessor slot-point-x)
+   (y :initarg :y :accessor slot-point-y)))
+
+(defun slot-value-sum (point n)
+  (let ((sum 0))
+    (dotimes (i n sum)
+      (setf (slot-value point 'x) i)
+      (incf sum (+ (slot-value point 'x) (slot-value point 'y))))))
+
+(defun slot-accessor-sum (point n)
+  (let ((sum 0))
+    (dotimes (i n sum)
+      (setf (slot-point-x point) i)
+      (incf sum (+ (slot-point-x point) (slot-point-y point))))))
+
+(defun time-slot-value (&optional (n 1000000))
+  (time (slot-value-sum (make-instance 'slot-point :x 0 :y 1) n)))
+
+(defun time-slot-accessor (&optional (n 1000000))
+  (time (slot-accessor-sum (make-instance 'slot-point :x 0 :y 1) n)))
@@ -0,0 +1,23 @@
+;;; Moving values into argument lists: MULTIPLE-VALUE-CALL, APPLY into a
+;;; &REST parameter, VALUES-LIST and CORE:APPLY-VECTOR.
+
+(defun mv-six () (values 1 2 3 4 5 6))
+(defun sum-rest (&rest args) (reduce #'+ args))
+(defun sum-six (a b c d e f) (+ a b c d e f))
+
+(defun time-multiple-value-call (&optional (n 1000000))
+  (time (dotimes (i n) (multiple-value-call #'sum-six (mv-six))))
+  (time (dotimes (i n) (multiple-value-call #'sum-six (values 1 2 3) (values 4 5 6)))))
+
+(defun time-apply-rest (&optional (n 1000000))
+  (let ((args (list 1 2 3 4 5 6)))
+    (time (dotimes (i n) (apply #'sum-rest args)))
+    (time (dotimes (i n) (apply #'sum-rest 1 2 args)))))
+
+(defun time-values-list (&optional (n 1000000))
+  (let ((args (list 1 2 3 4 5 6)))
+    (time (dotimes (i n) (multiple-value-call #'sum-six (values-list args))))))
+
+(defun time-apply-vector (&optional (n 1000000))
+  (let ((args (vector 1 2 3 4 5 6)))
+    (time (dotimes (i n) (core:apply-vector #'sum-six args)))))
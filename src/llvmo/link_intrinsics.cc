@@ -1179,7 +1179,10 @@ LCC_RETURN cc_call_multipleValueOneFormCallWithRet0(core::Function_O *tfunc, gct
   FILL_FRAME_WITH_RETURN_REGISTERS(mvargs,ret0);
   if (ret0.nvals>LCC_RETURN_VALUES_IN_REGISTERS) {
     core::MultipleValues &mvThreadLocal = core::lisp_multipleValues();
-    for (size_t i(LCC_RETURN_VALUES_IN_REGISTERS); i < ret0.nvals; ++i) (*mvargs)[i] = ENSURE_VALID_OBJECT(mvThreadLocal[i]);
+    mvThreadLocal.copyValues(mvargs->arguments(LCC_RETURN_VALUES_IN_REGISTERS), LCC_RETURN_VALUES_IN_REGISTERS, ret0.nvals);
+#ifdef DEBUG_GUARD_VALIDATE
+    for (size_t i(LCC_RETURN_VALUES_IN_REGISTERS); i < ret0.nvals; ++i) ENSURE_VALID_OBJECT(mvThreadLocal[i]);
+#endif
   }
 #ifdef DEBUG_VALUES
   if (_sym_STARdebug_valuesSTAR &&
@@ -29,7 +29,11 @@ THE SOFTWARE.
 
 //#include <llvm/Support/system_error.h>
 #include <dlfcn.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
 #include <iomanip>
+#include <mutex>
 #include <clasp/core/foundation.h>
 //
 // The include for Debug.h must be first so we can force NDEBUG undefined
@@ -67,6 +71,9 @@ THE SOFTWARE.
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/CodeGen.h>
 #include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/LTO/legacy/ThinLTOCodeGenerator.h>
 #include <llvm/Analysis/ModuleSummaryAnalysis.h>
 #include <llvm/Analysis/ProfileSummaryInfo.h>
@@ -204,7 +211,7 @@ int my_LLVMOpInfoCallback(void* DisInfo, uint64_t pc, uint64_t offset, uint64_t
 
 
 const char* my_LLVMSymbolLookupCallback (void *DisInfo, uint64_t ReferenceValue, uint64_t *ReferenceType, uint64_t ReferencePC, const char **ReferenceName) {
-  const char* symbol;
+  std::string symbol;
   uintptr_t start, end;
   char type;
   bool found = core::lookup_address((uintptr_t)ReferenceValue, symbol, start, end, type);
@@ -217,8 +224,8 @@ const char* my_LLVMSymbolLookupCallback (void *DisInfo, uint64_t ReferenceValue,
       ss << "+" << (ReferenceValue-start);
     }
     if (symbol[0]=='_'
-        && strlen(symbol)>strlen(CONTAB_NAME)
-        && strncmp(CONTAB_NAME,symbol+1,strlen(CONTAB_NAME))==0) {
+        && symbol.size()>strlen(CONTAB_NAME)
+        && strncmp(CONTAB_NAME,symbol.c_str()+1,strlen(CONTAB_NAME))==0) {
       ss << "["<< dbg_safe_repr((uintptr_t)*(uintptr_t*)ReferenceValue)<<"]";
     }
     ss << "}";
@@ -3733,15 +3740,18 @@ struct jit_descriptor __jit_debug_descriptor = { 1, 0, 0, 0 };
 #endif
 
 mp::Mutex* global_jit_descriptor = NULL;
+std::once_flag global_jit_descriptor_once;
 
 
 void register_object_file_with_gdb(const llvm::object::ObjectFile& Obj, const llvm::RuntimeDyld::LoadedObjectInfo &loadedObjectInfo) {
 //  printf("%s:%d:%s  ObjectFile@%p\n", __FILE__, __LINE__, __FUNCTION__, &Obj);
   uint64_t Key =
     static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Obj.getData().data()));
-  if (global_jit_descriptor==NULL) {
-    global_jit_descriptor = new mp::Mutex(JITGDBIF_NAMEWORD);
-  }
+  // Objects are linked by whichever thread is compiling - so more than one
+  // thread can get here the first time.
+  std::call_once(global_jit_descriptor_once, [] () {
+      global_jit_descriptor = new mp::Mutex(JITGDBIF_NAMEWORD);
+    });
   mp::RAIIReadWriteLock<mp::Mutex> safe_lock(*global_jit_descriptor);
   llvm::JITEventListener* listener = JITEventListener::createGDBRegistrationListener();
   listener->notifyObjectLoaded(Key, Obj, loadedObjectInfo);
@@ -3951,6 +3961,208 @@ class ClaspSectionMemoryManager : public SectionMemoryManager {
 
 };
 
+#define CLASP_JIT_OBJECT_CACHE_DEFAULT_BYTES (1024*1024*1024)
+
+/*! An on-disk cache of the objects that the compile layer generates for runtime
+    compiled modules - see llvm-sys:jit-object-cache-enable.
+    Objects are stored as <directory>/<key>.o where the key is the SHA1 of the module
+    bitcode, the target triple and data layout and the clasp and llvm versions, so a
+    module that comes out of the compiler identical to one compiled by an earlier
+    process skips codegen and the cached object is linked instead.
+    Every hit touches the file so when the cache grows past _MaxBytes the objects with
+    the oldest modification times are the least recently used and are removed first. */
+class ClaspObjectCache : public llvm::ObjectCache {
+public:
+  mp::Mutex            _Mutex;
+  std::string          _Directory;   // empty when the cache is disabled
+  size_t               _MaxBytes;
+  size_t               _TotalBytes;
+  std::atomic<size_t>  _Hits;
+  std::atomic<size_t>  _Misses;
+  std::atomic<size_t>  _Evictions;
+  ClaspObjectCache() : _Mutex(JITCACHE_NAMEWORD), _MaxBytes(0), _TotalBytes(0), _Hits(0), _Misses(0), _Evictions(0) {};
+
+  /*! The compile layer calls getObject and then notifyObjectCompiled for the same module
+      on the same thread - remember the key so it is only calculated once. */
+  static thread_local const llvm::Module* _KeyModule;
+  static thread_local std::string _Key;
+
+  std::string directory() {
+    WITH_READ_WRITE_LOCK(this->_Mutex);
+    return this->_Directory;
+  }
+
+  std::string object_pathname(const std::string& directory, const std::string& key) {
+    return directory + "/" + key + ".o";
+  }
+
+  static std::string module_key(const llvm::Module* module) {
+    // The source file name is the run-time module name - it has a counter in it
+    // that says nothing about the code, leave it out of the key.  The module
+    // belongs to the compile layer, so hash the bitcode of a copy without it.
+    std::unique_ptr<llvm::Module> copy = llvm::CloneModule(*module);
+    copy->setSourceFileName("");
+    llvm::SmallVector<char,0> buffer;
+    llvm::raw_svector_ostream stream(buffer);
+    llvm::WriteBitcodeToFile(*copy,stream);
+    llvm::SHA1 sha;
+    sha.update(llvm::StringRef(buffer.data(),buffer.size()));
+    sha.update(module->getTargetTriple());
+    sha.update(module->getDataLayoutStr());
+    sha.update(CLASP_GIT_COMMIT);
+    sha.update(LLVM_VERSION_STRING);
+    return llvm::toHex(sha.final(),true);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) {
+    std::string directory = this->directory();
+    if (directory.empty()) return nullptr;
+    _KeyModule = module;
+    _Key = module_key(module);
+    std::string pathname = this->object_pathname(directory,_Key);
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(pathname,-1,false);
+    if (!buffer) {
+      this->_Misses++;
+      return nullptr;
+    }
+    utime(pathname.c_str(),NULL);
+    this->_Hits++;
+    return std::move(*buffer);
+  }
+
+  void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) {
+    std::string directory = this->directory();
+    if (directory.empty() || _KeyModule != module) return;
+    _KeyModule = NULL;
+    std::string pathname = this->object_pathname(directory,_Key);
+    // Write a temporary file and rename it so that other processes sharing the
+    // cache never see a partially written object.
+    std::stringstream temp_pathname;
+    temp_pathname << pathname << ".tmp" << getpid() << "-" << (uintptr_t)my_thread;
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream out(temp_pathname.str(),ec,llvm::sys::fs::F_None);
+      if (ec) return;
+      out.write(object.getBufferStart(),object.getBufferSize());
+      out.close();
+      if (out.has_error()) {
+        out.clear_error();
+        llvm::sys::fs::remove(temp_pathname.str());
+        return;
+      }
+    }
+    if (llvm::sys::fs::rename(temp_pathname.str(),pathname)) {
+      llvm::sys::fs::remove(temp_pathname.str());
+      return;
+    }
+    bool evict = false;
+    {
+      WITH_READ_WRITE_LOCK(this->_Mutex);
+      this->_TotalBytes += object.getBufferSize();
+      evict = (this->_MaxBytes != 0 && this->_TotalBytes > this->_MaxBytes);
+    }
+    if (evict) this->evict();
+  }
+
+  struct Entry {
+    std::string  _Pathname;
+    time_t       _Modified;
+    size_t       _Size;
+  };
+
+  std::vector<Entry> entries(const std::string& directory) {
+    std::vector<Entry> result;
+    std::error_code ec;
+    for ( llvm::sys::fs::directory_iterator it(directory,ec), end; it != end && !ec; it.increment(ec) ) {
+      if (llvm::sys::path::extension(it->path()) != ".o") continue;
+      struct stat st;
+      if (stat(it->path().c_str(),&st) != 0) continue;
+      result.push_back(Entry{it->path(),st.st_mtime,(size_t)st.st_size});
+    }
+    return result;
+  }
+
+  /*! Remove the least recently used objects until the cache is at 3/4 of _MaxBytes */
+  void evict() {
+    WITH_READ_WRITE_LOCK(this->_Mutex);
+    std::vector<Entry> entries = this->entries(this->_Directory);
+    std::sort(entries.begin(),entries.end(),[] (const Entry& x, const Entry& y) { return x._Modified < y._Modified; });
+    size_t total = 0;
+    for ( auto& entry : entries ) total += entry._Size;
+    size_t target = this->_MaxBytes - this->_MaxBytes/4;
+    for ( auto& entry : entries ) {
+      if (total <= target) break;
+      if (!llvm::sys::fs::remove(entry._Pathname)) {
+        total -= entry._Size;
+        this->_Evictions++;
+      }
+    }
+    this->_TotalBytes = total;
+  }
+
+  /*! Return false if the directory could not be created */
+  bool enable(const std::string& directory, size_t max_bytes) {
+    if (llvm::sys::fs::create_directories(directory)) return false;
+    size_t total = 0;
+    for ( auto& entry : this->entries(directory) ) total += entry._Size;
+    bool evict;
+    {
+      WITH_READ_WRITE_LOCK(this->_Mutex);
+      this->_Directory = directory;
+      this->_MaxBytes = max_bytes;
+      this->_TotalBytes = total;
+      evict = (max_bytes != 0 && total > max_bytes);
+    }
+    if (evict) this->evict();
+    return true;
+  }
+
+  void disable() {
+    WITH_READ_WRITE_LOCK(this->_Mutex);
+    this->_Directory = "";
+  }
+};
+
+thread_local const llvm::Module* ClaspObjectCache::_KeyModule = NULL;
+thread_local std::string ClaspObjectCache::_Key;
+
+CL_LAMBDA(jit directory &optional (max-bytes 1073741824));
+CL_DOCSTRING(R"doc(Cache the objects that the JIT generates for runtime compiled code in DIRECTORY.
+A later process that compiles an identical module links the cached object and skips codegen.
+When the cache grows past MAX-BYTES the least recently used objects are removed, zero means no limit.
+Setting the CLASP_JIT_OBJECT_CACHE environment variable to a directory enables the cache at startup.)doc");
+CL_DEFUN void llvm_sys__jit_object_cache_enable(ClaspJIT_sp jit, core::String_sp directory, size_t max_bytes) {
+  std::string dir = directory->get_std_string();
+  if (!jit->_ObjectCache->enable(dir,max_bytes)) {
+    SIMPLE_ERROR(BF("Could not create the jit object cache directory %s") % dir);
+  }
+}
+
+CL_DOCSTRING(R"doc(Stop using the jit object cache, the cached objects are left on disk.)doc");
+CL_DEFUN void llvm_sys__jit_object_cache_disable(ClaspJIT_sp jit) {
+  jit->_ObjectCache->disable();
+}
+
+CL_DOCSTRING(R"doc(Return (values directory hits misses evictions bytes) for the jit object cache.
+Directory is NIL when the cache is disabled.)doc");
+CL_DEFUN core::T_mv llvm_sys__jit_object_cache_statistics(ClaspJIT_sp jit) {
+  ClaspObjectCache* cache = jit->_ObjectCache;
+  std::string directory;
+  size_t bytes;
+  {
+    WITH_READ_WRITE_LOCK(cache->_Mutex);
+    directory = cache->_Directory;
+    bytes = cache->_TotalBytes;
+  }
+  core::T_sp tdirectory = _Nil<core::T_O>();
+  if (!directory.empty()) tdirectory = core::SimpleBaseString_O::make(directory);
+  return Values(tdirectory,
+                core::make_fixnum(cache->_Hits.load()),
+                core::make_fixnum(cache->_Misses.load()),
+                core::make_fixnum(cache->_Evictions.load()),
+                core::make_fixnum(bytes));
+}
+
 
 
 
@@ -3984,7 +4196,7 @@ void save_symbol_info(const llvm::object::ObjectFile& object_file, const llvm::R
 #if !defined(_TARGET_OS_LINUX) && !defined(_TARGET_OS_FREEBSD) && !defined(_TARGET_OS_DARWIN)
 #error You need to decide here
 #endif
-
+  std::vector<core::JittedSymbol> jitted_symbols;
   for ( auto p : symbol_sizes ) {
     llvm::object::SymbolRef symbol = p.first;
     Expected<StringRef> expected_symbol_name = symbol.getName();
@@ -3999,6 +4211,10 @@ void save_symbol_info(const llvm::object::ObjectFile& object_file, const llvm::R
         uint64_t section_address = loaded_object_info.getSectionLoadAddress(section_ref);
         if (((char*)section_address+address) != NULL ) {
           core::register_jitted_object(name,section_address+address,size);
+          Expected<llvm::object::SymbolRef::Type> symbol_type = symbol.getType();
+          bool function = (symbol_type && *symbol_type == llvm::object::SymbolRef::ST_Function);
+          if (!symbol_type) llvm::consumeError(symbol_type.takeError());
+          jitted_symbols.emplace_back(name,section_address+address,size,function);
           core::Cons_sp symbol_info = core::Cons_O::createList(core::make_fixnum((Fixnum)size),core::Pointer_O::create((void*)((char*)section_address+address)));
           register_symbol_with_libunwind(name,section_address+address,size);
           if ((!comp::_sym_jit_register_symbol.unboundp()) && comp::_sym_jit_register_symbol->fboundp()) {
@@ -4014,12 +4230,22 @@ void save_symbol_info(const llvm::object::ObjectFile& object_file, const llvm::R
       }
     }
   }
+  core::register_jitted_symbols(jitted_symbols);
 }
 
 
 CL_DEFUN core::T_sp llvm_sys__lookup_jit_symbol_info(void* ptr) {
-  core::HashTableEqual_sp ht = gc::As<core::HashTableEqual_sp>(comp::_sym_STARjit_saved_symbol_infoSTAR->symbolValue());
   core::T_sp result = _Nil<core::T_O>();
+  // The symbol index has the functions, data symbols are only in the hash table
+  core::debugInfo()._SymbolIndex.find((uintptr_t)ptr,[&result] (const core::SymbolIndexRegion& region, const core::SymbolIndexEntry& entry) {
+      if (region._Jitted) {
+        result = core::Cons_O::create(core::SimpleBaseString_O::make(region.entryName(entry)),
+                                      core::Cons_O::createList(core::make_fixnum((Fixnum)(entry._End-entry._Start)),
+                                                               core::Pointer_O::create((void*)entry._Start)));
+      }
+    });
+  if (result.notnilp()) return result;
+  core::HashTableEqual_sp ht = gc::As<core::HashTableEqual_sp>(comp::_sym_STARjit_saved_symbol_infoSTAR->symbolValue());
   ht->map_while_true([ptr,&result] (core::T_sp key, core::T_sp value) -> bool {
                        if (value.consp()) {
                          core::T_sp address = value.unsafe_cons()->ocadr();
@@ -4352,6 +4578,68 @@ CL_DEFUN ClaspJIT_sp llvm_sys__make_clasp_jit()
   return cj;
 }
 
+/*! Called through a lazy stub whose function could not be compiled.  The stub jumps
+    here in place of the function so the caller sees the error as if the call failed -
+    the JIT has already reported why the function could not be materialized. */
+static void lazy_compile_failed() {
+  SIMPLE_ERROR(BF("A lazily compiled function could not be materialized"));
+}
+
+/*! The prefix that core:startup-function-name-and-linkage gives startup functions
+    when it isn't passed one, up to and including the _ before the id */
+static const std::string& startup_function_prefix() {
+  static std::string prefix;
+  static std::once_flag once;
+  std::call_once(once,[]() {
+      core::T_mv name_linkage = core::core__startup_function_name_and_linkage(0,_Nil<core::T_O>());
+      std::string name = gc::As<core::String_sp>(name_linkage)->get_std_string();
+      prefix = name.substr(0,name.rfind('_')+1);
+    });
+  return prefix;
+}
+
+static bool startup_function_name_p(llvm::StringRef name) {
+  return name.startswith(MODULE_STARTUP_FUNCTION_NAME)
+    || name.startswith(MODULE_SHUTDOWN_FUNCTION_NAME)
+    || name.startswith(startup_function_prefix())
+    || name.startswith(RUN_ALL_FUNCTION_NAME)
+    || name.startswith(CLASP_CTOR_FUNCTION_NAME);
+}
+
+/*! Number of partitions the lazy JIT compiled because one of their stubs was called */
+std::atomic<size_t> global_jit_lazy_compiles(0);
+
+/*! The startup function of a module is looked up as soon as the module is added and it
+    calls the run-all and literal initialization functions right away - compile them
+    together with whatever was requested rather than one stub at a time.  Every other
+    function gets its own partition and is compiled on its first call. */
+static llvm::Optional<llvm::orc::CompileOnDemandLayer::GlobalValueSet>
+partition_with_startup_functions(llvm::orc::CompileOnDemandLayer::GlobalValueSet requested) {
+  llvm::orc::CompileOnDemandLayer::GlobalValueSet partition(requested);
+  bool startup_requested = false;
+  for ( auto gv : requested ) {
+    if (startup_function_name_p(gv->getName())) {
+      startup_requested = true;
+      break;
+    }
+  }
+  if (startup_requested) {
+    const llvm::Module* module = (*requested.begin())->getParent();
+    for ( auto& func : *module ) {
+      if (!func.isDeclaration() && startup_function_name_p(func.getName())) partition.insert(&func);
+    }
+  } else {
+    global_jit_lazy_compiles++;
+  }
+  return partition;
+}
+
+CL_DOCSTRING(R"doc(Return the number of times the lazy JIT (see llvm-sys:*jit-lazy*) has compiled
+a function because it was called for the first time.)doc");
+CL_DEFUN size_t llvm_sys__jit_lazy_compile_count() {
+  return global_jit_lazy_compiles.load();
+}
+
 ClaspJIT_O::ClaspJIT_O() {
 #if 0
     // Detect the host and set code model to small.
@@ -4403,8 +4691,19 @@ ClaspJIT_O::ClaspJIT_O() {
   auto cm = converter->enumForSymbol<llvm::CodeModel::Model>(code_model_symbol);
   JTMB->setCodeModel(cm);
 #endif
-  this->_Compiler = new llvm::orc::ConcurrentIRCompiler(*JTMB);
+  this->_ObjectCache = new ClaspObjectCache();
+  // WARN isn't defined yet - if the directory can't be created the cache stays
+  // disabled and the warning comes from the startup code (epilogue-cclasp.lisp)
+  if (const char* cache_directory = getenv("CLASP_JIT_OBJECT_CACHE")) {
+    this->_ObjectCache->enable(cache_directory,CLASP_JIT_OBJECT_CACHE_DEFAULT_BYTES);
+  }
+  this->_Compiler = new llvm::orc::ConcurrentIRCompiler(*JTMB,this->_ObjectCache);
   this->_CompileLayer = new llvm::orc::IRCompileLayer(*this->_ES,*this->_LinkLayer,*this->_Compiler);
+  llvm::Triple triple(JTMB->getTargetTriple());
+  this->_LazyCallThroughManager = llvm::cantFail(llvm::orc::createLocalLazyCallThroughManager(triple,*this->_ES,llvm::pointerToJITTargetAddress(&lazy_compile_failed)));
+  this->_CODLayer = new llvm::orc::CompileOnDemandLayer(*this->_ES,*this->_CompileLayer,*this->_LazyCallThroughManager,
+                                                        llvm::orc::createLocalIndirectStubsManagerBuilder(triple));
+  this->_CODLayer->setPartitionFunction(partition_with_startup_functions);
   //  printf("%s:%d Registering ClaspDynamicLibarySearchGenerator\n", __FILE__, __LINE__ );
   this->_ES->getMainJITDylib().setGenerator(llvm::cantFail(ClaspDynamicLibrarySearchGenerator::GetForCurrentProcess(this->_DataLayout->getGlobalPrefix())));
 }
@@ -4442,6 +4741,8 @@ bool ClaspJIT_O::do_lookup(JITDylib& dylib, const std::string& Name, void*& ptr)
 
  CL_DEFMETHOD core::Pointer_sp ClaspJIT_O::lookup(JITDylib& dylib, const std::string& Name) {
      void* ptr;
+     // ORC compiles lazily - the first lookup of a symbol in a module is where the compile happens
+     telemetry::ScopedEvent compiling(telemetry::event_jit_compile);
      bool found = this->do_lookup(dylib,Name,ptr);
      if (!found) {
          SIMPLE_ERROR(BF("Could not find pointer for name %s") % Name);
@@ -4475,7 +4776,12 @@ CL_DEFMETHOD void ClaspJIT_O::addIRModule(JITDylib_sp dylib, Module_sp module, T
   std::unique_ptr<llvm::Module> umodule(module->wrappedPtr());
   llvm::ExitOnError ExitOnErr;
   JITDylib& jdl = *dylib->wrappedPtr();
-  ExitOnErr(this->_CompileLayer->add(jdl,llvm::orc::ThreadSafeModule(std::move(umodule),*context->wrappedPtr())));
+  llvm::orc::ThreadSafeModule tsm(std::move(umodule),*context->wrappedPtr());
+  if (_sym_STARjit_lazySTAR->symbolValue().notnilp()) {
+    ExitOnErr(this->_CODLayer->add(jdl,std::move(tsm)));
+  } else {
+    ExitOnErr(this->_CompileLayer->add(jdl,std::move(tsm)));
+  }
 }
 
 
@@ -71,6 +71,7 @@ namespace llvmo {
 
 SYMBOL_EXPORT_SC_(LlvmoPkg, STARrunTimeExecutionEngineSTAR);
 SYMBOL_EXPORT_SC_(LlvmoPkg, STARdebugObjectFilesSTAR);
+SYMBOL_EXPORT_SC_(LlvmoPkg, STARjit_lazySTAR);
 SYMBOL_EXPORT_SC_(LlvmoPkg, STARdumpObjectFilesSTAR);
 SYMBOL_EXPORT_SC_(LlvmoPkg, STARdefault_code_modelSTAR);
 SYMBOL_EXPORT_SC_(LlvmoPkg, STARjit_engineSTAR);
@@ -548,6 +549,7 @@ void LlvmoExposer_O::expose(core::Lisp_sp lisp, core::Exposer_O::WhatToExpose wh
     GC_ALLOCATE(ClaspJIT_O,jit_engine);
     llvmo::_sym_STARjit_engineSTAR->defparameter(jit_engine);
     llvmo::_sym_STARdebugObjectFilesSTAR->defparameter(_Nil<core::T_O>());
+    llvmo::_sym_STARjit_lazySTAR->defparameter(getenv("CLASP_JIT_LAZY") ? _lisp->_true() : _Nil<core::T_O>());
     llvmo::_sym_STARdumpObjectFilesSTAR->defparameter(_Nil<core::T_O>());
     SYMBOL_EXPORT_SC_(LlvmoPkg, _PLUS_globalBootFunctionsName_PLUS_);
     SYMBOL_EXPORT_SC_(LlvmoPkg, _PLUS_globalEpilogueName_PLUS_);
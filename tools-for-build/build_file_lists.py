@@ -117,6 +117,7 @@ SRC_CORE_FILES = \
         'loadTimeValues',
 #        'reader',
         'lightProfiler',
+        'sampleProfiler',
         'fileSystem',
         'intArray',
         'posixTime',
@@ -156,6 +157,7 @@ def collect_clasp_c_source_files(bld):
                  'gcalloc',
                  'gcweak',
                  'memoryManagement',
+                 'telemetry',
                  'mygc.c']) + \
              collect_c_source_files(bld, 'src/clbind/', [
                  'adapter',
@@ -359,6 +361,7 @@ def collect_bclasp_lisp_files(**kwargs):
         "src/lisp/kernel/clos/inspect",
         "src/lisp/kernel/lsp/fli",
         "src/lisp/kernel/lsp/posix",
+        "src/lisp/kernel/lsp/fork-server",
         "src/lisp/modules/sockets/sockets",
         "src/lisp/kernel/lsp/top",
         "src/lisp/kernel/tag/pre-epilogue-bclasp",